@@ -15,6 +15,9 @@ zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashtxlock")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawblock")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawtx")
 zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawtxlock")
+zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"sequence")
+zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"zerocoinmint")
+zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"zerocoinspend")
 zmqSubSocket.connect("tcp://127.0.0.1:%i" % port)
 
 try:
@@ -46,6 +49,13 @@ try:
         elif topic == "rawtxlock":
             print('- RAW TX LOCK ('+sequence+') -')
             print(binascii.hexlify(body).decode("utf-8"))
+        elif topic == "sequence":
+            print('- SEQUENCE ('+sequence+') -')
+            print(binascii.hexlify(body[:32]).decode("utf-8") + ' ' + body[32:33].decode("utf-8"))
+        elif topic == "zerocoinmint" or topic == "zerocoinspend":
+            denom = struct.unpack('<I', body[33:37])[0]
+            print('- ' + topic.upper() + ' ('+sequence+') -')
+            print(body[0:1].decode("utf-8") + ' ' + binascii.hexlify(body[1:33]).decode("utf-8") + ' ' + str(denom))
 
 except KeyboardInterrupt:
     zmqContext.destroy()
@@ -247,7 +247,7 @@ bool InvalidCheckpointRange(int nHeight)
     return nHeight > Params().Zerocoin_Block_LastGoodCheckpoint() && nHeight < Params().Zerocoin_Block_RecalculateAccumulators();
 }
 
-bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError)
+bool GetCoinMintHeight(const PublicCoin& coin, int& nHeightMintAdded)
 {
     uint256 txid;
     if (!zerocoinDB->ReadCoinMint(coin.getValue(), txid)) {
@@ -262,7 +262,25 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
         return false;
     }
 
-    int nHeightMintAdded= mapBlockIndex[hashBlock]->nHeight;
+    BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+    if (mi == mapBlockIndex.end() || !mi->second) {
+        LogPrint("zero","%s mint block is not indexed\n", __func__);
+        return false;
+    }
+    nHeightMintAdded = mi->second->nHeight;
+    return true;
+}
+
+bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError)
+{
+    int nHeightMintAdded;
+    if (!GetCoinMintHeight(coin, nHeightMintAdded))
+        return false;
+    return GenerateAccumulatorWitness(coin, nHeightMintAdded, accumulator, witness, nSecurityLevel, nMintsAdded, strError);
+}
+
+bool GenerateAccumulatorWitness(const PublicCoin &coin, int nHeightMintAdded, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError)
+{
     uint256 nCheckpointBeforeMint = 0;
     CBlockIndex* pindex = chainActive[nHeightMintAdded];
     int nChanges = 0;
@@ -383,7 +401,7 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
     int nZerocoinStartHeight = GetZerocoinStartHeight();
     pindex = chainActive[nZerocoinStartHeight];
     while (pindex->nHeight < nAccStartHeight) {
-        nMintsAdded += count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), coin.getDenomination());
+        nMintsAdded += pindex->mintDenominationsInBlock.Count(coin.getDenomination());
         pindex = chainActive[pindex->nHeight + 1];
     }
 
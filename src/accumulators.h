@@ -12,6 +12,11 @@
 #include "uint256.h"
 
 bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError);
+/** Height of the block holding the mint of coin; needs cs_main */
+bool GetCoinMintHeight(const libzerocoin::PublicCoin& coin, int& nHeightMintAdded);
+/** Witness for a coin minted at nHeightMintAdded. Takes no locks, so it can
+ *  run on worker threads while the caller holds cs_main */
+bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, int nHeightMintAdded, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError);
 bool GetAccumulatorValueFromDB(uint256 nCheckpoint, libzerocoin::CoinDenomination denom, CBigNum& bnAccValue);
 bool GetAccumulatorValueFromChecksum(uint32_t nChecksum, bool fMemoryOnly, CBigNum& bnAccValue);
 void AddAccumulatorChecksum(const uint32_t nChecksum, const CBigNum &bnValue, bool fMemoryOnly);
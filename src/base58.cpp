@@ -4,6 +4,7 @@
 
 #include "base58.h"
 
+#include "addressindex.h"
 #include "hash.h"
 #include "uint256.h"
 
@@ -288,6 +289,23 @@ bool CBitcoinAddress::GetKeyID(CKeyID& keyID) const
     return true;
 }
 
+bool CBitcoinAddress::GetIndexKey(uint160& hashBytes, int& type) const
+{
+    if (!IsValid())
+        return false;
+    if (vchVersion == Params().Base58Prefix(CChainParams::PUBKEY_ADDRESS)) {
+        memcpy(hashBytes.begin(), &vchData[0], 20);
+        type = ADDRESS_TYPE_PUBKEYHASH;
+        return true;
+    }
+    if (vchVersion == Params().Base58Prefix(CChainParams::SCRIPT_ADDRESS)) {
+        memcpy(hashBytes.begin(), &vchData[0], 20);
+        type = ADDRESS_TYPE_SCRIPTHASH;
+        return true;
+    }
+    return false;
+}
+
 bool CBitcoinAddress::IsScript() const
 {
     return IsValid() && vchVersion == Params().Base58Prefix(CChainParams::SCRIPT_ADDRESS);
@@ -0,0 +1,125 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockmap.h"
+
+#include "main.h"
+#include "util.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CBlockFileMapCache blockFileMaps;
+
+bool CMappedFile::Open(const boost::filesystem::path& path)
+{
+    Close();
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    pbegin = (const unsigned char*)p;
+    nLength = (uint64_t)st.st_size;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CMappedFile::Close()
+{
+#ifndef WIN32
+    if (pbegin)
+        munmap((void*)pbegin, (size_t)nLength);
+#endif
+    pbegin = NULL;
+    nLength = 0;
+}
+
+void CBlockFileMapCache::SetMaxFiles(size_t nMaxFilesIn)
+{
+    LOCK(cs);
+    nMaxFiles = nMaxFilesIn;
+    while (lruFiles.size() > nMaxFiles) {
+        mapFiles.erase(lruFiles.back());
+        lruFiles.pop_back();
+    }
+}
+
+bool CBlockFileMapCache::IsEnabled() const
+{
+    LOCK(cs);
+    return nMaxFiles > 0;
+}
+
+boost::shared_ptr<CMappedFile> CBlockFileMapCache::Get(int nFile, uint64_t nMinLength)
+{
+    LOCK(cs);
+    if (nMaxFiles == 0)
+        return boost::shared_ptr<CMappedFile>();
+
+    std::map<int, std::pair<boost::shared_ptr<CMappedFile>, std::list<int>::iterator> >::iterator it = mapFiles.find(nFile);
+    if (it != mapFiles.end()) {
+        lruFiles.splice(lruFiles.begin(), lruFiles, it->second.second);
+        if (it->second.first->size() >= nMinLength)
+            return it->second.first;
+
+        // The file has grown since it was mapped; readers still holding the
+        // old mapping keep it alive until they are done.
+        lruFiles.erase(it->second.second);
+        mapFiles.erase(it);
+    }
+
+    boost::shared_ptr<CMappedFile> file(new CMappedFile());
+    if (!file->Open(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk")) || file->size() < nMinLength)
+        return boost::shared_ptr<CMappedFile>();
+
+    lruFiles.push_front(nFile);
+    mapFiles[nFile] = std::make_pair(file, lruFiles.begin());
+    while (lruFiles.size() > nMaxFiles) {
+        mapFiles.erase(lruFiles.back());
+        lruFiles.pop_back();
+    }
+    return file;
+}
+
+void CBlockFileMapCache::Invalidate(int nFile)
+{
+    LOCK(cs);
+    std::map<int, std::pair<boost::shared_ptr<CMappedFile>, std::list<int>::iterator> >::iterator it = mapFiles.find(nFile);
+    if (it == mapFiles.end())
+        return;
+    lruFiles.erase(it->second.second);
+    mapFiles.erase(it);
+}
+
+void CBlockFileMapCache::Clear()
+{
+    LOCK(cs);
+    mapFiles.clear();
+    lruFiles.clear();
+}
+
+size_t CBlockFileMapCache::Size() const
+{
+    LOCK(cs);
+    return mapFiles.size();
+}
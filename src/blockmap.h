@@ -0,0 +1,126 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKMAP_H
+#define BITCOIN_BLOCKMAP_H
+
+#include "serialize.h"
+#include "sync.h"
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string.h>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/shared_ptr.hpp>
+
+/** Default for -blockmapfiles: number of blk?????.dat files kept memory-mapped for block reads */
+static const unsigned int DEFAULT_BLOCK_MAP_FILES = sizeof(void*) >= 8 ? 8 : 0;
+
+/**
+ * A read-only memory mapping of a whole file. Mappings are only available on
+ * POSIX systems; elsewhere Open() fails and callers use regular file reads.
+ */
+class CMappedFile
+{
+private:
+    // Disallow copies
+    CMappedFile(const CMappedFile&);
+    CMappedFile& operator=(const CMappedFile&);
+
+    const unsigned char* pbegin;
+    uint64_t nLength;
+
+public:
+    CMappedFile() : pbegin(NULL), nLength(0) {}
+    ~CMappedFile() { Close(); }
+
+    bool Open(const boost::filesystem::path& path);
+    void Close();
+
+    bool IsNull() const { return pbegin == NULL; }
+    const unsigned char* begin() const { return pbegin; }
+    uint64_t size() const { return nLength; }
+};
+
+/**
+ * Minimal deserialization stream over a range of a CMappedFile. Reads copy
+ * straight from the mapped pages into the destination object.
+ */
+class CMappedFileReader
+{
+private:
+    boost::shared_ptr<CMappedFile> file; //! keeps the mapping alive while reading
+    const unsigned char* pcur;
+    const unsigned char* pend;
+    int nType;
+    int nVersion;
+
+public:
+    CMappedFileReader(const boost::shared_ptr<CMappedFile>& fileIn, uint64_t nPos, uint64_t nSize, int nTypeIn, int nVersionIn)
+        : file(fileIn), nType(nTypeIn), nVersion(nVersionIn)
+    {
+        pcur = file->begin() + nPos;
+        pend = pcur + nSize;
+    }
+
+    //
+    // Stream subset
+    //
+    int GetType() { return nType; }
+    int GetVersion() { return nVersion; }
+
+    CMappedFileReader& read(char* pch, size_t nSize)
+    {
+        if (nSize > (size_t)(pend - pcur))
+            throw std::ios_base::failure("CMappedFileReader::read : end of data");
+        memcpy(pch, pcur, nSize);
+        pcur += nSize;
+        return (*this);
+    }
+
+    template <typename T>
+    CMappedFileReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/**
+ * Bounded LRU cache of mapped block files, so repeated block reads (rescans,
+ * getblock, serving peers, witness generation) skip the fopen/fseek/fread
+ * round trip of OpenBlockFile. A mapping is remapped when a read reaches past
+ * its end (the file has grown), and must be invalidated whenever the file is
+ * truncated or removed.
+ */
+class CBlockFileMapCache
+{
+private:
+    mutable CCriticalSection cs;
+    size_t nMaxFiles;
+    std::list<int> lruFiles; //! most recently used first
+    std::map<int, std::pair<boost::shared_ptr<CMappedFile>, std::list<int>::iterator> > mapFiles;
+
+public:
+    CBlockFileMapCache() : nMaxFiles(DEFAULT_BLOCK_MAP_FILES) {}
+
+    /** Limit the number of mapped files; 0 disables mapping altogether */
+    void SetMaxFiles(size_t nMaxFilesIn);
+    bool IsEnabled() const;
+
+    /** Return a mapping of blk file nFile covering at least nMinLength bytes, or an empty pointer */
+    boost::shared_ptr<CMappedFile> Get(int nFile, uint64_t nMinLength);
+    /** Drop the mapping of a file that is about to be truncated or deleted */
+    void Invalidate(int nFile);
+    void Clear();
+    size_t Size() const;
+};
+
+/** Mapped block files used by ReadBlockFromDisk */
+extern CBlockFileMapCache blockFileMaps;
+
+#endif // BITCOIN_BLOCKMAP_H
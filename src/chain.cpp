@@ -61,6 +61,28 @@ const CBlockIndex* CChain::FindFork(const CBlockIndex* pindex) const
     return pindex;
 }
 
+void* CBlockIndexArena::Allocate()
+{
+    if (nSize == vChunks.size() * nChunkEntries)
+        vChunks.push_back(static_cast<CBlockIndex*>(::operator new(nChunkEntries * sizeof(CBlockIndex))));
+    CBlockIndex* p = vChunks[nSize / nChunkEntries] + nSize % nChunkEntries;
+    nSize++;
+    return p;
+}
+
+void CBlockIndexArena::Truncate(size_t nSizeIn)
+{
+    while (nSize > nSizeIn) {
+        nSize--;
+        (vChunks[nSize / nChunkEntries] + nSize % nChunkEntries)->~CBlockIndex();
+    }
+    // Release the chunks that no longer hold any entry
+    while (vChunks.size() * nChunkEntries >= nSize + nChunkEntries) {
+        ::operator delete(vChunks.back());
+        vChunks.pop_back();
+    }
+}
+
 uint256 CBlockIndex::GetBlockTrust() const
 {
     uint256 bnTarget;
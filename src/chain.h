@@ -14,6 +14,9 @@
 #include "util.h"
 #include "libzerocoin/Denominations.h"
 
+#include <algorithm>
+#include <new>
+#include <stdexcept>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -100,6 +103,146 @@ enum BlockStatus {
     BLOCK_FAILED_MASK = BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 };
 
+/** Zerocoin supply of each denomination, in one fixed slot per entry of
+ * zerocoinDenomList. Serialized exactly like the
+ * std::map<CoinDenomination, int64_t> it replaces in the block index.
+ */
+class CZerocoinSupply
+{
+private:
+    int64_t nSupply[libzerocoin::ZEROCOIN_DENOM_COUNT];
+
+    static int Index(libzerocoin::CoinDenomination denom)
+    {
+        int nIndex = libzerocoin::ZerocoinDenominationToIndex(denom);
+        if (nIndex < 0)
+            throw std::out_of_range("CZerocoinSupply::at : invalid denomination");
+        return nIndex;
+    }
+
+public:
+    CZerocoinSupply()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        std::fill(nSupply, nSupply + libzerocoin::ZEROCOIN_DENOM_COUNT, 0);
+    }
+
+    int64_t& at(libzerocoin::CoinDenomination denom) { return nSupply[Index(denom)]; }
+    const int64_t& at(libzerocoin::CoinDenomination denom) const { return nSupply[Index(denom)]; }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return GetSizeOfCompactSize(libzerocoin::ZEROCOIN_DENOM_COUNT) +
+               libzerocoin::ZEROCOIN_DENOM_COUNT * (sizeof(int) + sizeof(int64_t));
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        WriteCompactSize(s, libzerocoin::ZEROCOIN_DENOM_COUNT);
+        for (int i = 0; i < libzerocoin::ZEROCOIN_DENOM_COUNT; i++) {
+            ::Serialize(s, libzerocoin::zerocoinDenomList[i], nType, nVersion);
+            ::Serialize(s, nSupply[i], nType, nVersion);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        SetNull();
+        unsigned int nSize = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nSize; i++) {
+            libzerocoin::CoinDenomination denom;
+            int64_t nValue;
+            ::Unserialize(s, denom, nType, nVersion);
+            ::Unserialize(s, nValue, nType, nVersion);
+            int nIndex = libzerocoin::ZerocoinDenominationToIndex(denom);
+            if (nIndex >= 0)
+                nSupply[nIndex] = nValue;
+        }
+    }
+};
+
+/** Number of zerocoin mints of each denomination in one block. Serialized
+ * exactly like the std::vector<CoinDenomination> it replaces in the block
+ * index, with the mints listed in denomination order.
+ */
+class CBlockMintDenominations
+{
+private:
+    //! Every mint output carries a public coin of hundreds of bytes, so a block holds far fewer than 65536 mints
+    uint16_t nMints[libzerocoin::ZEROCOIN_DENOM_COUNT];
+
+public:
+    CBlockMintDenominations()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        std::fill(nMints, nMints + libzerocoin::ZEROCOIN_DENOM_COUNT, 0);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    unsigned int size() const
+    {
+        unsigned int nSize = 0;
+        for (int i = 0; i < libzerocoin::ZEROCOIN_DENOM_COUNT; i++)
+            nSize += nMints[i];
+        return nSize;
+    }
+
+    //! Record one mint; mints of an invalid denomination are not counted
+    void push_back(libzerocoin::CoinDenomination denom)
+    {
+        int nIndex = libzerocoin::ZerocoinDenominationToIndex(denom);
+        if (nIndex >= 0)
+            nMints[nIndex]++;
+    }
+
+    int Count(libzerocoin::CoinDenomination denom) const
+    {
+        int nIndex = libzerocoin::ZerocoinDenominationToIndex(denom);
+        return nIndex < 0 ? 0 : nMints[nIndex];
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return GetSizeOfCompactSize(size()) + size() * sizeof(int);
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        WriteCompactSize(s, size());
+        for (int i = 0; i < libzerocoin::ZEROCOIN_DENOM_COUNT; i++) {
+            for (int j = 0; j < nMints[i]; j++)
+                ::Serialize(s, libzerocoin::zerocoinDenomList[i], nType, nVersion);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        clear();
+        unsigned int nSize = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nSize; i++) {
+            libzerocoin::CoinDenomination denom;
+            ::Unserialize(s, denom, nType, nVersion);
+            push_back(denom);
+        }
+    }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -120,9 +263,6 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
-    //ppcoin: trust score of block chain
-    uint256 bnChainTrust;
-
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -179,8 +319,8 @@ public:
     uint32_t nSequenceId;
     
     //! zerocoin specific fields
-    std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
-    std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
+    CZerocoinSupply zerocoinSupply;
+    CBlockMintDenominations mintDenominationsInBlock;
     
     void SetNull()
     {
@@ -212,10 +352,8 @@ public:
         nNonce = 0;
         nAccumulatorCheckpoint = 0;
         // Start supply of each denomination with 0s
-        for (auto& denom : libzerocoin::zerocoinDenomList) {
-            mapZerocoinSupply.insert(make_pair(denom, 0));
-        }
-        vMintDenominationsInBlock.clear();
+        zerocoinSupply.SetNull();
+        mintDenominationsInBlock.clear();
     }
 
     CBlockIndex()
@@ -236,7 +374,6 @@ public:
             nAccumulatorCheckpoint = block.nAccumulatorCheckpoint;
 
         //Proof of Stake
-        bnChainTrust = uint256();
         nMint = 0;
         nMoneySupply = 0;
         nFlags = 0;
@@ -293,14 +430,14 @@ public:
     {
         int64_t nTotal = 0;
         for (auto& denom : libzerocoin::zerocoinDenomList) {
-            nTotal += libzerocoin::ZerocoinDenominationToAmount(denom) * mapZerocoinSupply.at(denom);
+            nTotal += libzerocoin::ZerocoinDenominationToAmount(denom) * zerocoinSupply.at(denom);
         }
         return nTotal;
     }
 
     bool MintedDenomination(libzerocoin::CoinDenomination denom) const
     {
-        return std::find(vMintDenominationsInBlock.begin(), vMintDenominationsInBlock.end(), denom) != vMintDenominationsInBlock.end();
+        return mintDenominationsInBlock.Count(denom) > 0;
     }
 
     uint256 GetBlockHash() const
@@ -479,8 +616,8 @@ public:
         READWRITE(nNonce);
         if(this->nVersion > 3) {
             READWRITE(nAccumulatorCheckpoint);
-            READWRITE(mapZerocoinSupply);
-            READWRITE(vMintDenominationsInBlock);
+            READWRITE(zerocoinSupply);
+            READWRITE(mintDenominationsInBlock);
         }
 
     }
@@ -510,6 +647,43 @@ public:
     }
 };
 
+/**
+ * Owns block index entries, constructed in place in large contiguous chunks.
+ * Entries keep their address until destroyed, and are only destroyed in
+ * bulk, newest first. Neighbouring entries share cache lines and pages instead
+ * of being scattered across the heap between other allocations, and freeing
+ * the whole index costs one deallocation per chunk.
+ */
+class CBlockIndexArena
+{
+private:
+    //! Entries per chunk
+    static const size_t nChunkEntries = 4096;
+
+    std::vector<CBlockIndex*> vChunks;
+    size_t nSize;
+
+    // Disallow copies
+    CBlockIndexArena(const CBlockIndexArena&);
+    CBlockIndexArena& operator=(const CBlockIndexArena&);
+
+    //! Uninitialized storage for one more entry
+    void* Allocate();
+
+public:
+    CBlockIndexArena() : nSize(0) {}
+    ~CBlockIndexArena() { Clear(); }
+
+    CBlockIndex* Create() { return new (Allocate()) CBlockIndex(); }
+    CBlockIndex* Create(const CBlock& block) { return new (Allocate()) CBlockIndex(block); }
+
+    //! Number of live entries
+    size_t Size() const { return nSize; }
+    //! Destroy every entry created after the first nSizeIn
+    void Truncate(size_t nSizeIn);
+    void Clear() { Truncate(0); }
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain
 {
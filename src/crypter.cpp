@@ -293,6 +293,22 @@ bool CCryptoKeyStore::AddCryptedKey(const CPubKey& vchPubKey, const std::vector<
     return true;
 }
 
+bool CCryptoKeyStore::EncryptWithMasterKey(const CKeyingMaterial& vchPlaintext, const uint256& nIV, std::vector<unsigned char>& vchCiphertext) const
+{
+    LOCK(cs_KeyStore);
+    if (!IsCrypted() || vMasterKey.empty())
+        return false;
+    return EncryptSecret(vMasterKey, vchPlaintext, nIV, vchCiphertext);
+}
+
+bool CCryptoKeyStore::DecryptWithMasterKey(const std::vector<unsigned char>& vchCiphertext, const uint256& nIV, CKeyingMaterial& vchPlaintext) const
+{
+    LOCK(cs_KeyStore);
+    if (!IsCrypted() || vMasterKey.empty())
+        return false;
+    return DecryptSecret(vMasterKey, vchCiphertext, nIV, vchPlaintext);
+}
+
 bool CCryptoKeyStore::GetKey(const CKeyID& address, CKey& keyOut) const
 {
     {
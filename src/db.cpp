@@ -218,7 +218,17 @@ void CDBEnv::CheckpointLSN(const std::string& strFile)
 }
 
 
-CDB::CDB(const std::string& strFilename, const char* pszMode) : pdb(NULL), activeTxn(NULL)
+DbTxn* CDBEnv::GetBatchTxn(const std::string& strFile)
+{
+    LOCK(cs_db);
+    if (mapBatchTxn.empty())
+        return NULL;
+    std::map<std::pair<std::string, boost::thread::id>, DbTxn*>::const_iterator it = mapBatchTxn.find(std::make_pair(strFile, boost::this_thread::get_id()));
+    return it == mapBatchTxn.end() ? NULL : it->second;
+}
+
+
+CDB::CDB(const std::string& strFilename, const char* pszMode) : pdb(NULL), activeTxn(NULL), fBatchOwner(false)
 {
     int ret;
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
@@ -278,7 +288,8 @@ CDB::CDB(const std::string& strFilename, const char* pszMode) : pdb(NULL), activ
 
 void CDB::Flush()
 {
-    if (activeTxn)
+    // The batch owner flushes once it has committed
+    if (activeTxn || bitdb.GetBatchTxn(strFile))
         return;
 
     // Flush database activity from memory pool to disk log
@@ -289,10 +300,46 @@ void CDB::Flush()
     bitdb.dbenv.txn_checkpoint(nMinutes ? GetArg("-dblogsize", 100) * 1024 : 0, nMinutes, 0);
 }
 
+bool CDB::BatchBegin()
+{
+    if (!pdb || activeTxn)
+        return false;
+    if (bitdb.GetBatchTxn(strFile))
+        return true;
+    if (!TxnBegin())
+        return false;
+    {
+        LOCK(bitdb.cs_db);
+        bitdb.mapBatchTxn[std::make_pair(strFile, boost::this_thread::get_id())] = activeTxn;
+    }
+    fBatchOwner = true;
+    return true;
+}
+
+bool CDB::BatchCommit()
+{
+    if (!fBatchOwner)
+        return true;
+    {
+        LOCK(bitdb.cs_db);
+        bitdb.mapBatchTxn.erase(std::make_pair(strFile, boost::this_thread::get_id()));
+    }
+    fBatchOwner = false;
+    bool fCommitted = TxnCommit();
+    Flush();
+    return fCommitted;
+}
+
 void CDB::Close()
 {
     if (!pdb)
         return;
+    if (fBatchOwner) {
+        // Never committed: the writes of the whole batch are dropped
+        LOCK(bitdb.cs_db);
+        bitdb.mapBatchTxn.erase(std::make_pair(strFile, boost::this_thread::get_id()));
+        fBatchOwner = false;
+    }
     if (activeTxn)
         activeTxn->abort();
     activeTxn = NULL;
@@ -17,6 +17,7 @@
 #include <vector>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/thread.hpp>
 
 #include <db_cxx.h>
 
@@ -46,6 +47,8 @@ public:
     DbEnv dbenv;
     std::map<std::string, int> mapFileUseCount;
     std::map<std::string, Db*> mapDb;
+    //! open write batches by file and owning thread, see CDB::BatchBegin()
+    std::map<std::pair<std::string, boost::thread::id>, DbTxn*> mapBatchTxn;
 
     CDBEnv();
     ~CDBEnv();
@@ -88,6 +91,9 @@ public:
             return NULL;
         return ptxn;
     }
+
+    /** The batch transaction the calling thread has open on strFile, or NULL */
+    DbTxn* GetBatchTxn(const std::string& strFile);
 };
 
 extern CDBEnv bitdb;
@@ -101,6 +107,7 @@ protected:
     std::string strFile;
     DbTxn* activeTxn;
     bool fReadOnly;
+    bool fBatchOwner;
 
     explicit CDB(const std::string& strFilename, const char* pszMode = "r+");
     ~CDB() { Close(); }
@@ -114,6 +121,12 @@ private:
     void operator=(const CDB&);
 
 protected:
+    /** Our own transaction, else the batch this thread has open on the file */
+    DbTxn* GetTxn()
+    {
+        return activeTxn ? activeTxn : bitdb.GetBatchTxn(strFile);
+    }
+
     template <typename K, typename T>
     bool Read(const K& key, T& value)
     {
@@ -129,7 +142,7 @@ protected:
         // Read
         Dbt datValue;
         datValue.set_flags(DB_DBT_MALLOC);
-        int ret = pdb->get(activeTxn, &datKey, &datValue, 0);
+        int ret = pdb->get(GetTxn(), &datKey, &datValue, 0);
         memset(datKey.get_data(), 0, datKey.get_size());
         if (datValue.get_data() == NULL)
             return false;
@@ -169,7 +182,7 @@ protected:
         Dbt datValue(&ssValue[0], ssValue.size());
 
         // Write
-        int ret = pdb->put(activeTxn, &datKey, &datValue, (fOverwrite ? 0 : DB_NOOVERWRITE));
+        int ret = pdb->put(GetTxn(), &datKey, &datValue, (fOverwrite ? 0 : DB_NOOVERWRITE));
 
         // Clear memory in case it was a private key
         memset(datKey.get_data(), 0, datKey.get_size());
@@ -192,7 +205,7 @@ protected:
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Erase
-        int ret = pdb->del(activeTxn, &datKey, 0);
+        int ret = pdb->del(GetTxn(), &datKey, 0);
 
         // Clear memory
         memset(datKey.get_data(), 0, datKey.get_size());
@@ -212,7 +225,7 @@ protected:
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Exists
-        int ret = pdb->exists(activeTxn, &datKey, 0);
+        int ret = pdb->exists(GetTxn(), &datKey, 0);
 
         // Clear memory
         memset(datKey.get_data(), 0, datKey.get_size());
@@ -224,7 +237,7 @@ protected:
         if (!pdb)
             return NULL;
         Dbc* pcursor = NULL;
-        int ret = pdb->cursor(NULL, &pcursor, 0);
+        int ret = pdb->cursor(bitdb.GetBatchTxn(strFile), &pcursor, 0);
         if (ret != 0)
             return NULL;
         return pcursor;
@@ -268,6 +281,17 @@ protected:
     }
 
 public:
+    /**
+     * Start a write batch: until BatchCommit(), every CDB the calling thread
+     * uses on this file, however short-lived, reads and writes through one
+     * transaction and skips its checkpoint on close. The batch is committed
+     * and flushed once, saving a checkpoint per handle and a log commit per
+     * write. Cursors must be closed before the batch is committed. Starting
+     * a batch inside an open one on the same file just joins it.
+     */
+    bool BatchBegin();
+    bool BatchCommit();
+
     bool TxnBegin()
     {
         if (!pdb || activeTxn)
@@ -0,0 +1,186 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_EXPIRINGMAP_H
+#define BITCOIN_EXPIRINGMAP_H
+
+#include "serialize.h"
+#include "utiltime.h"
+
+#include <deque>
+#include <utility>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
+/**
+ * STL-like hash map whose entries expire nTimeout seconds after they were
+ * first inserted and that holds at most nMaxSize entries, dropping the
+ * oldest ones first. Expired entries are evicted a few at a time as new
+ * ones are inserted, so no periodic scan of the whole map is needed.
+ *
+ * A timeout or maximum size of 0 disables that limit. Serializes like a
+ * std::map with the same key and value types.
+ */
+template <typename K, typename V, typename Hash = boost::hash<K> >
+class expiringmap
+{
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<const key_type, mapped_type> value_type;
+    typedef typename boost::unordered_map<K, V, Hash>::iterator iterator;
+    typedef typename boost::unordered_map<K, V, Hash>::const_iterator const_iterator;
+    typedef typename boost::unordered_map<K, V, Hash>::size_type size_type;
+
+protected:
+    boost::unordered_map<K, V, Hash> map;
+    //! Time each entry expires at
+    boost::unordered_map<K, int64_t, Hash> mapExpire;
+    //! Keys by insertion, with the expiry they got; stale for erased keys
+    std::deque<std::pair<int64_t, K> > queue;
+    int64_t nTimeout;
+    size_type nMaxSize;
+    uint64_t nEvicted;
+
+    //! Record a new entry; the newest entry itself is never evicted here
+    void track(const key_type& k)
+    {
+        int64_t nExpire = nTimeout ? GetTime() + nTimeout : 0;
+        mapExpire[k] = nExpire;
+        queue.push_back(std::make_pair(nExpire, k));
+        evict();
+    }
+
+    //! Drop the queue head, and its entry if the head is still current
+    void pop_front()
+    {
+        typename boost::unordered_map<K, int64_t, Hash>::iterator it = mapExpire.find(queue.front().second);
+        if (it != mapExpire.end() && it->second == queue.front().first) {
+            map.erase(it->first);
+            mapExpire.erase(it);
+            nEvicted++;
+        }
+        queue.pop_front();
+    }
+
+    void evict()
+    {
+        int64_t nNow = GetTime();
+        while (!queue.empty() && ((nMaxSize && map.size() > nMaxSize) || (queue.front().first && queue.front().first <= nNow)))
+            pop_front();
+        // Erased keys leave stale queue entries behind; drop them once they
+        // outnumber the live ones
+        if (queue.size() > 2 * map.size() + 64) {
+            std::deque<std::pair<int64_t, K> > queueLive;
+            for (size_t i = 0; i < queue.size(); i++) {
+                typename boost::unordered_map<K, int64_t, Hash>::const_iterator it = mapExpire.find(queue[i].second);
+                if (it != mapExpire.end() && it->second == queue[i].first)
+                    queueLive.push_back(queue[i]);
+            }
+            queue.swap(queueLive);
+        }
+    }
+
+public:
+    expiringmap(int64_t nTimeoutIn = 0, size_type nMaxSizeIn = 0) : nTimeout(nTimeoutIn), nMaxSize(nMaxSizeIn), nEvicted(0) {}
+
+    iterator begin() { return map.begin(); }
+    iterator end() { return map.end(); }
+    const_iterator begin() const { return map.begin(); }
+    const_iterator end() const { return map.end(); }
+    size_type size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+    iterator find(const key_type& k) { return map.find(k); }
+    const_iterator find(const key_type& k) const { return map.find(k); }
+    size_type count(const key_type& k) const { return map.count(k); }
+
+    std::pair<iterator, bool> insert(const value_type& x)
+    {
+        std::pair<iterator, bool> ret = map.insert(x);
+        if (ret.second)
+            track(x.first);
+        return ret;
+    }
+
+    mapped_type& operator[](const key_type& k)
+    {
+        std::pair<iterator, bool> ret = map.insert(value_type(k, mapped_type()));
+        if (ret.second)
+            track(k);
+        return ret.first->second;
+    }
+
+    size_type erase(const key_type& k)
+    {
+        mapExpire.erase(k);
+        return map.erase(k);
+    }
+
+    iterator erase(iterator it)
+    {
+        mapExpire.erase(it->first);
+        return map.erase(it);
+    }
+
+    void clear()
+    {
+        map.clear();
+        mapExpire.clear();
+        queue.clear();
+    }
+
+    void swap(expiringmap& other)
+    {
+        map.swap(other.map);
+        mapExpire.swap(other.mapExpire);
+        queue.swap(other.queue);
+    }
+
+    //! Evict the expired entries without waiting for an insert
+    void expire() { evict(); }
+
+    int64_t timeout() const { return nTimeout; }
+    size_type max_size() const { return nMaxSize; }
+    //! Entries dropped because they expired or the map was full
+    uint64_t evicted() const { return nEvicted; }
+
+    //! Estimate of the heap memory used, not counting memory owned by the values
+    size_t memory_usage() const
+    {
+        return map.size() * (sizeof(value_type) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*) +
+               mapExpire.size() * (sizeof(std::pair<const K, int64_t>) + 2 * sizeof(void*)) + mapExpire.bucket_count() * sizeof(void*) +
+               queue.size() * sizeof(std::pair<int64_t, K>);
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        unsigned int nSize = GetSizeOfCompactSize(map.size());
+        for (const_iterator it = map.begin(); it != map.end(); ++it)
+            nSize += ::GetSerializeSize(*it, nType, nVersion);
+        return nSize;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        WriteCompactSize(s, map.size());
+        for (const_iterator it = map.begin(); it != map.end(); ++it)
+            ::Serialize(s, *it, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        clear();
+        unsigned int nSize = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nSize; i++) {
+            std::pair<K, V> item;
+            ::Unserialize(s, item, nType, nVersion);
+            insert(value_type(item.first, item.second));
+        }
+    }
+};
+
+#endif // BITCOIN_EXPIRINGMAP_H
@@ -381,8 +381,11 @@ bool CheckProofOfStake(const CBlock block, uint256& hashProofOfStake)
     // First try finding the previous transaction in database
     uint256 hashBlock;
     CTransaction txPrev;
-    if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
+    if (!GetTransactionOutputs(txin.prevout.hash, txPrev, hashBlock))
         return error("CheckProofOfStake() : INFO: read txPrev failed");
+    // Rebuilt from the coins view once pruned, txPrev holds only the outputs still unspent
+    if (txin.prevout.n >= txPrev.vout.size() || txPrev.vout[txin.prevout.n].IsNull())
+        return error("CheckProofOfStake() : INFO: stake output %s:%u not available", txin.prevout.hash.ToString().c_str(), txin.prevout.n);
 
     //verify signature and script
     if (!VerifyScript(txin.scriptSig, txPrev.vout[txin.prevout.n].scriptPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
@@ -395,10 +398,9 @@ bool CheckProofOfStake(const CBlock block, uint256& hashProofOfStake)
     else
         return error("CheckProofOfStake() : read block failed");
 
-    // Read block header
-    CBlock blockprev;
-    if (!ReadBlockFromDisk(blockprev, pindex->GetBlockPos()))
-        return error("CheckProofOfStake(): INFO: failed to find block");
+    // Only the header of the block holding the kernel input is needed; take it from the
+    // index so this still works once the block file itself has been pruned.
+    CBlock blockprev(pindex->GetBlockHeader());
 
     unsigned int nInterval = 0;
     unsigned int nTime = block.nTime;
@@ -59,6 +59,18 @@ public:
 
         batch.Delete(slKey);
     }
+
+    //! Queue an already serialized key and value
+    void WriteRaw(const leveldb::Slice& slKey, const leveldb::Slice& slValue)
+    {
+        batch.Put(slKey, slValue);
+    }
+
+    //! Queue the removal of an already serialized key
+    void EraseRaw(const leveldb::Slice& slKey)
+    {
+        batch.Delete(slKey);
+    }
 };
 
 class CLevelDBWrapper
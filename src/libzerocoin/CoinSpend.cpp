@@ -14,7 +14,7 @@
 #include <iostream>
 namespace libzerocoin
 {
-CoinSpend::CoinSpend(const ZerocoinParams* p, const PrivateCoin& coin, Accumulator& a, const uint32_t checksum, const AccumulatorWitness& witness, const uint256& ptxHash) : accChecksum(checksum),
+CoinSpend::CoinSpend(const ZerocoinParams* p, const PrivateCoin& coin, Accumulator& a, const uint32_t checksum, const AccumulatorWitness& witness, const uint256& ptxHash, CoinSpendTimings* pTimings) : accChecksum(checksum),
                                                                                                                                                                              ptxHash(ptxHash),
                                                                                                                                                                              coinSerialNumber((coin.getSerialNumber())),
                                                                                                                                                                              accumulatorPoK(&p->accumulatorParams),
@@ -43,15 +43,24 @@ CoinSpend::CoinSpend(const ZerocoinParams* p, const PrivateCoin& coin, Accumulat
     this->accCommitmentToCoinValue = fullCommitmentToCoinUnderAccParams.getCommitmentValue();
 
     // 2. Generate a ZK proof that the two commitments contain the same public coin.
+    int64_t nStart = GetTimeMicros();
     this->commitmentPoK = CommitmentProofOfKnowledge(&p->serialNumberSoKCommitmentGroup, &p->accumulatorParams.accumulatorPoKCommitmentGroup, fullCommitmentToCoinUnderSerialParams, fullCommitmentToCoinUnderAccParams);
+    int64_t nCommitmentDone = GetTimeMicros();
 
     // Now generate the two core ZK proofs:
     // 3. Proves that the committed public coin is in the Accumulator (PoK of "witness")
     this->accumulatorPoK = AccumulatorProofOfKnowledge(&p->accumulatorParams, fullCommitmentToCoinUnderAccParams, witness, a);
+    int64_t nAccumulatorDone = GetTimeMicros();
 
     // 4. Proves that the coin is correct w.r.t. serial number and hidden coin secret
     // (This proof is bound to the coin 'metadata', i.e., transaction hash)
     this->serialNumberSoK = SerialNumberSignatureOfKnowledge(p, coin, fullCommitmentToCoinUnderSerialParams, signatureHash());
+
+    if (pTimings) {
+        pTimings->nCommitmentPoK = nCommitmentDone - nStart;
+        pTimings->nAccumulatorPoK = nAccumulatorDone - nCommitmentDone;
+        pTimings->nSerialNumberSoK = GetTimeMicros() - nAccumulatorDone;
+    }
 }
 
 bool CoinSpend::Verify(const Accumulator& a) const
@@ -25,6 +25,15 @@
 
 namespace libzerocoin
 {
+/** Microseconds spent on each proof while constructing a CoinSpend */
+struct CoinSpendTimings {
+    int64_t nCommitmentPoK;
+    int64_t nAccumulatorPoK;
+    int64_t nSerialNumberSoK;
+
+    CoinSpendTimings() : nCommitmentPoK(0), nAccumulatorPoK(0), nSerialNumberSoK(0) {}
+};
+
 /** The complete proof needed to spend a zerocoin.
  * Composes together a proof that a coin is accumulated
  * and that it has a given serial number.
@@ -62,7 +71,7 @@ public:
 	 * @param a hash of the partial transaction that contains this coin spend
 	 * @throw ZerocoinException if the process fails
 	 */
-    CoinSpend(const ZerocoinParams* p, const PrivateCoin& coin, Accumulator& a, const uint32_t checksum, const AccumulatorWitness& witness, const uint256& ptxHash);
+    CoinSpend(const ZerocoinParams* p, const PrivateCoin& coin, Accumulator& a, const uint32_t checksum, const AccumulatorWitness& witness, const uint256& ptxHash, CoinSpendTimings* pTimings = NULL);
 
     /** Returns the serial number of the coin spend by this proof.
 	 *
@@ -0,0 +1,123 @@
+/**
+ * @file       FixedBaseExp.cpp
+ *
+ * @brief      Precomputed fixed-base modular exponentiation for the Zerocoin library.
+ **/
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "FixedBaseExp.h"
+
+namespace libzerocoin {
+
+FixedBaseExp::FixedBaseExp(const CBigNum& baseIn, const CBigNum& modulusIn, int nExpBits, const CBigNum& orderIn)
+	: base(baseIn), modulus(modulusIn), order(0), nRows(0), mont(NULL)
+{
+	if (modulus <= 1 || !BN_is_odd(&modulus) || nExpBits <= 0)
+		return;
+
+	CAutoBN_CTX ctx;
+	mont = BN_MONT_CTX_new();
+	if (!mont || !BN_MONT_CTX_set(mont, &modulus, ctx))
+		throw bignum_error("FixedBaseExp : BN_MONT_CTX_set failed");
+
+	// Exponents are only reduced by an order the base provably has
+	if (orderIn > 0 && base.pow_mod(orderIn, modulus) == 1) {
+		order = orderIn;
+		nExpBits = std::max(nExpBits, BN_num_bits(&order));
+	}
+
+	CBigNum one(1);
+	if (!BN_to_montgomery(&montOne, &one, mont, ctx))
+		throw bignum_error("FixedBaseExp : BN_to_montgomery failed");
+
+	nRows = (nExpBits + FIXED_BASE_WINDOW - 1) / FIXED_BASE_WINDOW;
+	const int nDigits = 1 << FIXED_BASE_WINDOW;
+	table.resize(nRows * nDigits);
+
+	CBigNum rowBase = base % modulus;
+	if (!BN_to_montgomery(&rowBase, &rowBase, mont, ctx))
+		throw bignum_error("FixedBaseExp : BN_to_montgomery failed");
+	for (int row = 0; row < nRows; row++) {
+		table[row * nDigits] = montOne;
+		table[row * nDigits + 1] = rowBase;
+		for (int d = 2; d < nDigits; d++) {
+			if (!BN_mod_mul_montgomery(&table[row * nDigits + d], &table[row * nDigits + d - 1], &rowBase, mont, ctx))
+				throw bignum_error("FixedBaseExp : BN_mod_mul_montgomery failed");
+		}
+		// base^(2^((row + 1) * FIXED_BASE_WINDOW))
+		if (!BN_mod_mul_montgomery(&rowBase, &table[row * nDigits + nDigits - 1], &rowBase, mont, ctx))
+			throw bignum_error("FixedBaseExp : BN_mod_mul_montgomery failed");
+	}
+}
+
+FixedBaseExp::~FixedBaseExp()
+{
+	if (mont)
+		BN_MONT_CTX_free(mont);
+}
+
+bool FixedBaseExp::normalize(const CBigNum& e, CBigNum& eRet) const
+{
+	if (!mont)
+		return false;
+	if (!BN_is_negative(&e) && BN_num_bits(&e) <= nRows * FIXED_BASE_WINDOW) {
+		eRet = e;
+		return true;
+	}
+	if (order == 0)
+		return false;
+	eRet = e % order;
+	return true;
+}
+
+void FixedBaseExp::accumulate(CBigNum& acc, const CBigNum& e, BN_CTX* ctx) const
+{
+	const int nDigits = 1 << FIXED_BASE_WINDOW;
+	const int nBits = BN_num_bits(&e);
+	for (int row = 0; row * FIXED_BASE_WINDOW < nBits; row++) {
+		int d = 0;
+		for (int bit = 0; bit < FIXED_BASE_WINDOW; bit++) {
+			if (BN_is_bit_set(&e, row * FIXED_BASE_WINDOW + bit))
+				d |= 1 << bit;
+		}
+		if (d && !BN_mod_mul_montgomery(&acc, &acc, &table[row * nDigits + d], mont, ctx))
+			throw bignum_error("FixedBaseExp : BN_mod_mul_montgomery failed");
+	}
+}
+
+CBigNum FixedBaseExp::pow(const CBigNum& e) const
+{
+	CBigNum eNorm;
+	if (!normalize(e, eNorm))
+		return base.pow_mod(e, modulus);
+
+	CAutoBN_CTX ctx;
+	CBigNum acc = montOne;
+	accumulate(acc, eNorm, ctx);
+	CBigNum ret;
+	if (!BN_from_montgomery(&ret, &acc, mont, ctx))
+		throw bignum_error("FixedBaseExp::pow : BN_from_montgomery failed");
+	return ret;
+}
+
+CBigNum FixedBaseExp::mulPow(const CBigNum& e, const FixedBaseExp& other, const CBigNum& eOther) const
+{
+	CBigNum eNorm, eOtherNorm;
+	if (other.modulus != modulus || !normalize(e, eNorm) || !other.normalize(eOther, eOtherNorm))
+		return pow(e).mul_mod(other.pow(eOther), modulus);
+
+	// Both tables share the Montgomery representation, so one accumulator
+	// collects the digits of both exponents
+	CAutoBN_CTX ctx;
+	CBigNum acc = montOne;
+	accumulate(acc, eNorm, ctx);
+	other.accumulate(acc, eOtherNorm, ctx);
+	CBigNum ret;
+	if (!BN_from_montgomery(&ret, &acc, mont, ctx))
+		throw bignum_error("FixedBaseExp::mulPow : BN_from_montgomery failed");
+	return ret;
+}
+
+} /* namespace libzerocoin */
@@ -0,0 +1,75 @@
+/**
+ * @file       FixedBaseExp.h
+ *
+ * @brief      Precomputed fixed-base modular exponentiation for the Zerocoin library.
+ **/
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FIXEDBASEEXP_H_
+#define FIXEDBASEEXP_H_
+
+#include "bignum.h"
+
+#include <vector>
+
+namespace libzerocoin {
+
+/** Exponent bits covered by one row of a FixedBaseExp table */
+static const int FIXED_BASE_WINDOW = 4;
+
+/**
+ * Powers of one base, precomputed so that base^e mod modulus costs one
+ * Montgomery multiplication per FIXED_BASE_WINDOW bits of e and no squarings.
+ *
+ * Results are always identical to CBigNum::pow_mod. When the base is
+ * confirmed to have the given order, negative and oversized exponents are
+ * reduced modulo that order; otherwise exponents the table does not cover
+ * are handed to pow_mod.
+ */
+class FixedBaseExp {
+public:
+	/**
+	 * @param base      the fixed base
+	 * @param modulus   odd modulus; an even one disables the table
+	 * @param nExpBits  largest exponent size, in bits, the table covers
+	 * @param order     the order of base, or 0 if unknown
+	 */
+	FixedBaseExp(const CBigNum& base, const CBigNum& modulus, int nExpBits, const CBigNum& order = CBigNum(0));
+	~FixedBaseExp();
+
+	const CBigNum& getBase() const { return base; }
+	const CBigNum& getModulus() const { return modulus; }
+
+	/** @return base^e mod modulus */
+	CBigNum pow(const CBigNum& e) const;
+
+	/**
+	 * Simultaneous exponentiation with a second table over the same modulus.
+	 * @return base^e * other.base^eOther mod modulus
+	 */
+	CBigNum mulPow(const CBigNum& e, const FixedBaseExp& other, const CBigNum& eOther) const;
+
+private:
+	CBigNum base;
+	CBigNum modulus;
+	CBigNum order;    //! 0 unless base^order == 1 was checked
+	int nRows;
+	BN_MONT_CTX* mont;
+	CBigNum montOne;
+	//! table[row << FIXED_BASE_WINDOW | d] = base^(d * 2^(row * FIXED_BASE_WINDOW)), Montgomery form
+	std::vector<CBigNum> table;
+
+	FixedBaseExp(const FixedBaseExp&);
+	FixedBaseExp& operator=(const FixedBaseExp&);
+
+	/** Bring e into the range the table covers; false if it cannot be */
+	bool normalize(const CBigNum& e, CBigNum& eRet) const;
+	/** acc *= base^e for a normalized e, in Montgomery form */
+	void accumulate(CBigNum& acc, const CBigNum& e, BN_CTX* ctx) const;
+};
+
+} /* namespace libzerocoin */
+
+#endif /* FIXEDBASEEXP_H_ */
@@ -12,6 +12,12 @@
 // Copyright (c) 2017 The PIVX developers
 #include <streams.h>
 #include "SerialNumberSignatureOfKnowledge.h"
+#include "FixedBaseExp.h"
+#include "sync.h"
+
+#include <map>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace libzerocoin {
 
@@ -121,7 +127,90 @@ inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const CBig
 	return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
 }
 
+namespace {
+/** Tables for the generators the serial number proof raises to per-round exponents */
+struct SerialNumberProofTables {
+	FixedBaseExp b; // coinCommitmentGroup.h, in the group of order serialNumberSoKCommitmentGroup.groupOrder
+	FixedBaseExp g; // serialNumberSoKCommitmentGroup.g
+	FixedBaseExp h; // serialNumberSoKCommitmentGroup.h
+
+	SerialNumberProofTables(const ZerocoinParams* p) :
+		b(p->coinCommitmentGroup.h, p->serialNumberSoKCommitmentGroup.groupOrder, BN_num_bits(&p->coinCommitmentGroup.groupOrder), p->coinCommitmentGroup.groupOrder),
+		g(p->serialNumberSoKCommitmentGroup.g, p->serialNumberSoKCommitmentGroup.modulus, BN_num_bits(&p->serialNumberSoKCommitmentGroup.groupOrder), p->serialNumberSoKCommitmentGroup.groupOrder),
+		h(p->serialNumberSoKCommitmentGroup.h, p->serialNumberSoKCommitmentGroup.modulus, BN_num_bits(&p->serialNumberSoKCommitmentGroup.groupOrder), p->serialNumberSoKCommitmentGroup.groupOrder) {}
+
+	bool Matches(const ZerocoinParams* p) const
+	{
+		return b.getBase() == p->coinCommitmentGroup.h && b.getModulus() == p->serialNumberSoKCommitmentGroup.groupOrder &&
+		       g.getBase() == p->serialNumberSoKCommitmentGroup.g && h.getBase() == p->serialNumberSoKCommitmentGroup.h &&
+		       g.getModulus() == p->serialNumberSoKCommitmentGroup.modulus;
+	}
+};
+
+CCriticalSection cs_proofTables;
+std::map<const ZerocoinParams*, boost::shared_ptr<const SerialNumberProofTables> > mapProofTables;
+
+/** Tables for p, built on first use and shared by all verifying threads */
+boost::shared_ptr<const SerialNumberProofTables> GetProofTables(const ZerocoinParams* p)
+{
+	LOCK(cs_proofTables);
+	boost::shared_ptr<const SerialNumberProofTables>& tables = mapProofTables[p];
+	if (!tables || !tables->Matches(p))
+		tables.reset(new SerialNumberProofTables(p));
+	return tables;
+}
+} // anon namespace
+
 bool SerialNumberSignatureOfKnowledge::Verify(const CBigNum& coinSerialNumber, const CBigNum& valueOfCommitmentToCoin,
+        const uint256 msghash) const {
+	if (s_notprime.size() < params->zkp_iterations || sprime.size() < params->zkp_iterations)
+		return false;
+
+	boost::shared_ptr<const SerialNumberProofTables> tables = GetProofTables(params);
+	const CBigNum& q = params->serialNumberSoKCommitmentGroup.groupOrder;
+	const CBigNum& p = params->serialNumberSoKCommitmentGroup.modulus;
+	CHashWriter hasher(0,0);
+	hasher << *params << valueOfCommitmentToCoin << coinSerialNumber << msghash;
+
+	unsigned char *hashbytes = (unsigned char*) &this->hash;
+	uint32_t nZeroBits = 0;
+	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+		if (!((hashbytes[i / 8] >> (i % 8)) & 0x01))
+			nZeroBits++;
+	}
+
+	// a^serial is the same in every round. The commitment is raised to a
+	// fresh exponent in every round with a zero challenge bit, which pays
+	// for a table of its own once there are a few of them.
+	const CBigNum aSerial = params->coinCommitmentGroup.g.pow_mod(coinSerialNumber, q);
+	boost::scoped_ptr<FixedBaseExp> commitmentTable;
+	if (nZeroBits >= 8)
+		commitmentTable.reset(new FixedBaseExp(valueOfCommitmentToCoin, p, BN_num_bits(&q)));
+
+	vector<CBigNum> tprime(params->zkp_iterations);
+	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+		int bit = i % 8;
+		int byte = i / 8;
+		bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
+		if(challenge_bit) {
+			// g^{a^serial b^s} h^v, see challengeCalculation()
+			CBigNum exponent = (aSerial * tables->b.pow(s_notprime[i])) % q;
+			tprime[i] = tables->g.mulPow(exponent, tables->h, SeedTo1024(sprime[i].getuint256()));
+		} else {
+			CBigNum exp = tables->b.pow(s_notprime[i]);
+			if (commitmentTable)
+				tprime[i] = commitmentTable->mulPow(exp, tables->h, sprime[i]);
+			else
+				tprime[i] = valueOfCommitmentToCoin.pow_mod(exp, p).mul_mod(tables->h.pow(sprime[i]), p);
+		}
+	}
+	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+		hasher << tprime[i];
+	}
+	return hasher.GetHash() == hash;
+}
+
+bool SerialNumberSignatureOfKnowledge::VerifyReference(const CBigNum& coinSerialNumber, const CBigNum& valueOfCommitmentToCoin,
         const uint256 msghash) const {
 	CBigNum a = params->coinCommitmentGroup.g;
 	CBigNum b = params->coinCommitmentGroup.h;
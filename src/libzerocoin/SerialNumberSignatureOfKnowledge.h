@@ -45,11 +45,17 @@ public:
 	SerialNumberSignatureOfKnowledge(const ZerocoinParams* p, const PrivateCoin& coin, const Commitment& commitmentToCoin, uint256 msghash);
 
 	/** Verifies the Signature of knowledge.
+	 *
+	 * Uses precomputed tables for the group generators and for the
+	 * commitment, see FixedBaseExp; the result is always that of
+	 * VerifyReference().
 	 *
 	 * @param msghash hash of meta data to create a signature of knowledge on.
 	 * @return
 	 */
 	bool Verify(const CBigNum& coinSerialNumber, const CBigNum& valueOfCommitmentToCoin,const uint256 msghash) const;
+	/** Verifies the Signature of knowledge with one full exponentiation per term, for tests and benchmarks */
+	bool VerifyReference(const CBigNum& coinSerialNumber, const CBigNum& valueOfCommitmentToCoin,const uint256 msghash) const;
 	ADD_SERIALIZE_METHODS;
   template <typename Stream, typename Operation>  inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
 	    READWRITE(s_notprime);
@@ -11,6 +11,7 @@
 #include "masternode-budget.h"
 #include "masternode-sync.h"
 #include "masternode.h"
+#include "masternodecachedb.h"
 #include "masternodeman.h"
 #include "obfuscation.h"
 #include "util.h"
@@ -102,7 +103,7 @@ void CBudgetManager::CheckOrphanVotes()
 
 
     std::string strError = "";
-    std::map<uint256, CBudgetVote>::iterator it1 = mapOrphanMasternodeBudgetVotes.begin();
+    expiringmap<uint256, CBudgetVote, BlockHasher>::iterator it1 = mapOrphanMasternodeBudgetVotes.begin();
     while (it1 != mapOrphanMasternodeBudgetVotes.end()) {
         if (budget.UpdateProposal(((*it1).second), NULL, strError)) {
             LogPrint("masternode","CBudgetManager::CheckOrphanVotes - Proposal/Budget is known, activating and removing orphan vote\n");
@@ -111,7 +112,7 @@ void CBudgetManager::CheckOrphanVotes()
             ++it1;
         }
     }
-    std::map<uint256, CFinalizedBudgetVote>::iterator it2 = mapOrphanFinalizedBudgetVotes.begin();
+    expiringmap<uint256, CFinalizedBudgetVote, BlockHasher>::iterator it2 = mapOrphanFinalizedBudgetVotes.begin();
     while (it2 != mapOrphanFinalizedBudgetVotes.end()) {
         if (budget.UpdateFinalizedBudget(((*it2).second), NULL, strError)) {
             LogPrint("masternode","CBudgetManager::CheckOrphanVotes - Proposal/Budget is known, activating and removing orphan vote\n");
@@ -370,33 +371,6 @@ CBudgetDB::ReadResult CBudgetDB::Read(CBudgetManager& objToLoad, bool fDryRun)
     return Ok;
 }
 
-void DumpBudgets()
-{
-    int64_t nStart = GetTimeMillis();
-
-    CBudgetDB budgetdb;
-    CBudgetManager tempBudget;
-
-    LogPrint("masternode","Verifying budget.dat format...\n");
-    CBudgetDB::ReadResult readResult = budgetdb.Read(tempBudget, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CBudgetDB::FileError)
-        LogPrint("masternode","Missing budgets file - budget.dat, will try to recreate\n");
-    else if (readResult != CBudgetDB::Ok) {
-        LogPrint("masternode","Error reading budget.dat: ");
-        if (readResult == CBudgetDB::IncorrectFormat)
-            LogPrint("masternode","magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint("masternode","file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint("masternode","Writting info to budget.dat...\n");
-    budgetdb.Write(budget);
-
-    LogPrint("masternode","Budget dump finished  %dms\n", GetTimeMillis() - nStart);
-}
-
 bool CBudgetManager::AddFinalizedBudget(CFinalizedBudget& finalizedBudget)
 {
     std::string strError = "";
@@ -424,14 +398,70 @@ bool CBudgetManager::AddProposal(CBudgetProposal& budgetProposal)
     }
 
     mapProposals.insert(make_pair(budgetProposal.GetHash(), budgetProposal));
+    InvalidateBudgetCache();
     LogPrint("masternode","CBudgetManager::AddProposal - proposal %s added\n", budgetProposal.GetName ().c_str ());
     return true;
 }
 
+template <typename Map>
+static void PutBudgetObjects(CMasternodeCacheDB& db, char chType, const Map& mapObjects)
+{
+    for (typename Map::const_iterator it = mapObjects.begin(); it != mapObjects.end(); ++it)
+        db.Put(chType, it->first, it->second);
+}
+
+void CBudgetManager::WriteCache(CMasternodeCacheDB& db)
+{
+    LOCK(cs);
+    PutBudgetObjects(db, 'P', mapSeenMasternodeBudgetProposals);
+    PutBudgetObjects(db, 'V', mapSeenMasternodeBudgetVotes);
+    PutBudgetObjects(db, 'F', mapSeenFinalizedBudgets);
+    PutBudgetObjects(db, 'f', mapSeenFinalizedBudgetVotes);
+    PutBudgetObjects(db, 'O', mapOrphanMasternodeBudgetVotes);
+    PutBudgetObjects(db, 'o', mapOrphanFinalizedBudgetVotes);
+    PutBudgetObjects(db, 'R', mapProposals);
+    PutBudgetObjects(db, 'B', mapFinalizedBudgets);
+}
+
+bool CBudgetManager::ReadCache(CMasternodeCacheDB& db)
+{
+    CBudgetManager loaded;
+    if (!db.Load('P', loaded.mapSeenMasternodeBudgetProposals) ||
+        !db.Load('V', loaded.mapSeenMasternodeBudgetVotes) ||
+        !db.Load('F', loaded.mapSeenFinalizedBudgets) ||
+        !db.Load('f', loaded.mapSeenFinalizedBudgetVotes) ||
+        !db.Load('O', loaded.mapOrphanMasternodeBudgetVotes) ||
+        !db.Load('o', loaded.mapOrphanFinalizedBudgetVotes) ||
+        !db.Load('R', loaded.mapProposals) ||
+        !db.Load('B', loaded.mapFinalizedBudgets))
+        return false;
+
+    LOCK(cs);
+    mapSeenMasternodeBudgetProposals.swap(loaded.mapSeenMasternodeBudgetProposals);
+    mapSeenMasternodeBudgetVotes.swap(loaded.mapSeenMasternodeBudgetVotes);
+    mapSeenFinalizedBudgets.swap(loaded.mapSeenFinalizedBudgets);
+    mapSeenFinalizedBudgetVotes.swap(loaded.mapSeenFinalizedBudgetVotes);
+    mapOrphanMasternodeBudgetVotes.swap(loaded.mapOrphanMasternodeBudgetVotes);
+    mapOrphanFinalizedBudgetVotes.swap(loaded.mapOrphanFinalizedBudgetVotes);
+    mapProposals.swap(loaded.mapProposals);
+    mapFinalizedBudgets.swap(loaded.mapFinalizedBudgets);
+    InvalidateBudgetCache();
+    return true;
+}
+
 void CBudgetManager::CheckAndRemove()
 {
     LogPrint("mnbudget", "CBudgetManager::CheckAndRemove\n");
 
+    {
+        // drop expired votes even while none are coming in
+        LOCK(cs);
+        mapSeenMasternodeBudgetVotes.expire();
+        mapOrphanMasternodeBudgetVotes.expire();
+        mapSeenFinalizedBudgetVotes.expire();
+        mapOrphanFinalizedBudgetVotes.expire();
+    }
+
     // map<uint256, CFinalizedBudget> tmpMapFinalizedBudgets;
     // map<uint256, CBudgetProposal> tmpMapProposals;
 
@@ -482,6 +512,12 @@ void CBudgetManager::CheckAndRemove()
     // mapFinalizedBudgets = tmpMapFinalizedBudgets;
     // mapProposals = tmpMapProposals;
 
+    {
+        // proposals were revalidated, and the masternodes whose votes count may have changed
+        LOCK(cs);
+        InvalidateBudgetCache();
+    }
+
     // LogPrint("mnbudget", "CBudgetManager::CheckAndRemove - mapFinalizedBudgets cleanup - size after: %d\n", mapFinalizedBudgets.size());
     // LogPrint("mnbudget", "CBudgetManager::CheckAndRemove - mapProposals cleanup - size after: %d\n", mapProposals.size());
     LogPrint("masternode","CBudgetManager::CheckAndRemove - PASSED\n");
@@ -702,14 +738,32 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget()
 {
     LOCK(cs);
 
+    CBlockIndex* pindexPrev = chainActive.Tip();
+    if (pindexPrev == NULL) return std::vector<CBudgetProposal*>();
+
+    int nBlockStart = pindexPrev->nHeight - pindexPrev->nHeight % GetBudgetPaymentCycleBlocks() + GetBudgetPaymentCycleBlocks();
+    int nBlockEnd = nBlockStart + GetBudgetPaymentCycleBlocks() - 1;
+    int nMasternodes = mnodeman.size();
+    int nEnabled = mnodeman.CountEnabled(ActiveProtocol());
+
+    // The budget only changes with the proposals and their votes (which
+    // invalidate the cache), the payment cycle, the masternode list (which
+    // decides which votes count) and proposals becoming established
+    if (fBudgetCacheValid && nBudgetCacheBlockStart == nBlockStart && nBudgetCacheMasternodes == nMasternodes &&
+        nBudgetCacheEnabled == nEnabled && (nBudgetCacheExpire == 0 || GetTime() <= nBudgetCacheExpire))
+        return vecBudgetCache;
+
     // ------- Sort budgets by Yes Count
 
     std::vector<std::pair<CBudgetProposal*, int> > vBudgetPorposalsSort;
 
+    int64_t nExpire = 0;
     std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin();
     while (it != mapProposals.end()) {
         (*it).second.CleanAndRemove(false);
         vBudgetPorposalsSort.push_back(make_pair(&((*it).second), (*it).second.GetYeas() - (*it).second.GetNays()));
+        if (!(*it).second.IsEstablished() && (nExpire == 0 || (*it).second.GetEstablishedTime() < nExpire))
+            nExpire = (*it).second.GetEstablishedTime();
         ++it;
     }
 
@@ -720,11 +774,6 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget()
     std::vector<CBudgetProposal*> vBudgetProposalsRet;
 
     CAmount nBudgetAllocated = 0;
-    CBlockIndex* pindexPrev = chainActive.Tip();
-    if (pindexPrev == NULL) return vBudgetProposalsRet;
-
-    int nBlockStart = pindexPrev->nHeight - pindexPrev->nHeight % GetBudgetPaymentCycleBlocks() + GetBudgetPaymentCycleBlocks();
-    int nBlockEnd = nBlockStart + GetBudgetPaymentCycleBlocks() - 1;
     CAmount nTotalBudget = GetTotalBudget(nBlockStart);
 
 
@@ -736,12 +785,12 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget()
         //prop start/end should be inside this period
         if (pbudgetProposal->fValid && pbudgetProposal->nBlockStart <= nBlockStart &&
             pbudgetProposal->nBlockEnd >= nBlockEnd &&
-            pbudgetProposal->GetYeas() - pbudgetProposal->GetNays() > mnodeman.CountEnabled(ActiveProtocol()) / 10 &&
+            pbudgetProposal->GetYeas() - pbudgetProposal->GetNays() > nEnabled / 10 &&
             pbudgetProposal->IsEstablished()) {
 
             LogPrint("masternode","CBudgetManager::GetBudget() -   Check 1 passed: valid=%d | %ld <= %ld | %ld >= %ld | Yeas=%d Nays=%d Count=%d | established=%d\n",
                       pbudgetProposal->fValid, pbudgetProposal->nBlockStart, nBlockStart, pbudgetProposal->nBlockEnd,
-                      nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), mnodeman.CountEnabled(ActiveProtocol()) / 10,
+                      nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), nEnabled / 10,
                       pbudgetProposal->IsEstablished());
 
             if (pbudgetProposal->GetAmount() + nBudgetAllocated <= nTotalBudget) {
@@ -757,13 +806,20 @@ std::vector<CBudgetProposal*> CBudgetManager::GetBudget()
         else {
             LogPrint("masternode","CBudgetManager::GetBudget() -   Check 1 failed: valid=%d | %ld <= %ld | %ld >= %ld | Yeas=%d Nays=%d Count=%d | established=%d\n",
                       pbudgetProposal->fValid, pbudgetProposal->nBlockStart, nBlockStart, pbudgetProposal->nBlockEnd,
-                      nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), mnodeman.CountEnabled(ActiveProtocol()) / 10,
+                      nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), nEnabled / 10,
                       pbudgetProposal->IsEstablished());
         }
 
         ++it2;
     }
 
+    vecBudgetCache = vBudgetProposalsRet;
+    fBudgetCacheValid = true;
+    nBudgetCacheBlockStart = nBlockStart;
+    nBudgetCacheMasternodes = nMasternodes;
+    nBudgetCacheEnabled = nEnabled;
+    nBudgetCacheExpire = nExpire;
+
     return vBudgetProposalsRet;
 }
 
@@ -964,6 +1020,8 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
     if (strCommand == "mnvs") { //Masternode vote sync
         uint256 nProp;
         vRecv >> nProp;
+        CSyncSetSummary summary;
+        if (!vRecv.empty()) vRecv >> summary;
 
         if (Params().NetworkID() == CBaseChainParams::MAIN) {
             if (nProp == 0) {
@@ -976,7 +1034,7 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             }
         }
 
-        Sync(pfrom, nProp);
+        Sync(pfrom, nProp, false, summary);
         LogPrint("mnbudget", "mnvs - Sent Masternode votes to peer %i\n", pfrom->GetId());
     }
 
@@ -1033,23 +1091,12 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             return;
         }
 
-
-        mapSeenMasternodeBudgetVotes.insert(make_pair(vote.GetHash(), vote));
-        if (!vote.SignatureValid(true)) {
-            LogPrint("masternode","mvote - signature invalid\n");
-            if (masternodeSync.IsSynced()) Misbehaving(pfrom->GetId(), 20);
-            // it could just be a non-synced masternode
-            mnodeman.AskForMN(pfrom, vote.vin);
+        // ThreadBudgetVotes checks the signature and applies the vote
+        if (!QueueVote(vote, pfrom)) {
+            LogPrint("masternode","mvote - too many pending votes, ignoring %s\n", vote.GetHash().ToString());
             return;
         }
-
-        std::string strError = "";
-        if (UpdateProposal(vote, pfrom, strError)) {
-            vote.Relay();
-            masternodeSync.AddedBudgetItem(vote.GetHash());
-        }
-
-        LogPrint("masternode","mvote - new budget vote for budget %s - %s\n", vote.nProposalHash.ToString(),  vote.GetHash().ToString());
+        mapSeenMasternodeBudgetVotes.insert(make_pair(vote.GetHash(), vote));
     }
 
     if (strCommand == "fbs") { //Finalized Budget Suggestion
@@ -1106,25 +1153,129 @@ void CBudgetManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             return;
         }
 
-        mapSeenFinalizedBudgetVotes.insert(make_pair(vote.GetHash(), vote));
-        if (!vote.SignatureValid(true)) {
-            LogPrint("masternode","fbvote - signature invalid\n");
-            if (masternodeSync.IsSynced()) Misbehaving(pfrom->GetId(), 20);
-            // it could just be a non-synced masternode
-            mnodeman.AskForMN(pfrom, vote.vin);
+        // ThreadBudgetVotes checks the signature and applies the vote
+        if (!QueueVote(vote, pfrom)) {
+            LogPrint("masternode","fbvote - too many pending votes, ignoring %s\n", vote.GetHash().ToString());
             return;
         }
+        mapSeenFinalizedBudgetVotes.insert(make_pair(vote.GetHash(), vote));
+    }
+}
+
+template <typename Vote>
+static bool QueuePendingVote(std::vector<std::pair<Vote, CNode*> >& vecPending, size_t nPending, const Vote& vote, CNode* pfrom)
+{
+    if (nPending >= MAX_BUDGET_PENDING_VOTES) return false;
+
+    {
+        // keep the peer around until its vote has been processed
+        LOCK(cs_vNodes);
+        pfrom->AddRef();
+    }
+    vecPending.push_back(std::make_pair(vote, pfrom));
+    return true;
+}
 
+bool CBudgetManager::QueueVote(const CBudgetVote& vote, CNode* pfrom)
+{
+    boost::unique_lock<boost::mutex> lock(cs_pending);
+    if (!QueuePendingVote(vecPendingVotes, vecPendingVotes.size() + vecPendingFinalizedVotes.size(), vote, pfrom))
+        return false;
+    condPending.notify_one();
+    return true;
+}
+
+bool CBudgetManager::QueueVote(const CFinalizedBudgetVote& vote, CNode* pfrom)
+{
+    boost::unique_lock<boost::mutex> lock(cs_pending);
+    if (!QueuePendingVote(vecPendingFinalizedVotes, vecPendingVotes.size() + vecPendingFinalizedVotes.size(), vote, pfrom))
+        return false;
+    condPending.notify_one();
+    return true;
+}
+
+template <typename Vote>
+static bool CheckPendingVote(Vote& vote, CNode* pfrom, const char* strCommand)
+{
+    if (vote.SignatureValid(true)) return true;
+
+    LogPrint("masternode","%s - signature invalid\n", strCommand);
+    if (masternodeSync.IsSynced()) {
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), 20);
+    }
+    // it could just be a non-synced masternode
+    mnodeman.AskForMN(pfrom, vote.vin);
+    return false;
+}
+
+void CBudgetManager::ProcessPendingVotes()
+{
+    std::vector<std::pair<CBudgetVote, CNode*> > vecVotes;
+    std::vector<std::pair<CFinalizedBudgetVote, CNode*> > vecFinalizedVotes;
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        while (vecPendingVotes.empty() && vecPendingFinalizedVotes.empty())
+            condPending.wait(lock);
+        vecVotes.swap(vecPendingVotes);
+        vecFinalizedVotes.swap(vecPendingFinalizedVotes);
+    }
+
+    // Check the signatures first, without holding up the message handler
+    std::vector<bool> vValid(vecVotes.size());
+    for (unsigned int i = 0; i < vecVotes.size(); i++)
+        vValid[i] = CheckPendingVote(vecVotes[i].first, vecVotes[i].second, "mvote");
+    std::vector<bool> vFinalizedValid(vecFinalizedVotes.size());
+    for (unsigned int i = 0; i < vecFinalizedVotes.size(); i++)
+        vFinalizedValid[i] = CheckPendingVote(vecFinalizedVotes[i].first, vecFinalizedVotes[i].second, "fbvote");
+
+    // Then apply the whole batch at once
+    {
+        LOCK(cs_budget);
         std::string strError = "";
-        if (UpdateFinalizedBudget(vote, pfrom, strError)) {
-            vote.Relay();
-            masternodeSync.AddedBudgetItem(vote.GetHash());
+        for (unsigned int i = 0; i < vecVotes.size(); i++) {
+            if (!vValid[i]) continue;
+            CBudgetVote& vote = vecVotes[i].first;
+            if (UpdateProposal(vote, vecVotes[i].second, strError)) {
+                vote.Relay();
+                masternodeSync.AddedBudgetItem(vote.GetHash());
+            }
 
-            LogPrint("masternode","fbvote - new finalized budget vote - %s\n", vote.GetHash().ToString());
-        } else {
-            LogPrint("masternode","fbvote - rejected finalized budget vote - %s - %s\n", vote.GetHash().ToString(), strError);
+            LogPrint("masternode","mvote - new budget vote for budget %s - %s\n", vote.nProposalHash.ToString(),  vote.GetHash().ToString());
+        }
+        for (unsigned int i = 0; i < vecFinalizedVotes.size(); i++) {
+            if (!vFinalizedValid[i]) continue;
+            CFinalizedBudgetVote& vote = vecFinalizedVotes[i].first;
+            if (UpdateFinalizedBudget(vote, vecFinalizedVotes[i].second, strError)) {
+                vote.Relay();
+                masternodeSync.AddedBudgetItem(vote.GetHash());
+
+                LogPrint("masternode","fbvote - new finalized budget vote - %s\n", vote.GetHash().ToString());
+            } else {
+                LogPrint("masternode","fbvote - rejected finalized budget vote - %s - %s\n", vote.GetHash().ToString(), strError);
+            }
         }
     }
+
+    {
+        LOCK(cs_vNodes);
+        for (unsigned int i = 0; i < vecVotes.size(); i++)
+            vecVotes[i].second->Release();
+        for (unsigned int i = 0; i < vecFinalizedVotes.size(); i++)
+            vecFinalizedVotes[i].second->Release();
+    }
+
+    LogPrint("mnbudget", "CBudgetManager::ProcessPendingVotes - %u votes, %u finalized budget votes\n", vecVotes.size(), vecFinalizedVotes.size());
+}
+
+void ThreadBudgetVotes()
+{
+    if (fLiteMode) return; //disable all Masternode related functionality
+
+    RenameThread("tpc-budgetvotes");
+
+    while (true)
+        budget.ProcessPendingVotes();
 }
 
 bool CBudgetManager::PropExists(uint256 nHash)
@@ -1208,7 +1359,7 @@ void CBudgetManager::MarkSynced()
 }
 
 
-void CBudgetManager::Sync(CNode* pfrom, uint256 nProp, bool fPartial)
+void CBudgetManager::Sync(CNode* pfrom, uint256 nProp, bool fPartial, const CSyncSetSummary& summary)
 {
     LOCK(cs);
 
@@ -1219,22 +1370,24 @@ void CBudgetManager::Sync(CNode* pfrom, uint256 nProp, bool fPartial)
         budget object to see if they're OK. If all checks pass, we'll send it to the peer.
     */
 
-    int nInvCount = 0;
+    std::vector<CInv> vInv;
 
     std::map<uint256, CBudgetProposalBroadcast>::iterator it1 = mapSeenMasternodeBudgetProposals.begin();
     while (it1 != mapSeenMasternodeBudgetProposals.end()) {
         CBudgetProposal* pbudgetProposal = FindProposal((*it1).first);
         if (pbudgetProposal && pbudgetProposal->fValid && (nProp == 0 || (*it1).first == nProp)) {
-            pfrom->PushInventory(CInv(MSG_BUDGET_PROPOSAL, (*it1).second.GetHash()));
-            nInvCount++;
+            vInv.push_back(CInv(MSG_BUDGET_PROPOSAL, (*it1).second.GetHash()));
 
             //send votes
             std::map<uint256, CBudgetVote>::iterator it2 = pbudgetProposal->mapVotes.begin();
             while (it2 != pbudgetProposal->mapVotes.end()) {
                 if ((*it2).second.fValid) {
                     if ((fPartial && !(*it2).second.fSynced) || !fPartial) {
-                        pfrom->PushInventory(CInv(MSG_BUDGET_VOTE, (*it2).second.GetHash()));
-                        nInvCount++;
+                        uint256 nVoteHash = (*it2).second.GetHash();
+                        // votes of long running proposals may have expired from the seen map,
+                        // put them back so the getdata that follows can be served
+                        mapSeenMasternodeBudgetVotes.insert(make_pair(nVoteHash, (*it2).second));
+                        vInv.push_back(CInv(MSG_BUDGET_VOTE, nVoteHash));
                     }
                 }
                 ++it2;
@@ -1243,26 +1396,20 @@ void CBudgetManager::Sync(CNode* pfrom, uint256 nProp, bool fPartial)
         ++it1;
     }
 
-    pfrom->PushMessage("ssc", MASTERNODE_SYNC_BUDGET_PROP, nInvCount);
-
-    LogPrint("mnbudget", "CBudgetManager::Sync - sent %d items\n", nInvCount);
-
-    nInvCount = 0;
-
     std::map<uint256, CFinalizedBudgetBroadcast>::iterator it3 = mapSeenFinalizedBudgets.begin();
     while (it3 != mapSeenFinalizedBudgets.end()) {
         CFinalizedBudget* pfinalizedBudget = FindFinalizedBudget((*it3).first);
         if (pfinalizedBudget && pfinalizedBudget->fValid && (nProp == 0 || (*it3).first == nProp)) {
-            pfrom->PushInventory(CInv(MSG_BUDGET_FINALIZED, (*it3).second.GetHash()));
-            nInvCount++;
+            vInv.push_back(CInv(MSG_BUDGET_FINALIZED, (*it3).second.GetHash()));
 
             //send votes
             std::map<uint256, CFinalizedBudgetVote>::iterator it4 = pfinalizedBudget->mapVotes.begin();
             while (it4 != pfinalizedBudget->mapVotes.end()) {
                 if ((*it4).second.fValid) {
                     if ((fPartial && !(*it4).second.fSynced) || !fPartial) {
-                        pfrom->PushInventory(CInv(MSG_BUDGET_FINALIZED_VOTE, (*it4).second.GetHash()));
-                        nInvCount++;
+                        uint256 nVoteHash = (*it4).second.GetHash();
+                        mapSeenFinalizedBudgetVotes.insert(make_pair(nVoteHash, (*it4).second));
+                        vInv.push_back(CInv(MSG_BUDGET_FINALIZED_VOTE, nVoteHash));
                     }
                 }
                 ++it4;
@@ -1271,8 +1418,94 @@ void CBudgetManager::Sync(CNode* pfrom, uint256 nProp, bool fPartial)
         ++it3;
     }
 
-    pfrom->PushMessage("ssc", MASTERNODE_SYNC_BUDGET_FIN, nInvCount);
-    LogPrint("mnbudget", "CBudgetManager::Sync - sent %d items\n", nInvCount);
+    // the summary covers proposals and finalized budgets with their votes
+    summary.FilterKnown(vInv);
+
+    int nInvCountProp = 0;
+    int nInvCountFin = 0;
+    BOOST_FOREACH (const CInv& inv, vInv) {
+        pfrom->PushInventory(inv);
+        if (inv.type == MSG_BUDGET_PROPOSAL || inv.type == MSG_BUDGET_VOTE)
+            nInvCountProp++;
+        else
+            nInvCountFin++;
+    }
+
+    pfrom->PushMessage("ssc", MASTERNODE_SYNC_BUDGET_PROP, nInvCountProp);
+    LogPrint("mnbudget", "CBudgetManager::Sync - sent %d items\n", nInvCountProp);
+
+    pfrom->PushMessage("ssc", MASTERNODE_SYNC_BUDGET_FIN, nInvCountFin);
+    LogPrint("mnbudget", "CBudgetManager::Sync - sent %d items\n", nInvCountFin);
+}
+
+bool CBudgetManager::GetBudgetVote(const uint256& nHash, CBudgetVote& voteRet)
+{
+    LOCK(cs);
+
+    expiringmap<uint256, CBudgetVote, BlockHasher>::iterator itSeen = mapSeenMasternodeBudgetVotes.find(nHash);
+    if (itSeen != mapSeenMasternodeBudgetVotes.end()) {
+        voteRet = itSeen->second;
+        return true;
+    }
+
+    for (std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin(); it != mapProposals.end(); ++it) {
+        for (std::map<uint256, CBudgetVote>::iterator it2 = it->second.mapVotes.begin(); it2 != it->second.mapVotes.end(); ++it2) {
+            if (it2->second.GetHash() == nHash) {
+                voteRet = it2->second;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CBudgetManager::GetFinalizedBudgetVote(const uint256& nHash, CFinalizedBudgetVote& voteRet)
+{
+    LOCK(cs);
+
+    expiringmap<uint256, CFinalizedBudgetVote, BlockHasher>::iterator itSeen = mapSeenFinalizedBudgetVotes.find(nHash);
+    if (itSeen != mapSeenFinalizedBudgetVotes.end()) {
+        voteRet = itSeen->second;
+        return true;
+    }
+
+    for (std::map<uint256, CFinalizedBudget>::iterator it = mapFinalizedBudgets.begin(); it != mapFinalizedBudgets.end(); ++it) {
+        for (std::map<uint256, CFinalizedBudgetVote>::iterator it2 = it->second.mapVotes.begin(); it2 != it->second.mapVotes.end(); ++it2) {
+            if (it2->second.GetHash() == nHash) {
+                voteRet = it2->second;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+CSyncSetSummary CBudgetManager::GetSyncSummary()
+{
+    LOCK(cs);
+
+    // what a full Sync() of a peer with the same budgets would announce;
+    // mapProposals and mapFinalizedBudgets are keyed by the broadcast hashes
+    std::vector<uint256> vHash;
+    for (std::map<uint256, CBudgetProposal>::iterator it = mapProposals.begin(); it != mapProposals.end(); ++it) {
+        if (!it->second.fValid) continue;
+        vHash.push_back(it->first);
+        for (std::map<uint256, CBudgetVote>::iterator itVote = it->second.mapVotes.begin(); itVote != it->second.mapVotes.end(); ++itVote) {
+            if (itVote->second.fValid) vHash.push_back(itVote->second.GetHash());
+        }
+    }
+    for (std::map<uint256, CFinalizedBudget>::iterator it = mapFinalizedBudgets.begin(); it != mapFinalizedBudgets.end(); ++it) {
+        if (!it->second.fValid) continue;
+        vHash.push_back(it->first);
+        for (std::map<uint256, CFinalizedBudgetVote>::iterator itVote = it->second.mapVotes.begin(); itVote != it->second.mapVotes.end(); ++itVote) {
+            if (itVote->second.fValid) vHash.push_back(itVote->second.GetHash());
+        }
+    }
+
+    CSyncSetSummary summary = CSyncSetSummary::ForItems(vHash.size());
+    BOOST_FOREACH (const uint256& hash, vHash)
+        summary.Add(hash);
+    return summary;
 }
 
 bool CBudgetManager::UpdateProposal(CBudgetVote& vote, CNode* pfrom, std::string& strError)
@@ -1299,7 +1532,11 @@ bool CBudgetManager::UpdateProposal(CBudgetVote& vote, CNode* pfrom, std::string
     }
 
 
-    return mapProposals[vote.nProposalHash].AddOrUpdateVote(vote, strError);
+    if (!mapProposals[vote.nProposalHash].AddOrUpdateVote(vote, strError))
+        return false;
+
+    InvalidateBudgetCache();
+    return true;
 }
 
 bool CBudgetManager::UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pfrom, std::string& strError)
@@ -1335,6 +1572,9 @@ CBudgetProposal::CBudgetProposal()
     nBlockEnd = 0;
     nAmount = 0;
     nTime = 0;
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
     fValid = true;
 }
 
@@ -1347,6 +1587,9 @@ CBudgetProposal::CBudgetProposal(std::string strProposalNameIn, std::string strU
     address = addressIn;
     nAmount = nAmountIn;
     nFeeTXHash = nFeeTXHashIn;
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
     fValid = true;
 }
 
@@ -1361,6 +1604,9 @@ CBudgetProposal::CBudgetProposal(const CBudgetProposal& other)
     nTime = other.nTime;
     nFeeTXHash = other.nFeeTXHash;
     mapVotes = other.mapVotes;
+    nYeas = other.nYeas;
+    nNays = other.nNays;
+    nAbstains = other.nAbstains;
     fValid = true;
 }
 
@@ -1468,7 +1714,14 @@ bool CBudgetProposal::AddOrUpdateVote(CBudgetVote& vote, std::string& strError)
         return false;
     }
 
-    mapVotes[hash] = vote;
+    std::map<uint256, CBudgetVote>::iterator it = mapVotes.find(hash);
+    if (it != mapVotes.end()) {
+        CountVote(it->second, -1);
+        it->second = vote;
+    } else {
+        mapVotes.insert(std::make_pair(hash, vote));
+    }
+    CountVote(vote, 1);
     LogPrint("mnbudget", "CBudgetProposal::AddOrUpdateVote - %s %s\n", strAction.c_str(), vote.GetHash().ToString().c_str());
 
     return true;
@@ -1480,11 +1733,34 @@ void CBudgetProposal::CleanAndRemove(bool fSignatureCheck)
     std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin();
 
     while (it != mapVotes.end()) {
-        (*it).second.fValid = (*it).second.SignatureValid(fSignatureCheck);
+        bool fValidVote = (*it).second.SignatureValid(fSignatureCheck);
+        if (fValidVote != (*it).second.fValid) {
+            CountVote((*it).second, -1);
+            (*it).second.fValid = fValidVote;
+            CountVote((*it).second, 1);
+        }
         ++it;
     }
 }
 
+void CBudgetProposal::CountVote(const CBudgetVote& vote, int nDelta)
+{
+    if (!vote.fValid) return;
+
+    if (vote.nVote == VOTE_YES) nYeas += nDelta;
+    if (vote.nVote == VOTE_NO) nNays += nDelta;
+    if (vote.nVote == VOTE_ABSTAIN) nAbstains += nDelta;
+}
+
+void CBudgetProposal::RecountVotes()
+{
+    nYeas = 0;
+    nNays = 0;
+    nAbstains = 0;
+    for (std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin(); it != mapVotes.end(); ++it)
+        CountVote(it->second, 1);
+}
+
 double CBudgetProposal::GetRatio()
 {
     int yeas = 0;
@@ -1505,41 +1781,17 @@ double CBudgetProposal::GetRatio()
 
 int CBudgetProposal::GetYeas()
 {
-    int ret = 0;
-
-    std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin();
-    while (it != mapVotes.end()) {
-        if ((*it).second.nVote == VOTE_YES && (*it).second.fValid) ret++;
-        ++it;
-    }
-
-    return ret;
+    return nYeas;
 }
 
 int CBudgetProposal::GetNays()
 {
-    int ret = 0;
-
-    std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin();
-    while (it != mapVotes.end()) {
-        if ((*it).second.nVote == VOTE_NO && (*it).second.fValid) ret++;
-        ++it;
-    }
-
-    return ret;
+    return nNays;
 }
 
 int CBudgetProposal::GetAbstains()
 {
-    int ret = 0;
-
-    std::map<uint256, CBudgetVote>::iterator it = mapVotes.begin();
-    while (it != mapVotes.end()) {
-        if ((*it).second.nVote == VOTE_ABSTAIN && (*it).second.fValid) ret++;
-        ++it;
-    }
-
-    return ret;
+    return nAbstains;
 }
 
 int CBudgetProposal::GetBlockStartCycle()
@@ -7,10 +7,12 @@
 #define MASTERNODE_BUDGET_H
 
 #include "base58.h"
+#include "expiringmap.h"
 #include "init.h"
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
+#include "masternode-sync.h"
 #include "net.h"
 #include "sync.h"
 #include "util.h"
@@ -26,6 +28,7 @@ class CFinalizedBudget;
 class CBudgetProposal;
 class CBudgetProposalBroadcast;
 class CTxBudgetPayment;
+class CMasternodeCacheDB;
 
 #define VOTE_ABSTAIN 0
 #define VOTE_YES 1
@@ -34,12 +37,19 @@ class CTxBudgetPayment;
 static const CAmount PROPOSAL_FEE_TX = (50 * COIN);
 static const CAmount BUDGET_FEE_TX = (50 * COIN);
 static const int64_t BUDGET_VOTE_UPDATE_MIN = 60 * 60;
+//! Seen budget votes are forgotten after about one mainnet budget cycle
+static const int64_t BUDGET_SEEN_VOTE_EXPIRY = 30 * 24 * 60 * 60;
+static const unsigned int MAX_BUDGET_SEEN_VOTES = 200000;
+//! Votes for budget objects we don't know yet are kept for a day
+static const int64_t BUDGET_ORPHAN_VOTE_EXPIRY = 24 * 60 * 60;
+static const unsigned int MAX_BUDGET_ORPHAN_VOTES = 10000;
+//! Votes waiting for ThreadBudgetVotes to check them; more are dropped unseen
+static const unsigned int MAX_BUDGET_PENDING_VOTES = 50000;
 
 extern std::vector<CBudgetProposalBroadcast> vecImmatureBudgetProposals;
 extern std::vector<CFinalizedBudgetBroadcast> vecImmatureFinalizedBudgets;
 
 extern CBudgetManager budget;
-void DumpBudgets();
 
 // Define amount of blocks in budget payment cycle
 int GetBudgetPaymentCycleBlocks();
@@ -47,6 +57,9 @@ int GetBudgetPaymentCycleBlocks();
 //Check the collateral transaction for the budget proposal/finalized budget
 bool IsBudgetCollateralValid(uint256 nTxCollateralHash, uint256 nExpectedHash, std::string& strError, int64_t& nTime, int& nConf);
 
+//Check and apply the budget votes received from peers, in batches
+void ThreadBudgetVotes();
+
 //
 // CBudgetVote - Allow a masternode node to vote and broadcast throughout the network
 //
@@ -177,6 +190,24 @@ private:
     // XX42    map<uint256, CTransaction> mapCollateral;
     map<uint256, uint256> mapCollateralTxids;
 
+    // votes from peers waiting for their signature check, each with a reference on its sender
+    CWaitableCriticalSection cs_pending;
+    CConditionVariable condPending;
+    std::vector<std::pair<CBudgetVote, CNode*> > vecPendingVotes;
+    std::vector<std::pair<CFinalizedBudgetVote, CNode*> > vecPendingFinalizedVotes;
+
+    // result of the last GetBudget() and what it depends on besides the proposals
+    std::vector<CBudgetProposal*> vecBudgetCache;
+    bool fBudgetCacheValid;
+    int nBudgetCacheBlockStart;
+    int nBudgetCacheMasternodes;
+    int nBudgetCacheEnabled;
+    int64_t nBudgetCacheExpire;
+
+    void InvalidateBudgetCache() { fBudgetCacheValid = false; }
+    bool QueueVote(const CBudgetVote& vote, CNode* pfrom);
+    bool QueueVote(const CFinalizedBudgetVote& vote, CNode* pfrom);
+
 public:
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -186,13 +217,17 @@ public:
     map<uint256, CFinalizedBudget> mapFinalizedBudgets;
 
     std::map<uint256, CBudgetProposalBroadcast> mapSeenMasternodeBudgetProposals;
-    std::map<uint256, CBudgetVote> mapSeenMasternodeBudgetVotes;
-    std::map<uint256, CBudgetVote> mapOrphanMasternodeBudgetVotes;
+    expiringmap<uint256, CBudgetVote, BlockHasher> mapSeenMasternodeBudgetVotes;
+    expiringmap<uint256, CBudgetVote, BlockHasher> mapOrphanMasternodeBudgetVotes;
     std::map<uint256, CFinalizedBudgetBroadcast> mapSeenFinalizedBudgets;
-    std::map<uint256, CFinalizedBudgetVote> mapSeenFinalizedBudgetVotes;
-    std::map<uint256, CFinalizedBudgetVote> mapOrphanFinalizedBudgetVotes;
-
-    CBudgetManager()
+    expiringmap<uint256, CFinalizedBudgetVote, BlockHasher> mapSeenFinalizedBudgetVotes;
+    expiringmap<uint256, CFinalizedBudgetVote, BlockHasher> mapOrphanFinalizedBudgetVotes;
+
+    CBudgetManager() : fBudgetCacheValid(false),
+                       mapSeenMasternodeBudgetVotes(BUDGET_SEEN_VOTE_EXPIRY, MAX_BUDGET_SEEN_VOTES),
+                       mapOrphanMasternodeBudgetVotes(BUDGET_ORPHAN_VOTE_EXPIRY, MAX_BUDGET_ORPHAN_VOTES),
+                       mapSeenFinalizedBudgetVotes(BUDGET_SEEN_VOTE_EXPIRY, MAX_BUDGET_SEEN_VOTES),
+                       mapOrphanFinalizedBudgetVotes(BUDGET_ORPHAN_VOTE_EXPIRY, MAX_BUDGET_ORPHAN_VOTES)
     {
         mapProposals.clear();
         mapFinalizedBudgets.clear();
@@ -211,7 +246,8 @@ public:
 
     void ResetSync();
     void MarkSynced();
-    void Sync(CNode* node, uint256 nProp, bool fPartial = false);
+    void Sync(CNode* node, uint256 nProp, bool fPartial = false, const CSyncSetSummary& summary = CSyncSetSummary());
+    CSyncSetSummary GetSyncSummary();
 
     void Calculate();
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
@@ -220,6 +256,9 @@ public:
     CBudgetProposal* FindProposal(uint256 nHash);
     CFinalizedBudget* FindFinalizedBudget(uint256 nHash);
     std::pair<std::string, std::string> GetVotes(std::string strProposalName);
+    //! Find a vote in the seen map or, once it expired there, in the votes of its proposal
+    bool GetBudgetVote(const uint256& nHash, CBudgetVote& voteRet);
+    bool GetFinalizedBudgetVote(const uint256& nHash, CFinalizedBudgetVote& voteRet);
 
     CAmount GetTotalBudget(int nHeight);
     std::vector<CBudgetProposal*> GetBudget();
@@ -238,11 +277,14 @@ public:
     void FillBlockPayee(CMutableTransaction& txNew, CAmount nFees, bool fProofOfStake);
 
     void CheckOrphanVotes();
+    /** Wait for votes from peers, check their signatures and apply them in one batch */
+    void ProcessPendingVotes();
     void Clear()
     {
         LOCK(cs);
 
         LogPrintf("Budget object cleared\n");
+        InvalidateBudgetCache();
         mapProposals.clear();
         mapFinalizedBudgets.clear();
         mapSeenMasternodeBudgetProposals.clear();
@@ -252,6 +294,8 @@ public:
         mapOrphanMasternodeBudgetVotes.clear();
         mapOrphanFinalizedBudgetVotes.clear();
     }
+    void WriteCache(CMasternodeCacheDB& db);
+    bool ReadCache(CMasternodeCacheDB& db);
     void CheckAndRemove();
     std::string ToString() const;
 
@@ -456,6 +500,16 @@ private:
     mutable CCriticalSection cs;
     CAmount nAlloted;
 
+protected:
+    // valid votes in mapVotes, kept up to date as votes are added or revalidated
+    int nYeas;
+    int nNays;
+    int nAbstains;
+
+    void CountVote(const CBudgetVote& vote, int nDelta);
+    //! Recompute the tallies from mapVotes
+    void RecountVotes();
+
 public:
     bool fValid;
     std::string strProposalName;
@@ -486,15 +540,18 @@ public:
 
     bool IsValid(std::string& strError, bool fCheckCollateral = true);
 
-    bool IsEstablished()
+    //! Time after which the proposal is established
+    int64_t GetEstablishedTime()
     {
         // Proposals must be at least a day old to make it into a budget
-        if (Params().NetworkID() == CBaseChainParams::MAIN) return (nTime < GetTime() - (60 * 60 * 24));
+        if (Params().NetworkID() == CBaseChainParams::MAIN) return nTime + (60 * 60 * 24);
 
         // For testing purposes - 5 minutes
-        return (nTime < GetTime() - (60 * 5));
+        return nTime + (60 * 5);
     }
 
+    bool IsEstablished() { return GetEstablishedTime() < GetTime(); }
+
     std::string GetName() { return strProposalName; }
     std::string GetURL() { return strURL; }
     int GetBlockStart() { return nBlockStart; }
@@ -547,6 +604,8 @@ public:
 
         //for saving to the serialized db
         READWRITE(mapVotes);
+        if (ser_action.ForRead())
+            RecountVotes();
     }
 };
 
@@ -575,6 +634,9 @@ public:
         swap(first.nTime, second.nTime);
         swap(first.nFeeTXHash, second.nFeeTXHash);
         first.mapVotes.swap(second.mapVotes);
+        swap(first.nYeas, second.nYeas);
+        swap(first.nNays, second.nNays);
+        swap(first.nAbstains, second.nAbstains);
     }
 
     CBudgetProposalBroadcast& operator=(CBudgetProposalBroadcast from)
@@ -7,6 +7,7 @@
 #include "addrman.h"
 #include "masternode-budget.h"
 #include "masternode-sync.h"
+#include "masternodecachedb.h"
 #include "masternodeman.h"
 #include "obfuscation.h"
 #include "spork.h"
@@ -147,33 +148,6 @@ CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments&
     return Ok;
 }
 
-void DumpMasternodePayments()
-{
-    int64_t nStart = GetTimeMillis();
-
-    CMasternodePaymentDB paymentdb;
-    CMasternodePayments tempPayments;
-
-    LogPrint("masternode","Verifying mnpayments.dat format...\n");
-    CMasternodePaymentDB::ReadResult readResult = paymentdb.Read(tempPayments, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CMasternodePaymentDB::FileError)
-        LogPrint("masternode","Missing budgets file - mnpayments.dat, will try to recreate\n");
-    else if (readResult != CMasternodePaymentDB::Ok) {
-        LogPrint("masternode","Error reading mnpayments.dat: ");
-        if (readResult == CMasternodePaymentDB::IncorrectFormat)
-            LogPrint("masternode","magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint("masternode","file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint("masternode","Writting info to mnpayments.dat...\n");
-    paymentdb.Write(masternodePayments);
-
-    LogPrint("masternode","Budget dump finished  %dms\n", GetTimeMillis() - nStart);
-}
-
 bool IsBlockValueValid(const CBlock& block, CAmount nExpectedValue, CAmount nMinted)
 {
     CBlockIndex* pindexPrev = chainActive.Tip();
@@ -402,6 +376,8 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
 
         int nCountNeeded;
         vRecv >> nCountNeeded;
+        CSyncSetSummary summary;
+        if (!vRecv.empty()) vRecv >> summary;
 
         if (Params().NetworkID() == CBaseChainParams::MAIN) {
             if (pfrom->HasFulfilledRequest("mnget")) {
@@ -412,7 +388,7 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
         }
 
         pfrom->FulfilledRequest("mnget");
-        masternodePayments.Sync(pfrom, nCountNeeded);
+        masternodePayments.Sync(pfrom, nCountNeeded, summary);
         LogPrint("mnpayments", "mnget - Sent Masternode winners to peer %i\n", pfrom->GetId());
     } else if (strCommand == "mnw") { //Masternode Payments Declare Winner
         //this is required in litemodef
@@ -519,21 +495,57 @@ bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
     CScript mnpayee;
     mnpayee = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
 
-    CScript payee;
-    for (int64_t h = nHeight; h <= nHeight + 8; h++) {
-        if (h == nNotBlockHeight) continue;
-        if (mapMasternodeBlocks.count(h)) {
-            if (mapMasternodeBlocks[h].GetPayee(payee)) {
-                if (mnpayee == payee) {
-                    return true;
-                }
-            }
-        }
+    return IsScheduled(mnpayee, nHeight, nNotBlockHeight);
+}
+
+// Is this payee leading the votes of a block in [nHeight, nHeight + 8] other than nNotBlockHeight?
+bool CMasternodePayments::IsScheduled(const CScript& payee, int nHeight, int nNotBlockHeight)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    std::map<CScript, std::set<int> >::const_iterator it = mapPayeeLeadingBlocks.find(payee);
+    if (it == mapPayeeLeadingBlocks.end()) return false;
+
+    for (std::set<int>::const_iterator itHeight = it->second.lower_bound(nHeight); itHeight != it->second.end() && *itHeight <= nHeight + 8; ++itHeight) {
+        if (*itHeight != nNotBlockHeight) return true;
     }
 
     return false;
 }
 
+// Re-index the leading payee of nBlockHeight after its votes changed or it was removed
+void CMasternodePayments::UpdateLeadingPayee(int nBlockHeight)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    std::map<int, CScript>::iterator it = mapBlockLeadingPayee.find(nBlockHeight);
+    if (it != mapBlockLeadingPayee.end()) {
+        std::map<CScript, std::set<int> >::iterator itPayee = mapPayeeLeadingBlocks.find(it->second);
+        if (itPayee != mapPayeeLeadingBlocks.end()) {
+            itPayee->second.erase(nBlockHeight);
+            if (itPayee->second.empty()) mapPayeeLeadingBlocks.erase(itPayee);
+        }
+        mapBlockLeadingPayee.erase(it);
+    }
+
+    std::map<int, CMasternodeBlockPayees>::iterator itBlock = mapMasternodeBlocks.find(nBlockHeight);
+    CScript payee;
+    if (itBlock != mapMasternodeBlocks.end() && itBlock->second.GetPayee(payee)) {
+        mapBlockLeadingPayee[nBlockHeight] = payee;
+        mapPayeeLeadingBlocks[payee].insert(nBlockHeight);
+    }
+}
+
+void CMasternodePayments::RebuildLeadingPayees()
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    mapBlockLeadingPayee.clear();
+    mapPayeeLeadingBlocks.clear();
+    for (std::map<int, CMasternodeBlockPayees>::const_iterator it = mapMasternodeBlocks.begin(); it != mapMasternodeBlocks.end(); ++it)
+        UpdateLeadingPayee(it->first);
+}
+
 bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerIn)
 {
     uint256 blockHash = 0;
@@ -554,9 +566,10 @@ bool CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerI
             CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
             mapMasternodeBlocks[winnerIn.nBlockHeight] = blockPayees;
         }
-    }
 
-    mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+        mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+        UpdateLeadingPayee(winnerIn.nBlockHeight);
+    }
 
     return true;
 }
@@ -666,6 +679,29 @@ bool CMasternodePayments::IsTransactionValid(const CTransaction& txNew, int nBlo
     return true;
 }
 
+void CMasternodePayments::WriteCache(CMasternodeCacheDB& db)
+{
+    LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
+    for (std::map<uint256, CMasternodePaymentWinner>::const_iterator it = mapMasternodePayeeVotes.begin(); it != mapMasternodePayeeVotes.end(); ++it)
+        db.Put('w', it->first, it->second);
+    for (std::map<int, CMasternodeBlockPayees>::const_iterator it = mapMasternodeBlocks.begin(); it != mapMasternodeBlocks.end(); ++it)
+        db.Put('k', it->first, it->second);
+}
+
+bool CMasternodePayments::ReadCache(CMasternodeCacheDB& db)
+{
+    std::map<uint256, CMasternodePaymentWinner> mapVotes;
+    std::map<int, CMasternodeBlockPayees> mapBlocks;
+    if (!db.Load('w', mapVotes) || !db.Load('k', mapBlocks))
+        return false;
+
+    LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
+    mapMasternodePayeeVotes.swap(mapVotes);
+    mapMasternodeBlocks.swap(mapBlocks);
+    RebuildLeadingPayees();
+    return true;
+}
+
 void CMasternodePayments::CleanPaymentList()
 {
     LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
@@ -689,6 +725,7 @@ void CMasternodePayments::CleanPaymentList()
             masternodeSync.mapSeenSyncMNW.erase((*it).first);
             mapMasternodePayeeVotes.erase(it++);
             mapMasternodeBlocks.erase(winner.nBlockHeight);
+            UpdateLeadingPayee(winner.nBlockHeight);
         } else {
             ++it;
         }
@@ -825,7 +862,7 @@ bool CMasternodePaymentWinner::SignatureValid()
     return false;
 }
 
-void CMasternodePayments::Sync(CNode* node, int nCountNeeded)
+void CMasternodePayments::Sync(CNode* node, int nCountNeeded, const CSyncSetSummary& summary)
 {
     LOCK(cs_mapMasternodePayeeVotes);
 
@@ -839,17 +876,43 @@ void CMasternodePayments::Sync(CNode* node, int nCountNeeded)
     int nCount = (mnodeman.CountEnabled() * 1.25);
     if (nCountNeeded > nCount) nCountNeeded = nCount;
 
-    int nInvCount = 0;
+    std::vector<CInv> vInv;
     std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin();
     while (it != mapMasternodePayeeVotes.end()) {
         CMasternodePaymentWinner winner = (*it).second;
         if (winner.nBlockHeight >= nHeight - nCountNeeded && winner.nBlockHeight <= nHeight + 20) {
-            node->PushInventory(CInv(MSG_MASTERNODE_WINNER, winner.GetHash()));
-            nInvCount++;
+            vInv.push_back(CInv(MSG_MASTERNODE_WINNER, winner.GetHash()));
         }
         ++it;
     }
-    node->PushMessage("ssc", MASTERNODE_SYNC_MNW, nInvCount);
+    summary.FilterKnown(vInv);
+    BOOST_FOREACH (const CInv& inv, vInv)
+        node->PushInventory(inv);
+    node->PushMessage("ssc", MASTERNODE_SYNC_MNW, (int)vInv.size());
+}
+
+CSyncSetSummary CMasternodePayments::GetSyncSummary(int nCountNeeded)
+{
+    LOCK(cs_mapMasternodePayeeVotes);
+
+    int nHeight;
+    {
+        TRY_LOCK(cs_main, locked);
+        if (!locked || chainActive.Tip() == NULL) return CSyncSetSummary();
+        nHeight = chainActive.Tip()->nHeight;
+    }
+
+    // the votes Sync() would announce from a peer at the same height
+    std::vector<uint256> vHash;
+    for (std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin(); it != mapMasternodePayeeVotes.end(); ++it) {
+        if (it->second.nBlockHeight >= nHeight - nCountNeeded && it->second.nBlockHeight <= nHeight + 20)
+            vHash.push_back(it->second.GetHash());
+    }
+
+    CSyncSetSummary summary = CSyncSetSummary::ForItems(vHash.size());
+    BOOST_FOREACH (const uint256& hash, vHash)
+        summary.Add(hash);
+    return summary;
 }
 
 std::string CMasternodePayments::ToString() const
@@ -866,17 +929,10 @@ int CMasternodePayments::GetOldestBlock()
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    int nOldestBlock = std::numeric_limits<int>::max();
-
-    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.begin();
-    while (it != mapMasternodeBlocks.end()) {
-        if ((*it).first < nOldestBlock) {
-            nOldestBlock = (*it).first;
-        }
-        it++;
-    }
+    // the map is ordered by height
+    if (mapMasternodeBlocks.empty()) return std::numeric_limits<int>::max();
 
-    return nOldestBlock;
+    return mapMasternodeBlocks.begin()->first;
 }
 
 
@@ -884,15 +940,7 @@ int CMasternodePayments::GetNewestBlock()
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    int nNewestBlock = 0;
-
-    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.begin();
-    while (it != mapMasternodeBlocks.end()) {
-        if ((*it).first > nNewestBlock) {
-            nNewestBlock = (*it).first;
-        }
-        it++;
-    }
+    if (mapMasternodeBlocks.empty()) return 0;
 
-    return nNewestBlock;
+    return std::max(mapMasternodeBlocks.rbegin()->first, 0);
 }
@@ -9,6 +9,10 @@
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
+#include "masternode-sync.h"
+
+#include <set>
+
 #include <boost/lexical_cast.hpp>
 
 using namespace std;
@@ -17,6 +21,7 @@ extern CCriticalSection cs_vecPayments;
 extern CCriticalSection cs_mapMasternodeBlocks;
 extern CCriticalSection cs_mapMasternodePayeeVotes;
 
+class CMasternodeCacheDB;
 class CMasternodePayments;
 class CMasternodePaymentWinner;
 class CMasternodeBlockPayees;
@@ -32,8 +37,6 @@ std::string GetRequiredPaymentsString(int nBlockHeight);
 bool IsBlockValueValid(const CBlock& block, CAmount nExpectedValue, CAmount nMinted);
 void FillBlockPayee(CMutableTransaction& txNew, CAmount nFees, bool fProofOfStake);
 
-void DumpMasternodePayments();
-
 /** Save Masternode Payment Data (mnpayments.dat)
  */
 class CMasternodePaymentDB
@@ -236,6 +239,13 @@ private:
     int nSyncedFromPeer;
     int nLastBlockHeight;
 
+    // leading payee of every height in mapMasternodeBlocks, and the heights each payee leads
+    std::map<int, CScript> mapBlockLeadingPayee;
+    std::map<CScript, std::set<int> > mapPayeeLeadingBlocks;
+
+    void UpdateLeadingPayee(int nBlockHeight);
+    void RebuildLeadingPayees();
+
 public:
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
@@ -249,21 +259,28 @@ public:
 
     void Clear()
     {
-        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
+        LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
         mapMasternodeBlocks.clear();
         mapMasternodePayeeVotes.clear();
+        mapBlockLeadingPayee.clear();
+        mapPayeeLeadingBlocks.clear();
     }
 
+    void WriteCache(CMasternodeCacheDB& db);
+    bool ReadCache(CMasternodeCacheDB& db);
+
     bool AddWinningMasternode(CMasternodePaymentWinner& winner);
     bool ProcessBlock(int nBlockHeight);
 
-    void Sync(CNode* node, int nCountNeeded);
+    void Sync(CNode* node, int nCountNeeded, const CSyncSetSummary& summary = CSyncSetSummary());
+    CSyncSetSummary GetSyncSummary(int nCountNeeded);
     void CleanPaymentList();
     int LastPayment(CMasternode& mn);
 
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight);
     bool IsScheduled(CMasternode& mn, int nNotBlockHeight);
+    bool IsScheduled(const CScript& payee, int nHeight, int nNotBlockHeight);
 
     bool CanVote(COutPoint outMasternode, int nBlockHeight)
     {
@@ -295,6 +312,8 @@ public:
     {
         READWRITE(mapMasternodePayeeVotes);
         READWRITE(mapMasternodeBlocks);
+        if (ser_action.ForRead())
+            RebuildLeadingPayees();
     }
 };
 
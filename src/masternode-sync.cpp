@@ -19,7 +19,33 @@
 class CMasternodeSync;
 CMasternodeSync masternodeSync;
 
-CMasternodeSync::CMasternodeSync()
+CSyncSetSummary CSyncSetSummary::ForItems(size_t nItems)
+{
+    if (nItems == 0) return CSyncSetSummary();
+    size_t nBuckets = (nItems + MASTERNODE_SYNC_SUMMARY_BUCKET_SIZE - 1) / MASTERNODE_SYNC_SUMMARY_BUCKET_SIZE;
+    return CSyncSetSummary(std::min(nBuckets, (size_t)MASTERNODE_SYNC_SUMMARY_MAX_BUCKETS));
+}
+
+void CSyncSetSummary::FilterKnown(std::vector<CInv>& vInv) const
+{
+    // peers that sent no usable summary get everything
+    if (IsNull() || vBuckets.size() > MASTERNODE_SYNC_SUMMARY_MAX_BUCKETS) return;
+
+    CSyncSetSummary ours(vBuckets.size());
+    BOOST_FOREACH (const CInv& inv, vInv)
+        ours.Add(inv.hash);
+
+    std::vector<CInv> vMissing;
+    BOOST_FOREACH (const CInv& inv, vInv) {
+        size_t nBucket = Bucket(inv.hash);
+        if (ours.vBuckets[nBucket] != vBuckets[nBucket]) vMissing.push_back(inv);
+    }
+    vInv.swap(vMissing);
+}
+
+CMasternodeSync::CMasternodeSync() : mapSeenSyncMNB(MASTERNODE_SYNC_SEEN_EXPIRY, MASTERNODE_SYNC_SEEN_MAX),
+                                     mapSeenSyncMNW(MASTERNODE_SYNC_SEEN_EXPIRY, MASTERNODE_SYNC_SEEN_MAX),
+                                     mapSeenSyncBudget(MASTERNODE_SYNC_SEEN_EXPIRY, MASTERNODE_SYNC_SEEN_MAX)
 {
     Reset();
 }
@@ -196,11 +222,18 @@ void CMasternodeSync::ProcessMessage(CNode* pfrom, std::string& strCommand, CDat
             if (nItemID != RequestedMasternodeAssets) return;
             sumMasternodeList += nCount;
             countMasternodeList++;
+            // a peer that got our summary only announces what we lack, which
+            // may be nothing: its answer alone shows the list is in sync
+            if (mnodeman.size() > 0) lastMasternodeList = GetTime();
             break;
         case (MASTERNODE_SYNC_MNW):
             if (nItemID != RequestedMasternodeAssets) return;
             sumMasternodeWinner += nCount;
             countMasternodeWinner++;
+            {
+                LOCK(cs_mapMasternodePayeeVotes);
+                if (!masternodePayments.mapMasternodePayeeVotes.empty()) lastMasternodeWinner = GetTime();
+            }
             break;
         case (MASTERNODE_SYNC_BUDGET_PROP):
             if (RequestedMasternodeAssets != MASTERNODE_SYNC_BUDGET) return;
@@ -362,7 +395,7 @@ void CMasternodeSync::Process()
                 if (pindexPrev == NULL) return;
 
                 int nMnCount = mnodeman.CountEnabled();
-                pnode->PushMessage("mnget", nMnCount); //sync payees
+                pnode->PushMessage("mnget", nMnCount, masternodePayments.GetSyncSummary(nMnCount)); //sync payees
                 RequestedMasternodeAttempt++;
 
                 return;
@@ -399,7 +432,7 @@ void CMasternodeSync::Process()
                 if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3) return;
 
                 uint256 n = 0;
-                pnode->PushMessage("mnvs", n); //sync masternode votes
+                pnode->PushMessage("mnvs", n, budget.GetSyncSummary()); //sync masternode votes
                 RequestedMasternodeAttempt++;
 
                 return;
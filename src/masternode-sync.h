@@ -6,6 +6,14 @@
 #ifndef MASTERNODE_SYNC_H
 #define MASTERNODE_SYNC_H
 
+#include "expiringmap.h"
+#include "main.h"
+#include "serialize.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
 #define MASTERNODE_SYNC_INITIAL 0
 #define MASTERNODE_SYNC_SPORKS 1
 #define MASTERNODE_SYNC_LIST 2
@@ -19,9 +27,56 @@
 #define MASTERNODE_SYNC_TIMEOUT 5
 #define MASTERNODE_SYNC_THRESHOLD 2
 
+// how long, and for how many objects, sync announcements are counted
+#define MASTERNODE_SYNC_SEEN_EXPIRY (60 * 60)
+#define MASTERNODE_SYNC_SEEN_MAX 100000
+
+// objects per bucket of a sync set summary
+#define MASTERNODE_SYNC_SUMMARY_BUCKET_SIZE 4
+// most buckets accepted in a sync set summary
+#define MASTERNODE_SYNC_SUMMARY_MAX_BUCKETS 8192
+
 class CMasternodeSync;
 extern CMasternodeSync masternodeSync;
 
+//
+// CSyncSetSummary : What a node already has of one sync asset
+//
+// Appended to "dseg", "mnget" and "mnvs" requests. The object hashes are
+// spread over buckets holding the XOR of their hashes; the peer computes the
+// same over what it would announce and only announces the objects of the
+// buckets that differ. Peers that don't know about it ignore the trailing
+// bytes and announce everything, as before.
+//
+
+class CSyncSetSummary
+{
+public:
+    std::vector<uint64_t> vBuckets;
+
+    CSyncSetSummary() {}
+    explicit CSyncSetSummary(size_t nBuckets) : vBuckets(nBuckets, 0) {}
+
+    /// Empty summary sized for nItems objects; null if there are none
+    static CSyncSetSummary ForItems(size_t nItems);
+
+    bool IsNull() const { return vBuckets.empty(); }
+
+    size_t Bucket(const uint256& hash) const { return hash.GetLow64() % vBuckets.size(); }
+    void Add(const uint256& hash) { vBuckets[Bucket(hash)] ^= (hash >> 64).GetLow64(); }
+
+    /// Drop the objects the peer that sent this summary already has
+    void FilterKnown(std::vector<CInv>& vInv) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(vBuckets);
+    }
+};
+
 //
 // CMasternodeSync : Sync masternode assets in stages
 //
@@ -29,9 +84,9 @@ extern CMasternodeSync masternodeSync;
 class CMasternodeSync
 {
 public:
-    std::map<uint256, int> mapSeenSyncMNB;
-    std::map<uint256, int> mapSeenSyncMNW;
-    std::map<uint256, int> mapSeenSyncBudget;
+    expiringmap<uint256, int, BlockHasher> mapSeenSyncMNB;
+    expiringmap<uint256, int, BlockHasher> mapSeenSyncMNW;
+    expiringmap<uint256, int, BlockHasher> mapSeenSyncBudget;
 
     int64_t lastMasternodeList;
     int64_t lastMasternodeWinner;
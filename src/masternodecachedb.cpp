@@ -0,0 +1,118 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternodecachedb.h"
+#include "masternode-budget.h"
+#include "masternode-payments.h"
+#include "masternodeman.h"
+#include "util.h"
+
+#include <boost/foreach.hpp>
+
+CMasternodeCacheDB* pmasternodeCacheDB = NULL;
+
+//! Serializes flushes from the maintenance thread and from shutdown
+static CCriticalSection cs_mncachedb;
+
+static const std::string MASTERNODE_CACHE_VERSION_KEY = "version";
+
+CMasternodeCacheDB::CMasternodeCacheDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "mncache", nCacheSize, fMemory, fWipe)
+{
+    // Remember what is on disk, so that the first flush only writes what
+    // changed since the previous run and erases entries that are gone
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+        leveldb::Slice slKey = pcursor->key();
+        leveldb::Slice slValue = pcursor->value();
+        mapStored[slKey.ToString()] = Hash(slValue.data(), slValue.data() + slValue.size());
+    }
+}
+
+bool CMasternodeCacheDB::IsInitialized() const
+{
+    int nVersion = 0;
+    return Read(MASTERNODE_CACHE_VERSION_KEY, nVersion) && nVersion == MASTERNODE_CACHE_VERSION;
+}
+
+bool CMasternodeCacheDB::WriteChanges(unsigned int& nWrittenRet, unsigned int& nErasedRet)
+{
+    CDataStream ssVersionKey(SER_DISK, CLIENT_VERSION);
+    ssVersionKey << MASTERNODE_CACHE_VERSION_KEY;
+    setPut.insert(ssVersionKey.str());
+
+    std::vector<std::string> vErase;
+    for (std::map<std::string, uint256>::const_iterator it = mapStored.begin(); it != mapStored.end(); ++it) {
+        if (!setPut.count(it->first)) {
+            batch.EraseRaw(it->first);
+            vErase.push_back(it->first);
+        }
+    }
+    // Marks the store as usable; it is part of the same atomic batch
+    batch.Write(MASTERNODE_CACHE_VERSION_KEY, MASTERNODE_CACHE_VERSION);
+
+    bool fRet = false;
+    try {
+        fRet = WriteBatch(batch);
+    } catch (const std::exception& e) {
+        LogPrintf("%s : %s\n", __func__, e.what());
+    }
+    if (fRet) {
+        for (std::map<std::string, uint256>::const_iterator it = mapPending.begin(); it != mapPending.end(); ++it)
+            mapStored[it->first] = it->second;
+        BOOST_FOREACH (const std::string& strKey, vErase)
+            mapStored.erase(strKey);
+        nWrittenRet = mapPending.size();
+        nErasedRet = vErase.size();
+    }
+    // On failure nothing is recorded as stored, so the next flush retries it all
+    batch = CLevelDBBatch();
+    mapPending.clear();
+    setPut.clear();
+    return fRet;
+}
+
+bool LoadMasternodeCaches()
+{
+    if (!pmasternodeCacheDB)
+        return false;
+
+    LOCK(cs_mncachedb);
+    int64_t nStart = GetTimeMillis();
+    if (!mnodeman.ReadCache(*pmasternodeCacheDB) || !budget.ReadCache(*pmasternodeCacheDB) ||
+        !masternodePayments.ReadCache(*pmasternodeCacheDB)) {
+        mnodeman.Clear();
+        budget.Clear();
+        masternodePayments.Clear();
+        return error("%s : failed to read the masternode cache database", __func__);
+    }
+    LogPrint("masternode", "Loaded masternode cache database  %dms\n", GetTimeMillis() - nStart);
+    LogPrint("masternode", "  %s\n", mnodeman.ToString());
+    LogPrint("masternode", "  %s\n", budget.ToString());
+    LogPrint("masternode", "  %s\n", masternodePayments.ToString());
+
+    // Drop what expired while the node was down, as the flat file loaders did
+    mnodeman.CheckAndRemove(true);
+    budget.CheckAndRemove();
+    masternodePayments.CleanPaymentList();
+    return true;
+}
+
+void FlushMasternodeCaches()
+{
+    if (!pmasternodeCacheDB)
+        return;
+
+    LOCK(cs_mncachedb);
+    int64_t nStart = GetTimeMillis();
+    mnodeman.WriteCache(*pmasternodeCacheDB);
+    budget.WriteCache(*pmasternodeCacheDB);
+    masternodePayments.WriteCache(*pmasternodeCacheDB);
+
+    unsigned int nWritten = 0, nErased = 0;
+    if (!pmasternodeCacheDB->WriteChanges(nWritten, nErased)) {
+        LogPrintf("%s : failed to write the masternode cache database\n", __func__);
+        return;
+    }
+    LogPrint("masternode", "Flushed masternode cache database: %u written, %u erased  %dms\n", nWritten, nErased, GetTimeMillis() - nStart);
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MASTERNODECACHEDB_H
+#define BITCOIN_MASTERNODECACHEDB_H
+
+#include "hash.h"
+#include "leveldbwrapper.h"
+#include "sync.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <boost/scoped_ptr.hpp>
+
+//! Seconds between two flushes of the masternode, payment and budget caches
+static const int MASTERNODE_CACHE_FLUSH_SECONDS = 60;
+//! Format of the records in the masternode cache database
+static const int MASTERNODE_CACHE_VERSION = 1;
+
+/**
+ * Database (mncache/ in the data directory) holding the masternode list, the
+ * masternode payment votes and the budget objects, one record per entry.
+ *
+ * The managers hand every entry to Put() on each flush; only entries whose
+ * serialization changed since the previous flush are written, and entries
+ * that were not handed over again are erased. A crash therefore loses at most
+ * the changes of one flush interval, and a flush costs I/O proportional to
+ * what changed instead of to the size of the caches.
+ */
+class CMasternodeCacheDB : public CLevelDBWrapper
+{
+private:
+    //! Serialized key of every stored record -> hash of its stored value
+    std::map<std::string, uint256> mapStored;
+    //! Keys handed to Put() since the last WriteChanges()
+    std::set<std::string> setPut;
+    //! Queued records -> hash of their new value, applied to mapStored once written
+    std::map<std::string, uint256> mapPending;
+    CLevelDBBatch batch;
+
+    CMasternodeCacheDB(const CMasternodeCacheDB&);
+    void operator=(const CMasternodeCacheDB&);
+
+public:
+    CMasternodeCacheDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    //! Whether a complete flush in the current format was ever written
+    bool IsInitialized() const;
+
+    /** Queue entry key of collection chType, unless it is stored unchanged */
+    template <typename K, typename V>
+    void Put(char chType, const K& key, const V& value)
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << std::make_pair(chType, key);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << value;
+
+        std::string strKey = ssKey.str();
+        uint256 hashValue = Hash(ssValue.begin(), ssValue.end());
+        setPut.insert(strKey);
+        std::map<std::string, uint256>::iterator it = mapStored.find(strKey);
+        if (it != mapStored.end() && it->second == hashValue)
+            return;
+        batch.WriteRaw(leveldb::Slice(&ssKey[0], ssKey.size()), leveldb::Slice(&ssValue[0], ssValue.size()));
+        mapPending[strKey] = hashValue;
+    }
+
+    /**
+     * Erase the records that were not Put() since the previous call and
+     * write all queued changes in one batch.
+     */
+    bool WriteChanges(unsigned int& nWrittenRet, unsigned int& nErasedRet);
+
+    /** Read every stored entry of collection chType into mapRet */
+    template <typename Map>
+    bool Load(char chType, Map& mapRet)
+    {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        ssKeySet << chType;
+        pcursor->Seek(ssKeySet.str());
+
+        while (pcursor->Valid()) {
+            try {
+                leveldb::Slice slKey = pcursor->key();
+                CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+                char chKeyType;
+                ssKey >> chKeyType;
+                if (chKeyType != chType)
+                    break;
+                typename Map::key_type key;
+                ssKey >> key;
+
+                leveldb::Slice slValue = pcursor->value();
+                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+                ssValue >> mapRet[key];
+                pcursor->Next();
+            } catch (std::exception& e) {
+                return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+            }
+        }
+
+        return true;
+    }
+};
+
+extern CMasternodeCacheDB* pmasternodeCacheDB;
+
+/** Load the masternode, payment and budget managers from pmasternodeCacheDB */
+bool LoadMasternodeCaches();
+
+/** Write what changed in the masternode, payment and budget managers to pmasternodeCacheDB */
+void FlushMasternodeCaches();
+
+#endif // BITCOIN_MASTERNODECACHEDB_H
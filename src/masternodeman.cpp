@@ -7,6 +7,7 @@
 #include "activemasternode.h"
 #include "addrman.h"
 #include "masternode.h"
+#include "masternodecachedb.h"
 #include "obfuscation.h"
 #include "spork.h"
 #include "util.h"
@@ -166,33 +167,6 @@ CMasternodeDB::ReadResult CMasternodeDB::Read(CMasternodeMan& mnodemanToLoad, bo
     return Ok;
 }
 
-void DumpMasternodes()
-{
-    int64_t nStart = GetTimeMillis();
-
-    CMasternodeDB mndb;
-    CMasternodeMan tempMnodeman;
-
-    LogPrint("masternode","Verifying mncache.dat format...\n");
-    CMasternodeDB::ReadResult readResult = mndb.Read(tempMnodeman, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CMasternodeDB::FileError)
-        LogPrint("masternode","Missing masternode cache file - mncache.dat, will try to recreate\n");
-    else if (readResult != CMasternodeDB::Ok) {
-        LogPrint("masternode","Error reading mncache.dat: ");
-        if (readResult == CMasternodeDB::IncorrectFormat)
-            LogPrint("masternode","magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint("masternode","file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint("masternode","Writting info to mncache.dat...\n");
-    mndb.Write(mnodeman);
-
-    LogPrint("masternode","Masternode dump finished  %dms\n", GetTimeMillis() - nStart);
-}
-
 CMasternodeMan::CMasternodeMan()
 {
     nDsqCount = 0;
@@ -348,6 +322,49 @@ void CMasternodeMan::Clear()
     nDsqCount = 0;
 }
 
+void CMasternodeMan::WriteCache(CMasternodeCacheDB& db)
+{
+    LOCK(cs);
+    BOOST_FOREACH (const CMasternode& mn, vMasternodes)
+        db.Put('m', mn.vin.prevout, mn);
+    for (std::map<uint256, CMasternodeBroadcast>::const_iterator it = mapSeenMasternodeBroadcast.begin(); it != mapSeenMasternodeBroadcast.end(); ++it)
+        db.Put('b', it->first, it->second);
+    for (std::map<uint256, CMasternodePing>::const_iterator it = mapSeenMasternodePing.begin(); it != mapSeenMasternodePing.end(); ++it)
+        db.Put('p', it->first, it->second);
+
+    db.Put('M', std::string("askedus"), mAskedUsForMasternodeList);
+    db.Put('M', std::string("weasked"), mWeAskedForMasternodeList);
+    db.Put('M', std::string("weaskedentry"), mWeAskedForMasternodeListEntry);
+    db.Put('M', std::string("dsqcount"), nDsqCount);
+}
+
+bool CMasternodeMan::ReadCache(CMasternodeCacheDB& db)
+{
+    std::map<COutPoint, CMasternode> mapMasternodes;
+    CMasternodeMan loaded;
+    if (!db.Load('m', mapMasternodes) ||
+        !db.Load('b', loaded.mapSeenMasternodeBroadcast) ||
+        !db.Load('p', loaded.mapSeenMasternodePing))
+        return false;
+    db.Read(std::make_pair('M', std::string("askedus")), loaded.mAskedUsForMasternodeList);
+    db.Read(std::make_pair('M', std::string("weasked")), loaded.mWeAskedForMasternodeList);
+    db.Read(std::make_pair('M', std::string("weaskedentry")), loaded.mWeAskedForMasternodeListEntry);
+    db.Read(std::make_pair('M', std::string("dsqcount")), loaded.nDsqCount);
+
+    LOCK(cs);
+    vMasternodes.clear();
+    vMasternodes.reserve(mapMasternodes.size());
+    for (std::map<COutPoint, CMasternode>::iterator it = mapMasternodes.begin(); it != mapMasternodes.end(); ++it)
+        vMasternodes.push_back(it->second);
+    mAskedUsForMasternodeList.swap(loaded.mAskedUsForMasternodeList);
+    mWeAskedForMasternodeList.swap(loaded.mWeAskedForMasternodeList);
+    mWeAskedForMasternodeListEntry.swap(loaded.mWeAskedForMasternodeListEntry);
+    mapSeenMasternodeBroadcast.swap(loaded.mapSeenMasternodeBroadcast);
+    mapSeenMasternodePing.swap(loaded.mapSeenMasternodePing);
+    nDsqCount = loaded.nDsqCount;
+    return true;
+}
+
 int CMasternodeMan::stable_size ()
 {
     int nStable_size = 0;
@@ -430,11 +447,27 @@ void CMasternodeMan::DsegUpdate(CNode* pnode)
         }
     }
 
-    pnode->PushMessage("dseg", CTxIn());
+    pnode->PushMessage("dseg", CTxIn(), GetSyncSummary());
     int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
     mWeAskedForMasternodeList[pnode->addr] = askAgain;
 }
 
+CSyncSetSummary CMasternodeMan::GetSyncSummary()
+{
+    LOCK(cs);
+
+    std::vector<uint256> vHash;
+    BOOST_FOREACH (CMasternode& mn, vMasternodes) {
+        if (mn.addr.IsRFC1918() || !mn.IsEnabled()) continue;
+        vHash.push_back(CMasternodeBroadcast(mn).GetHash());
+    }
+
+    CSyncSetSummary summary = CSyncSetSummary::ForItems(vHash.size());
+    BOOST_FOREACH (const uint256& hash, vHash)
+        summary.Add(hash);
+    return summary;
+}
+
 CMasternode* CMasternodeMan::Find(const CScript& payee)
 {
     LOCK(cs);
@@ -486,6 +519,14 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
     */
 
     int nMnCount = CountEnabled();
+
+    // the schedule is looked up from the tip; without it nothing counts as scheduled
+    int nTipHeight = -1;
+    {
+        TRY_LOCK(cs_main, locked);
+        if (locked && chainActive.Tip() != NULL) nTipHeight = chainActive.Tip()->nHeight;
+    }
+
     BOOST_FOREACH (CMasternode& mn, vMasternodes) {
         mn.Check();
         if (!mn.IsEnabled()) continue;
@@ -494,7 +535,7 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
         if (mn.protocolVersion < masternodePayments.GetMinMasternodePaymentsProto()) continue;
 
         //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if (masternodePayments.IsScheduled(mn, nBlockHeight)) continue;
+        if (nTipHeight >= 0 && masternodePayments.IsScheduled(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()), nTipHeight, nBlockHeight)) continue;
 
         //it's too new, wait for a cycle
         if (fFilterSigTime && mn.sigTime + (nMnCount * 2.6 * 60) > GetAdjustedTime()) continue;
@@ -591,15 +632,14 @@ CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight,
     return winner;
 }
 
-int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
+bool CMasternodeMan::GetMasternodeScores(int64_t nBlockHeight, int minProtocol, bool fOnlyActive, std::vector<pair<int64_t, CTxIn> >& vecMasternodeScores)
 {
-    std::vector<pair<int64_t, CTxIn> > vecMasternodeScores;
     int64_t nMasternode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nMasternode_Age = 0;
 
     //make sure we know about this block
     uint256 hash = 0;
-    if (!GetBlockHash(hash, nBlockHeight)) return -1;
+    if (!GetBlockHash(hash, nBlockHeight)) return false;
 
     // scan for winner
     BOOST_FOREACH (CMasternode& mn, vMasternodes) {
@@ -626,6 +666,13 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
     }
 
     sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
+    return true;
+}
+
+int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
+{
+    std::vector<pair<int64_t, CTxIn> > vecMasternodeScores;
+    if (!GetMasternodeScores(nBlockHeight, minProtocol, fOnlyActive, vecMasternodeScores)) return -1;
 
     int rank = 0;
     BOOST_FOREACH (PAIRTYPE(int64_t, CTxIn) & s, vecMasternodeScores) {
@@ -638,6 +685,23 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
     return -1;
 }
 
+bool CMasternodeMan::GetMasternodeRankMap(int64_t nBlockHeight, std::map<COutPoint, int>& mapRanksRet, int minProtocol, bool fOnlyActive)
+{
+    LOCK(cs);
+
+    std::vector<pair<int64_t, CTxIn> > vecMasternodeScores;
+    if (!GetMasternodeScores(nBlockHeight, minProtocol, fOnlyActive, vecMasternodeScores)) return false;
+
+    int rank = 0;
+    BOOST_FOREACH (PAIRTYPE(int64_t, CTxIn) & s, vecMasternodeScores) {
+        rank++;
+        // like GetMasternodeRank, the first entry of an outpoint decides its rank
+        mapRanksRet.insert(make_pair(s.second.prevout, rank));
+    }
+
+    return true;
+}
+
 std::vector<pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int64_t nBlockHeight, int minProtocol)
 {
     std::vector<pair<int64_t, CMasternode> > vecMasternodeScores;
@@ -800,6 +864,8 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         CTxIn vin;
         vRecv >> vin;
+        CSyncSetSummary summary;
+        if (!vRecv.empty()) vRecv >> summary;
 
         if (vin == CTxIn()) { //only should ask for this once
             //local network
@@ -821,7 +887,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         } //else, asking for a specific node which is ok
 
 
-        int nInvCount = 0;
+        std::vector<CInv> vInv;
 
         BOOST_FOREACH (CMasternode& mn, vMasternodes) {
             if (mn.addr.IsRFC1918()) continue; //local network
@@ -831,22 +897,26 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
                 if (vin == CTxIn() || vin == mn.vin) {
                     CMasternodeBroadcast mnb = CMasternodeBroadcast(mn);
                     uint256 hash = mnb.GetHash();
-                    pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
-                    nInvCount++;
 
                     if (!mapSeenMasternodeBroadcast.count(hash)) mapSeenMasternodeBroadcast.insert(make_pair(hash, mnb));
 
                     if (vin == mn.vin) {
+                        pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
                         LogPrint("masternode", "dseg - Sent 1 Masternode entry to peer %i\n", pfrom->GetId());
                         return;
                     }
+                    vInv.push_back(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
                 }
             }
         }
 
         if (vin == CTxIn()) {
-            pfrom->PushMessage("ssc", MASTERNODE_SYNC_LIST, nInvCount);
-            LogPrint("masternode", "dseg - Sent %d Masternode entries to peer %i\n", nInvCount, pfrom->GetId());
+            size_t nTotal = vInv.size();
+            summary.FilterKnown(vInv);
+            BOOST_FOREACH (const CInv& inv, vInv)
+                pfrom->PushInventory(inv);
+            pfrom->PushMessage("ssc", MASTERNODE_SYNC_LIST, (int)vInv.size());
+            LogPrint("masternode", "dseg - Sent %d of %d Masternode entries to peer %i\n", vInv.size(), nTotal, pfrom->GetId());
         }
     }
     /*
@@ -1008,7 +1078,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             // should be at least not earlier than block when 1000 TPC tx got MASTERNODE_MIN_CONFIRMATIONS
             uint256 hashBlock = 0;
             CTransaction tx2;
-            GetTransaction(vin.prevout.hash, tx2, hashBlock, true);
+            GetTransactionOutputs(vin.prevout.hash, tx2, hashBlock);
             BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
             if (mi != mapBlockIndex.end() && (*mi).second) {
                 CBlockIndex* pMNIndex = (*mi).second;                                                        // block for 1000 TPC tx -> 1 confirmation
@@ -10,19 +10,19 @@
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
+#include "masternode-sync.h"
 #include "net.h"
 #include "sync.h"
 #include "util.h"
 
-#define MASTERNODES_DUMP_SECONDS (15 * 60)
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
 
 using namespace std;
 
+class CMasternodeCacheDB;
 class CMasternodeMan;
 
 extern CMasternodeMan mnodeman;
-void DumpMasternodes();
 
 /** Access to the MN database (mncache.dat)
  */
@@ -66,6 +66,9 @@ private:
     // which Masternodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
 
+    // scores of the masternodes eligible for a block, best first; false if the block is unknown
+    bool GetMasternodeScores(int64_t nBlockHeight, int minProtocol, bool fOnlyActive, std::vector<pair<int64_t, CTxIn> >& vecMasternodeScores);
+
 public:
     // Keep track of all broadcasts I've seen
     map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
@@ -109,12 +112,21 @@ public:
     /// Clear Masternode vector
     void Clear();
 
+    /// Hand every entry to the cache database, which writes those that changed
+    void WriteCache(CMasternodeCacheDB& db);
+
+    /// Replace the contents with what the cache database holds
+    bool ReadCache(CMasternodeCacheDB& db);
+
     int CountEnabled(int protocolVersion = -1);
 
     void CountNetworks(int protocolVersion, int& ipv4, int& ipv6, int& onion);
 
     void DsegUpdate(CNode* pnode);
 
+    /// Summary of the broadcasts a "dseg" answer would announce to us
+    CSyncSetSummary GetSyncSummary();
+
     /// Find an entry
     CMasternode* Find(const CScript& payee);
     CMasternode* Find(const CTxIn& vin);
@@ -137,6 +149,8 @@ public:
 
     std::vector<pair<int, CMasternode> > GetMasternodeRanks(int64_t nBlockHeight, int minProtocol = 0);
     int GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
+    /** Rank of every masternode GetMasternodeRank would rank, computed in one pass */
+    bool GetMasternodeRankMap(int64_t nBlockHeight, std::map<COutPoint, int>& mapRanksRet, int minProtocol = 0, bool fOnlyActive = true);
     CMasternode* GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
 
     void ProcessMasternodeConnections();
@@ -8,6 +8,7 @@
 #include "coincontrol.h"
 #include "init.h"
 #include "main.h"
+#include "masternodecachedb.h"
 #include "masternodeman.h"
 #include "script/sign.h"
 #include "spork.h"
@@ -230,8 +231,8 @@ void CObfuscationPool::ProcessMessageObfuscation(CNode* pfrom, std::string& strC
 
                 CTransaction tx2;
                 uint256 hash;
-                if (GetTransaction(i.prevout.hash, tx2, hash, true)) {
-                    if (tx2.vout.size() > i.prevout.n) {
+                if (GetTransactionOutputs(i.prevout.hash, tx2, hash)) {
+                    if (tx2.vout.size() > i.prevout.n && !tx2.vout[i.prevout.n].IsNull()) {
                         nValueIn += tx2.vout[i.prevout.n].nValue;
                     }
                 } else {
@@ -971,8 +972,8 @@ bool CObfuscationPool::IsCollateralValid(const CTransaction& txCollateral)
     BOOST_FOREACH (const CTxIn i, txCollateral.vin) {
         CTransaction tx2;
         uint256 hash;
-        if (GetTransaction(i.prevout.hash, tx2, hash, true)) {
-            if (tx2.vout.size() > i.prevout.n) {
+        if (GetTransactionOutputs(i.prevout.hash, tx2, hash)) {
+            if (tx2.vout.size() > i.prevout.n && !tx2.vout[i.prevout.n].IsNull()) {
                 nValueIn += tx2.vout[i.prevout.n].nValue;
             }
         } else {
@@ -2111,7 +2112,7 @@ bool CObfuScationSigner::IsVinAssociatedWithPubkey(CTxIn& vin, CPubKey& pubkey)
 
     CTransaction txVin;
     uint256 hash;
-    if (GetTransaction(vin.prevout.hash, txVin, hash, true)) {
+    if (GetTransactionOutputs(vin.prevout.hash, txVin, hash)) {
         BOOST_FOREACH (CTxOut out, txVin.vout) {
             if (out.nValue == 1000 * COIN) {
                 if (out.scriptPubKey == payee2) return true;
@@ -2313,7 +2314,7 @@ void ThreadCheckObfuScationPool()
                 CleanTransactionLocksList();
             }
 
-            //if(c % MASTERNODES_DUMP_SECONDS == 0) DumpMasternodes();
+            if (c % MASTERNODE_CACHE_FLUSH_SECONDS == 0) FlushMasternodeCaches();
 
             obfuScationPool.CheckTimeout();
             obfuScationPool.CheckForCompleteQueue();
@@ -4,9 +4,10 @@
 
 #include "primitives/zerocoin.h"
 
-void CZerocoinSpendReceipt::AddSpend(const CZerocoinSpend& spend)
+void CZerocoinSpendReceipt::AddSpend(const CZerocoinSpend& spend, const CZerocoinSpendTimings& timings)
 {
     vSpends.emplace_back(spend);
+    vTimings.emplace_back(timings);
 }
 
 std::vector<CZerocoinSpend> CZerocoinSpendReceipt::GetSpends()
@@ -14,6 +15,11 @@ std::vector<CZerocoinSpend> CZerocoinSpendReceipt::GetSpends()
     return vSpends;
 }
 
+std::vector<CZerocoinSpendTimings> CZerocoinSpendReceipt::GetSpendTimings()
+{
+    return vTimings;
+}
+
 void CZerocoinSpendReceipt::SetStatus(std::string strStatus, int nStatus, int nNeededSpends)
 {
     strStatusMessage = strStatus;
@@ -172,6 +172,17 @@ public:
     };
 };
 
+/** Microseconds spent building one zerocoin spend input */
+struct CZerocoinSpendTimings {
+    int64_t nWitness;         //! accumulating the witness
+    int64_t nCommitmentPoK;   //! proof that both coin commitments match
+    int64_t nAccumulatorPoK;  //! proof that the coin is in the accumulator
+    int64_t nSerialNumberSoK; //! signature of knowledge of the serial
+    int64_t nVerify;          //! verifying the spend and its serialized copy
+
+    CZerocoinSpendTimings() : nWitness(0), nCommitmentPoK(0), nAccumulatorPoK(0), nSerialNumberSoK(0), nVerify(0) {}
+};
+
 class CZerocoinSpendReceipt
 {
 private:
@@ -179,10 +190,12 @@ private:
     int nStatus;
     int nNeededSpends;
     std::vector<CZerocoinSpend> vSpends;
+    std::vector<CZerocoinSpendTimings> vTimings; //! one per spend
 
 public:
-    void AddSpend(const CZerocoinSpend& spend);
+    void AddSpend(const CZerocoinSpend& spend, const CZerocoinSpendTimings& timings = CZerocoinSpendTimings());
     std::vector<CZerocoinSpend> GetSpends();
+    std::vector<CZerocoinSpendTimings> GetSpendTimings();
     void SetStatus(std::string strStatus, int nStatus, int nNeededSpends = 0);
     std::string GetStatusMessage();
     int GetStatus();
@@ -126,7 +126,13 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"importzerocoins", 0},
         {"exportzerocoins", 0},
         {"exportzerocoins", 1},
-        {"resetmintzerocoin", 0}
+        {"resetmintzerocoin", 0},
+        {"getaddressbalance", 0},
+        {"getaddressutxos", 0},
+        {"getaddresstxids", 0},
+        {"getspentinfo", 0},
+        {"getblockhashes", 0},
+        {"getblockhashes", 1}
     };
 
 class CRPCConvertTable
@@ -10,11 +10,14 @@
 #include "clientversion.h"
 #include "init.h"
 #include "main.h"
+#include "masternode-budget.h"
+#include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpcserver.h"
 #include "spork.h"
+#include "swifttx.h"
 #include "timedata.h"
 #include "util.h"
 #ifdef ENABLE_WALLET
@@ -193,6 +196,86 @@ Value mnsync(const Array& params, bool fHelp)
     return "failure";
 }
 
+template <typename K, typename V, typename Hash>
+static Object ExpiringMapInfo(const expiringmap<K, V, Hash>& map)
+{
+    Object obj;
+    obj.push_back(Pair("entries", (int64_t)map.size()));
+    obj.push_back(Pair("usage", (int64_t)(map.memory_usage() + map.size() * sizeof(V))));
+    obj.push_back(Pair("evicted", (int64_t)map.evicted()));
+    obj.push_back(Pair("maxentries", (int64_t)map.max_size()));
+    obj.push_back(Pair("expiry", map.timeout()));
+    return obj;
+}
+
+Value getmemoryinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getmemoryinfo\n"
+            "\nReturns the size of the bounded masternode, budget and SwiftX message maps.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                (string) one entry per map\n"
+            "    \"entries\": n,          (numeric) Number of entries\n"
+            "    \"usage\": n,            (numeric) Estimated memory usage in bytes\n"
+            "    \"evicted\": n,          (numeric) Entries dropped since startup because they expired or the map was full\n"
+            "    \"maxentries\": n,       (numeric) Most entries kept, 0 for no limit\n"
+            "    \"expiry\": n            (numeric) Seconds an entry is kept, 0 for no limit\n"
+            "  },...\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getmemoryinfo", "") + HelpExampleRpc("getmemoryinfo", ""));
+
+    Object obj;
+    {
+        LOCK(budget.cs);
+        obj.push_back(Pair("budgetvotes", ExpiringMapInfo(budget.mapSeenMasternodeBudgetVotes)));
+        obj.push_back(Pair("orphanbudgetvotes", ExpiringMapInfo(budget.mapOrphanMasternodeBudgetVotes)));
+        obj.push_back(Pair("finalizedbudgetvotes", ExpiringMapInfo(budget.mapSeenFinalizedBudgetVotes)));
+        obj.push_back(Pair("orphanfinalizedbudgetvotes", ExpiringMapInfo(budget.mapOrphanFinalizedBudgetVotes)));
+    }
+    obj.push_back(Pair("syncmnb", ExpiringMapInfo(masternodeSync.mapSeenSyncMNB)));
+    obj.push_back(Pair("syncmnw", ExpiringMapInfo(masternodeSync.mapSeenSyncMNW)));
+    obj.push_back(Pair("syncbudget", ExpiringMapInfo(masternodeSync.mapSeenSyncBudget)));
+    {
+        LOCK(cs_swifttx);
+        obj.push_back(Pair("txlockvotes", ExpiringMapInfo(mapTxLockVote)));
+    }
+    return obj;
+}
+
+Value getswifttxinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getswifttxinfo\n"
+            "\nReturns statistics on the SwiftX lock votes checked since startup.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"votes\": n,              (numeric) Lock votes checked\n"
+            "  \"accepted\": n,           (numeric) Votes with a valid signature that were added to their lock\n"
+            "  \"invalid\": n,            (numeric) Votes dropped because of an invalid signature\n"
+            "  \"batches\": n,            (numeric) Batches the votes were checked in\n"
+            "  \"pending\": n,            (numeric) Votes waiting to be checked\n"
+            "  \"checktime\": n,          (numeric) Microseconds spent checking and applying votes\n"
+            "  \"votespersecond\": x.xxx  (numeric) Votes checked per second over the last minute\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getswifttxinfo", "") + HelpExampleRpc("getswifttxinfo", ""));
+
+    CSwiftTXVoteStats stats = GetSwiftTXVoteStats();
+    Object obj;
+    obj.push_back(Pair("votes", (int64_t)stats.nVotes));
+    obj.push_back(Pair("accepted", (int64_t)stats.nAccepted));
+    obj.push_back(Pair("invalid", (int64_t)stats.nInvalid));
+    obj.push_back(Pair("batches", (int64_t)stats.nBatches));
+    obj.push_back(Pair("pending", (int64_t)stats.nPending));
+    obj.push_back(Pair("checktime", stats.nCheckMicros));
+    obj.push_back(Pair("votespersecond", stats.dVotesPerSecond));
+    return obj;
+}
+
 #ifdef ENABLE_WALLET
 class DescribeAddressVisitor : public boost::static_visitor<Object>
 {
@@ -497,6 +580,253 @@ Value setmocktime(const Array& params, bool fHelp)
     return Value::null;
 }
 
+static bool GetAddressFromIndex(int type, const uint160& hash, std::string& address)
+{
+    if (type == ADDRESS_TYPE_SCRIPTHASH) {
+        address = CBitcoinAddress(CScriptID(hash)).ToString();
+    } else if (type == ADDRESS_TYPE_PUBKEYHASH) {
+        address = CBitcoinAddress(CKeyID(hash)).ToString();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void GetAddressesFromParams(const Array& params, std::vector<std::pair<uint160, int> >& addresses)
+{
+    Array vAddresses;
+    if (params[0].type() == str_type) {
+        vAddresses.push_back(params[0]);
+    } else if (params[0].type() == obj_type) {
+        Value addressValues = find_value(params[0].get_obj(), "addresses");
+        if (addressValues.type() != array_type)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Addresses is expected to be an array");
+        vAddresses = addressValues.get_array();
+    } else {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    BOOST_FOREACH (const Value& value, vAddresses) {
+        if (value.type() != str_type)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+        CBitcoinAddress address(value.get_str());
+        uint160 hashBytes;
+        int type = ADDRESS_TYPE_UNKNOWN;
+        if (!address.GetIndexKey(hashBytes, type))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+        addresses.push_back(std::make_pair(hashBytes, type));
+    }
+}
+
+Value getaddressbalance(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddressbalance\n"
+            "\nReturns the balance for an address(es) (requires -addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\"  (numeric) The current balance in satoshis\n"
+            "  \"received\"  (numeric) The total number of satoshis received (including change)\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"DFHpzVGxMUvBfmKC1Q9x5tY3KK5kdMcqGy\"]}'") +
+            HelpExampleRpc("getaddressbalance", "{\"addresses\": [\"DFHpzVGxMUvBfmKC1Q9x5tY3KK5kdMcqGy\"]}"));
+
+    std::vector<std::pair<uint160, int> > addresses;
+    GetAddressesFromParams(params, addresses);
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressIndex(it->first, it->second, addressIndex))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    CAmount balance = 0;
+    CAmount received = 0;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
+        if (it->second > 0)
+            received += it->second;
+        balance += it->second;
+    }
+
+    Object result;
+    result.push_back(Pair("balance", balance));
+    result.push_back(Pair("received", received));
+    return result;
+}
+
+Value getaddressutxos(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddressutxos\n"
+            "\nReturns all unspent outputs for an address (requires -addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\"  (string) The address base58check encoded\n"
+            "    \"txid\"  (string) The output txid\n"
+            "    \"outputIndex\"  (number) The output index\n"
+            "    \"script\"  (string) The script hex encoded\n"
+            "    \"satoshis\"  (number) The number of satoshis of the output\n"
+            "    \"height\"  (number) The block height\n"
+            "  }\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"DFHpzVGxMUvBfmKC1Q9x5tY3KK5kdMcqGy\"]}'") +
+            HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"DFHpzVGxMUvBfmKC1Q9x5tY3KK5kdMcqGy\"]}"));
+
+    std::vector<std::pair<uint160, int> > addresses;
+    GetAddressesFromParams(params, addresses);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressUnspent(it->first, it->second, unspentOutputs))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    Array result;
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+        std::string address;
+        if (!GetAddressFromIndex(it->first.type, it->first.hashBytes, address))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+
+        Object output;
+        output.push_back(Pair("address", address));
+        output.push_back(Pair("txid", it->first.txhash.GetHex()));
+        output.push_back(Pair("outputIndex", (int)it->first.index));
+        output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
+        output.push_back(Pair("satoshis", it->second.satoshis));
+        output.push_back(Pair("height", it->second.blockHeight));
+        result.push_back(output);
+    }
+    return result;
+}
+
+Value getaddresstxids(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddresstxids\n"
+            "\nReturns the txids for an address(es) (requires -addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\" (number) The start block height\n"
+            "  \"end\" (number) The end block height\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"transactionid\"  (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"DFHpzVGxMUvBfmKC1Q9x5tY3KK5kdMcqGy\"]}'") +
+            HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"DFHpzVGxMUvBfmKC1Q9x5tY3KK5kdMcqGy\"]}"));
+
+    std::vector<std::pair<uint160, int> > addresses;
+    GetAddressesFromParams(params, addresses);
+
+    int start = 0;
+    int end = 0;
+    if (params[0].type() == obj_type) {
+        Value startValue = find_value(params[0].get_obj(), "start");
+        Value endValue = find_value(params[0].get_obj(), "end");
+        if (startValue.type() == int_type && endValue.type() == int_type) {
+            start = startValue.get_int();
+            end = endValue.get_int();
+            if (start <= 0 || end <= 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Start and end are expected to be greater than zero");
+            if (end < start)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "End value is expected to be greater than start");
+        }
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressIndex(it->first, it->second, addressIndex, start, end))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    // Entries come back ordered by (address, height); merge them by height so
+    // multi-address queries list transactions in chain order, once each.
+    std::set<std::pair<int, std::string> > txids;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++)
+        txids.insert(std::make_pair(it->first.blockHeight, it->first.txhash.GetHex()));
+
+    Array result;
+    std::set<std::string> seen;
+    for (std::set<std::pair<int, std::string> >::const_iterator it = txids.begin(); it != txids.end(); it++) {
+        if (seen.insert(it->second).second)
+            result.push_back(it->second);
+    }
+    return result;
+}
+
+Value getspentinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1 || params[0].type() != obj_type)
+        throw runtime_error(
+            "getspentinfo\n"
+            "\nReturns the txid and index where an output is spent (requires -spentindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"txid\" (string) The hex string of the txid\n"
+            "  \"index\" (number) The output index\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\"  (string) The transaction id\n"
+            "  \"index\"  (number) The spending input index\n"
+            "  \"height\"  (number) The height of the block containing the spending transaction\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getspentinfo", "'{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}'") +
+            HelpExampleRpc("getspentinfo", "{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}"));
+
+    Value txidValue = find_value(params[0].get_obj(), "txid");
+    Value indexValue = find_value(params[0].get_obj(), "index");
+    if (txidValue.type() != str_type || indexValue.type() != int_type)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid txid or index");
+
+    uint256 txid = ParseHashV(txidValue, "txid");
+    int outputIndex = indexValue.get_int();
+    if (outputIndex < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid index");
+
+    CSpentIndexKey key(txid, outputIndex);
+    CSpentIndexValue value;
+    if (!GetSpentIndex(key, value))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+
+    Object obj;
+    obj.push_back(Pair("txid", value.txid.GetHex()));
+    obj.push_back(Pair("index", (int)value.inputIndex));
+    obj.push_back(Pair("height", value.blockHeight));
+    return obj;
+}
+
 #ifdef ENABLE_WALLET
 Value getstakingstatus(const Array& params, bool fHelp)
 {
@@ -137,6 +137,78 @@ string HTTPReply(int nStatus, const string& strMsg, bool keepalive, bool headers
     }
 }
 
+string HTTPReplyHeaderChunked(int nStatus, bool keepalive, const char* contentType)
+{
+    return strprintf(
+        "HTTP/1.1 %d %s\r\n"
+        "Date: %s\r\n"
+        "Connection: %s\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Content-Type: %s\r\n"
+        "Server: tpc-json-rpc/%s\r\n"
+        "\r\n",
+        nStatus,
+        httpStatusDescription(nStatus),
+        rfc1123Time(),
+        keepalive ? "keep-alive" : "close",
+        contentType,
+        FormatFullVersion());
+}
+
+HTTPChunkedStreamBuf::HTTPChunkedStreamBuf(std::ostream& streamIn, size_t nChunkSizeIn) : stream(streamIn), vBuffer(std::max(nChunkSizeIn, (size_t)1)), fFinished(false)
+{
+    setp(&vBuffer[0], &vBuffer[0] + vBuffer.size());
+}
+
+HTTPChunkedStreamBuf::~HTTPChunkedStreamBuf()
+{
+    try {
+        Finish();
+    } catch (...) {
+    }
+}
+
+bool HTTPChunkedStreamBuf::WriteChunk()
+{
+    size_t nLen = pptr() - pbase();
+    if (nLen == 0)
+        return true;
+    // A zero-length chunk terminates the body, so empty flushes are skipped above
+    stream << strprintf("%x\r\n", nLen);
+    stream.write(pbase(), nLen);
+    stream << "\r\n";
+    setp(&vBuffer[0], &vBuffer[0] + vBuffer.size());
+    return stream.good();
+}
+
+HTTPChunkedStreamBuf::int_type HTTPChunkedStreamBuf::overflow(int_type ch)
+{
+    if (fFinished || !WriteChunk())
+        return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int HTTPChunkedStreamBuf::sync()
+{
+    if (fFinished || !WriteChunk())
+        return -1;
+    stream.flush();
+    return stream.good() ? 0 : -1;
+}
+
+void HTTPChunkedStreamBuf::Finish()
+{
+    if (fFinished)
+        return;
+    WriteChunk();
+    fFinished = true;
+    stream << "0\r\n\r\n" << std::flush;
+}
+
 bool ReadHTTPRequestLine(std::basic_istream<char>& stream, int& proto, string& http_method, string& http_uri)
 {
     string str;
@@ -211,6 +283,55 @@ int ReadHTTPHeaders(std::basic_istream<char>& stream, map<string, string>& mapHe
 }
 
 
+/**
+ * Read a body sent with chunked transfer encoding: a sequence of
+ * hex-sized chunks terminated by a zero-length chunk and optional trailers.
+ */
+static bool ReadHTTPChunkedBody(std::basic_istream<char>& stream, string& strMessageRet, size_t max_size)
+{
+    while (true) {
+        string str;
+        std::getline(stream, str);
+        if (!stream)
+            return false;
+        // Ignore chunk extensions
+        string::size_type nExt = str.find(';');
+        if (nExt != string::npos)
+            str.resize(nExt);
+        boost::trim(str);
+        if (str.empty() || !IsHex(str.size() % 2 ? "0" + str : str))
+            return false;
+        size_t nChunk = strtoul(str.c_str(), NULL, 16);
+        if (nChunk == 0)
+            break;
+        if (nChunk > max_size - strMessageRet.size())
+            return false;
+
+        // Grow as data arrives, not by the size the client announced
+        size_t ptr = strMessageRet.size();
+        while (nChunk > 0) {
+            size_t bytes_to_read = std::min(nChunk, POST_READ_SIZE);
+            strMessageRet.resize(ptr + bytes_to_read);
+            stream.read(&strMessageRet[ptr], bytes_to_read);
+            if (!stream) // Connection lost while reading
+                return false;
+            ptr += bytes_to_read;
+            nChunk -= bytes_to_read;
+        }
+        // CRLF after chunk data
+        std::getline(stream, str);
+    }
+
+    // Skip trailers up to the final empty line
+    while (true) {
+        string str;
+        std::getline(stream, str);
+        if (!stream || str.empty() || str == "\r")
+            break;
+    }
+    return true;
+}
+
 int ReadHTTPMessage(std::basic_istream<char>& stream, map<string, string>& mapHeadersRet, string& strMessageRet, int nProto, size_t max_size)
 {
     mapHeadersRet.clear();
@@ -222,7 +343,10 @@ int ReadHTTPMessage(std::basic_istream<char>& stream, map<string, string>& mapHe
         return HTTP_INTERNAL_SERVER_ERROR;
 
     // Read message
-    if (nLen > 0) {
+    if (boost::iequals(mapHeadersRet["transfer-encoding"], "chunked")) {
+        if (!ReadHTTPChunkedBody(stream, strMessageRet, max_size))
+            return HTTP_INTERNAL_SERVER_ERROR;
+    } else if (nLen > 0) {
         vector<char> vch;
         size_t ptr = 0;
         while (ptr < (size_t)nLen) {
@@ -285,6 +409,22 @@ string JSONRPCReply(const Value& result, const Value& error, const Value& id)
     return write_string(Value(reply), false) + "\n";
 }
 
+void JSONRPCWriteReply(std::ostream& os, const Value& result, const Value& error, const Value& id)
+{
+    // Produces the same bytes as JSONRPCReply without copying result into a
+    // reply object or rendering it into an intermediate string first
+    os << "{\"result\":";
+    if (error.type() != null_type)
+        os << "null";
+    else
+        write_stream(result, os, false);
+    os << ",\"error\":";
+    write_stream(error, os, false);
+    os << ",\"id\":";
+    write_stream(id, os, false);
+    os << "}\n";
+}
+
 Object JSONRPCError(int code, const string& message)
 {
     Object error;
@@ -14,6 +14,7 @@
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "json/json_spirit_reader_template.h"
 #include "json/json_spirit_utils.h"
@@ -144,10 +145,38 @@ private:
     boost::asio::ssl::stream<typename Protocol::socket>& stream;
 };
 
+/**
+ * Stream buffer that frames everything written through it as HTTP/1.1
+ * chunked transfer encoding on an underlying stream. Output is collected
+ * in a fixed-size buffer and emitted one chunk per buffer fill, so large
+ * replies never have to be materialized as a single string.
+ */
+class HTTPChunkedStreamBuf : public std::streambuf
+{
+public:
+    explicit HTTPChunkedStreamBuf(std::ostream& streamIn, size_t nChunkSizeIn = 64 * 1024);
+    ~HTTPChunkedStreamBuf();
+
+    //! Emit any buffered data followed by the terminating zero-length chunk
+    void Finish();
+
+protected:
+    int_type overflow(int_type ch);
+    int sync();
+
+private:
+    bool WriteChunk();
+
+    std::ostream& stream;
+    std::vector<char> vBuffer;
+    bool fFinished;
+};
+
 std::string HTTPPost(const std::string& strMsg, const std::map<std::string, std::string>& mapRequestHeaders);
 std::string HTTPError(int nStatus, bool keepalive, bool headerOnly = false);
 std::string HTTPReplyHeader(int nStatus, bool keepalive, size_t contentLength, const char* contentType = "application/json");
 std::string HTTPReply(int nStatus, const std::string& strMsg, bool keepalive, bool headerOnly = false, const char* contentType = "application/json");
+std::string HTTPReplyHeaderChunked(int nStatus, bool keepalive, const char* contentType = "application/json");
 bool ReadHTTPRequestLine(std::basic_istream<char>& stream, int& proto, std::string& http_method, std::string& http_uri);
 int ReadHTTPStatus(std::basic_istream<char>& stream, int& proto);
 int ReadHTTPHeaders(std::basic_istream<char>& stream, std::map<std::string, std::string>& mapHeadersRet);
@@ -155,6 +184,7 @@ int ReadHTTPMessage(std::basic_istream<char>& stream, std::map<std::string, std:
 std::string JSONRPCRequest(const std::string& strMethod, const json_spirit::Array& params, const json_spirit::Value& id);
 json_spirit::Object JSONRPCReplyObj(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
 std::string JSONRPCReply(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
+void JSONRPCWriteReply(std::ostream& os, const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
 json_spirit::Object JSONRPCError(int code, const std::string& message);
 
 #endif // BITCOIN_RPCPROTOCOL_H
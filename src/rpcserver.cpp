@@ -29,6 +29,8 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
+#include <set>
+
 using namespace boost;
 using namespace boost::asio;
 using namespace json_spirit;
@@ -272,8 +274,10 @@ static const CRPCCommand vRPCCommands[] =
         {"blockchain", "getblockcount", &getblockcount, true, false, false},
         {"blockchain", "getblock", &getblock, true, false, false},
         {"blockchain", "getblockhash", &getblockhash, true, false, false},
+        {"blockchain", "getblockhashes", &getblockhashes, true, false, false},
         {"blockchain", "getblockheader", &getblockheader, false, false, false},
         {"blockchain", "getchaintips", &getchaintips, true, false, false},
+        {"blockchain", "getspentinfo", &getspentinfo, true, false, false},
         {"blockchain", "getdifficulty", &getdifficulty, true, false, false},
         {"blockchain", "getmempoolinfo", &getmempoolinfo, true, true, false},
         {"blockchain", "getrawmempool", &getrawmempool, true, false, false},
@@ -306,6 +310,11 @@ static const CRPCCommand vRPCCommands[] =
         {"rawtransactions", "sendrawtransaction", &sendrawtransaction, false, false, false},
         {"rawtransactions", "signrawtransaction", &signrawtransaction, false, false, false}, /* uses wallet if enabled */
 
+        /* Address index */
+        {"addressindex", "getaddressbalance", &getaddressbalance, true, false, false},
+        {"addressindex", "getaddressutxos", &getaddressutxos, true, false, false},
+        {"addressindex", "getaddresstxids", &getaddresstxids, true, false, false},
+
         /* Utility functions */
         {"util", "createmultisig", &createmultisig, true, true, false},
         {"util", "validateaddress", &validateaddress, true, false, false}, /* uses wallet if enabled */
@@ -344,6 +353,8 @@ static const CRPCCommand vRPCCommands[] =
         {"tpc", "mnfinalbudget", &mnfinalbudget, true, true, false},
         {"tpc", "checkbudgets", &checkbudgets, true, true, false},
         {"tpc", "mnsync", &mnsync, true, true, false},
+        {"tpc", "getmemoryinfo", &getmemoryinfo, true, true, false},
+        {"tpc", "getswifttxinfo", &getswifttxinfo, true, true, false},
         {"tpc", "spork", &spork, true, true, false},
         {"tpc", "getpoolinfo", &getpoolinfo, true, true, false},
 #ifdef ENABLE_WALLET
@@ -356,7 +367,7 @@ static const CRPCCommand vRPCCommands[] =
         {"wallet", "dumpprivkey", &dumpprivkey, true, false, true},
         {"wallet", "dumpwallet", &dumpwallet, true, false, true},
         {"wallet", "bip38encrypt", &bip38encrypt, true, false, true},
-        {"wallet", "bip38decrypt", &bip38decrypt, true, false, true},
+        {"wallet", "bip38decrypt", &bip38decrypt, true, true, true},
         {"wallet", "encryptwallet", &encryptwallet, true, false, true},
         {"wallet", "getaccountaddress", &getaccountaddress, true, false, true},
         {"wallet", "getaccount", &getaccount, true, false, true},
@@ -366,14 +377,15 @@ static const CRPCCommand vRPCCommands[] =
         {"wallet", "getrawchangeaddress", &getrawchangeaddress, true, false, true},
         {"wallet", "getreceivedbyaccount", &getreceivedbyaccount, false, false, true},
         {"wallet", "getreceivedbyaddress", &getreceivedbyaddress, false, false, true},
+        {"wallet", "getrescaninfo", &getrescaninfo, true, true, true},
         {"wallet", "getstakingstatus", &getstakingstatus, false, false, true},
         {"wallet", "getstakesplitthreshold", &getstakesplitthreshold, false, false, true},
         {"wallet", "gettransaction", &gettransaction, false, false, true},
         {"wallet", "getunconfirmedbalance", &getunconfirmedbalance, false, false, true},
         {"wallet", "getwalletinfo", &getwalletinfo, false, false, true},
-        {"wallet", "importprivkey", &importprivkey, true, false, true},
-        {"wallet", "importwallet", &importwallet, true, false, true},
-        {"wallet", "importaddress", &importaddress, true, false, true},
+        {"wallet", "importprivkey", &importprivkey, true, true, true},
+        {"wallet", "importwallet", &importwallet, true, true, true},
+        {"wallet", "importaddress", &importaddress, true, true, true},
         {"wallet", "keypoolrefill", &keypoolrefill, true, false, true},
         {"wallet", "listaccounts", &listaccounts, false, false, true},
         {"wallet", "listaddressgroupings", &listaddressgroupings, false, false, true},
@@ -914,9 +926,31 @@ static string JSONRPCExecBatch(const Array& vReq)
     return write_string(Value(ret), false) + "\n";
 }
 
+/**
+ * Methods whose results can run to many megabytes. When the client speaks
+ * HTTP/1.1 their replies are written straight to the connection with
+ * chunked transfer encoding instead of being rendered into a string first.
+ */
+static bool IsStreamedRPCMethod(const string& strMethod)
+{
+    static const std::set<string> setStreamed = {
+        "getblock",
+        "getrawmempool",
+        "listtransactions",
+        "listsinceblock",
+        "listunspent",
+        "listmasternodes",
+        "masternode",
+        "getmasternodewinners",
+        "getbudgetinfo",
+    };
+    return setStreamed.count(strMethod) > 0;
+}
+
 static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
     string& strRequest,
     map<string, string>& mapHeaders,
+    int nProto,
     bool fRun)
 {
     // Check authorization
@@ -958,6 +992,16 @@ static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
 
             Value result = tableRPC.execute(jreq.strMethod, jreq.params);
 
+            // Stream large replies without an intermediate copy
+            if (nProto >= 1 && IsStreamedRPCMethod(jreq.strMethod) && GetBoolArg("-rpcstreaming", true)) {
+                conn->stream() << HTTPReplyHeaderChunked(HTTP_OK, fRun);
+                HTTPChunkedStreamBuf chunked(conn->stream());
+                std::ostream os(&chunked);
+                JSONRPCWriteReply(os, result, Value::null, jreq.id);
+                chunked.Finish();
+                return conn->stream().good();
+            }
+
             // Send reply
             strReply = JSONRPCReply(result, Value::null, jreq.id);
 
@@ -999,7 +1043,7 @@ void ServiceConnection(AcceptedConnection* conn)
 
         // Process via JSON-RPC API
         if (strURI == "/") {
-            if (!HTTPReq_JSONRPC(conn, strRequest, mapHeaders, fRun))
+            if (!HTTPReq_JSONRPC(conn, strRequest, mapHeaders, nProto, fRun))
                 break;
 
             // Process via HTTP REST API
@@ -98,9 +98,6 @@ Value getnewaddress(const Array& params, bool fHelp)
     if (params.size() > 0)
         strAccount = AccountFromValue(params[0]);
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
-
     // Generate a new key that is added to wallet
     CPubKey newKey;
     if (!pwalletMain->GetKeyFromPool(newKey))
@@ -183,9 +180,6 @@ Value getrawchangeaddress(const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getrawchangeaddress", "") + HelpExampleRpc("getrawchangeaddress", ""));
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
-
     CReserveKey reservekey(pwalletMain);
     CPubKey vchPubKey;
     if (!reservekey.GetReservedKey(vchPubKey))
@@ -1637,7 +1631,8 @@ Value walletpassphrase(const Array& params, bool fHelp)
     if (!pwalletMain->Unlock(strWalletPass, anonymizeOnly))
         throw JSONRPCError(RPC_WALLET_PASSPHRASE_INCORRECT, "Error: The wallet passphrase entered was incorrect.");
 
-    pwalletMain->TopUpKeyPool();
+    pwalletMain->RequestKeyPoolTopUp();
+    pwalletMain->RequestMintPoolRefill();
 
     int64_t nSleepTime = params[1].get_int64();
     LOCK(cs_nWalletUnlockTime);
@@ -1916,6 +1911,14 @@ Value getwalletinfo(const Array& params, bool fHelp)
             "  \"keypoololdest\": xxxxxx,    (numeric) the timestamp (seconds since GMT epoch) of the oldest pre-generated key in the key pool\n"
             "  \"keypoolsize\": xxxx,        (numeric) how many new keys are pre-generated\n"
             "  \"unlocked_until\": ttt,      (numeric) the timestamp in seconds since epoch (midnight Jan 1 1970 GMT) that the wallet is unlocked for transfers, or 0 if the wallet is locked\n"
+            "  \"keypoolfiller\": {          (json object) the background key pool filler\n"
+            "    \"running\": true|false,    (boolean) whether the filler thread is running\n"
+            "    \"lowwatermark\": n,        (numeric) key pool size that triggers a refill (-keypoollow)\n"
+            "    \"fills\": n,               (numeric) refills done by the filler\n"
+            "    \"backgroundkeys\": n,      (numeric) keys generated by the filler\n"
+            "    \"foregroundkeys\": n,      (numeric) keys generated while reserving a key\n"
+            "    \"lastfillms\": n           (numeric) duration of the last refill in milliseconds\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getwalletinfo", "") + HelpExampleRpc("getwalletinfo", ""));
@@ -1928,6 +1931,48 @@ Value getwalletinfo(const Array& params, bool fHelp)
     obj.push_back(Pair("keypoolsize", (int)pwalletMain->GetKeyPoolSize()));
     if (pwalletMain->IsCrypted())
         obj.push_back(Pair("unlocked_until", nWalletUnlockTime));
+
+    CKeyPoolFillStats stats = pwalletMain->GetKeyPoolFillStats();
+    Object filler;
+    filler.push_back(Pair("running", stats.fRunning));
+    filler.push_back(Pair("lowwatermark", std::min(GetArg("-keypoollow", DEFAULT_KEYPOOL_LOW), GetArg("-keypool", 1000))));
+    filler.push_back(Pair("fills", stats.nFills));
+    filler.push_back(Pair("backgroundkeys", stats.nBackgroundKeys));
+    filler.push_back(Pair("foregroundkeys", stats.nForegroundKeys));
+    filler.push_back(Pair("lastfillms", stats.nLastFillMicros / 1000));
+    obj.push_back(Pair("keypoolfiller", filler));
+    return obj;
+}
+
+Value getrescaninfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrescaninfo\n"
+            "Returns the progress of the current or last wallet rescan.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"active\": true|false,      (boolean) whether a rescan is running\n"
+            "  \"startheight\": n,          (numeric) the height the rescan started at\n"
+            "  \"height\": n,               (numeric) the last block height committed to the wallet\n"
+            "  \"stopheight\": n,           (numeric) the chain height the rescan is heading for\n"
+            "  \"progress\": x.xxx,         (numeric) verification progress of the last committed block, 0 to 1\n"
+            "  \"found\": n,                (numeric) wallet transactions found so far\n"
+            "  \"duration\": n,             (numeric) seconds since the running rescan started\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrescaninfo", "") + HelpExampleRpc("getrescaninfo", ""));
+
+    CWalletRescanStatus status = pwalletMain->GetRescanStatus();
+
+    Object obj;
+    obj.push_back(Pair("active", status.fActive));
+    obj.push_back(Pair("startheight", status.nStartHeight));
+    obj.push_back(Pair("height", status.nHeight));
+    obj.push_back(Pair("stopheight", status.nStopHeight));
+    obj.push_back(Pair("progress", status.dProgress));
+    obj.push_back(Pair("found", status.nFound));
+    obj.push_back(Pair("duration", status.fActive ? GetTime() - status.nStartTime : 0));
     return obj;
 }
 
@@ -2330,8 +2375,7 @@ Value listmintedzerocoins(const Array& params, bool fHelp)
     if (pwalletMain->IsLocked())
         throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
     
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-    list<CZerocoinMint> listPubCoin = walletdb.ListMintedCoins(true, false, true);
+    list<CZerocoinMint> listPubCoin = pwalletMain->zTPCTracker->ListMints(true, false, true);
     
     Array jsonList;
     for (const CZerocoinMint& pubCoinItem : listPubCoin) {
@@ -2352,8 +2396,7 @@ Value listzerocoinamounts(const Array& params, bool fHelp)
     if (pwalletMain->IsLocked())
         throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
 
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-    list<CZerocoinMint> listPubCoin = walletdb.ListMintedCoins(true, true, true);
+    list<CZerocoinMint> listPubCoin = pwalletMain->zTPCTracker->ListMints(true, true, true);
  
     std::map<libzerocoin::CoinDenomination, CAmount> spread;
     for (const auto& denom : libzerocoin::zerocoinDenomList)
@@ -2384,12 +2427,11 @@ Value listspentzerocoins(const Array& params, bool fHelp)
     if (pwalletMain->IsLocked())
         throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
 
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-    list<CBigNum> listPubCoin = walletdb.ListSpentCoinsSerial();
+    list<CZerocoinSpend> listSpends = pwalletMain->zTPCTracker->ListSpends();
 
     Array jsonList;
-    for (const CBigNum& pubCoinItem : listPubCoin) {
-        jsonList.push_back(pubCoinItem.GetHex());
+    for (const CZerocoinSpend& spend : listSpends) {
+        jsonList.push_back(spend.GetSerial().GetHex());
     }
 
     return jsonList;
@@ -2487,13 +2529,23 @@ Value spendzerocoin(const Array& params, bool fHelp)
 
     CAmount nValueIn = 0;
     Array arrSpends;
-    for (CZerocoinSpend spend : receipt.GetSpends()) {
+    std::vector<CZerocoinSpend> vSpends = receipt.GetSpends();
+    std::vector<CZerocoinSpendTimings> vTimings = receipt.GetSpendTimings();
+    for (unsigned int i = 0; i < vSpends.size(); i++) {
+        const CZerocoinSpend& spend = vSpends[i];
         Object obj;
         obj.push_back(Pair("denomination", spend.GetDenomination()));
         obj.push_back(Pair("pubcoin", spend.GetPubCoin().GetHex()));
         obj.push_back(Pair("serial", spend.GetSerial().GetHex()));
         uint32_t nChecksum = spend.GetAccumulatorChecksum();
         obj.push_back(Pair("acc_checksum", HexStr(BEGIN(nChecksum), END(nChecksum))));
+        Object timings;
+        timings.push_back(Pair("witness", vTimings[i].nWitness / 1000));
+        timings.push_back(Pair("commitmentpok", vTimings[i].nCommitmentPoK / 1000));
+        timings.push_back(Pair("accumulatorpok", vTimings[i].nAccumulatorPoK / 1000));
+        timings.push_back(Pair("serialsok", vTimings[i].nSerialNumberSoK / 1000));
+        timings.push_back(Pair("verify", vTimings[i].nVerify / 1000));
+        obj.push_back(Pair("time_ms", timings));
         arrSpends.push_back(obj);
         nValueIn += libzerocoin::ZerocoinDenominationToAmount(spend.GetDenomination());
     }
@@ -2543,8 +2595,7 @@ Value resetmintzerocoin(const Array& params, bool fHelp)
     if (params.size() == 1)
         fExtendedSearch = params[0].get_bool();
 
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, true);
+    list<CZerocoinMint> listMints = pwalletMain->zTPCTracker->ListMints(false, false, true);
     vector<CZerocoinMint> vMintsToFind{ std::make_move_iterator(std::begin(listMints)), std::make_move_iterator(std::end(listMints)) };
     vector<CZerocoinMint> vMintsMissing;
     vector<CZerocoinMint> vMintsToUpdate;
@@ -2555,7 +2606,7 @@ Value resetmintzerocoin(const Array& params, bool fHelp)
     // update the meta data of mints that were marked for updating
     Array arrUpdated;
     for (CZerocoinMint mint : vMintsToUpdate) {
-        walletdb.WriteZerocoinMint(mint);
+        pwalletMain->zTPCTracker->Add(mint);
         arrUpdated.push_back(mint.GetValue().GetHex());
     }
 
@@ -2563,7 +2614,7 @@ Value resetmintzerocoin(const Array& params, bool fHelp)
     Array arrDeleted;
     for (CZerocoinMint mint : vMintsMissing) {
         arrDeleted.push_back(mint.GetValue().GetHex());
-        walletdb.ArchiveMintOrphan(mint);
+        pwalletMain->zTPCTracker->Archive(mint);
     }
 
     Object obj;
@@ -2580,9 +2631,8 @@ Value resetspentzerocoin(const Array& params, bool fHelp)
                 "Scan the blockchain for all of the zerocoins that are held in the wallet.dat. Reset mints that are considered spent that did not make it into the blockchain."
             + HelpRequiringPassphrase());
 
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, false);
-    list<CZerocoinSpend> listSpends = walletdb.ListSpentCoins();
+    list<CZerocoinMint> listMints = pwalletMain->zTPCTracker->ListMints(false, false, false);
+    list<CZerocoinSpend> listSpends = pwalletMain->zTPCTracker->ListSpends();
     list<CZerocoinSpend> listUnconfirmedSpends;
 
     for (CZerocoinSpend spend : listSpends) {
@@ -2604,8 +2654,8 @@ Value resetspentzerocoin(const Array& params, bool fHelp)
         for (CZerocoinMint mint : listMints) {
             if (mint.GetSerialNumber() == spend.GetSerial()) {
                 mint.SetUsed(false);
-                walletdb.WriteZerocoinMint(mint);
-                walletdb.EraseZerocoinSpendSerialEntry(spend.GetSerial());
+                pwalletMain->zTPCTracker->Add(mint);
+                pwalletMain->zTPCTracker->EraseSpend(spend.GetSerial());
                 RemoveSerialFromDB(spend.GetSerial());
                 Object obj;
                 obj.push_back(Pair("serial", spend.GetSerial().GetHex()));
@@ -2676,13 +2726,11 @@ Value exportzerocoins(const Array& params, bool fHelp)
     if (pwalletMain->IsLocked())
         throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
 
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-
     bool fIncludeSpent = params[0].get_bool();
     libzerocoin::CoinDenomination denomination = libzerocoin::ZQ_ERROR;
     if (params.size() == 2)
         denomination = libzerocoin::IntToZerocoinDenomination(params[1].get_int());
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(!fIncludeSpent, false, false);
+    list<CZerocoinMint> listMints = pwalletMain->zTPCTracker->ListMints(!fIncludeSpent, false, false);
 
     Array jsonList;
     for (const CZerocoinMint mint : listMints) {
@@ -2729,7 +2777,6 @@ Value importzerocoins(const Array& params, bool fHelp)
 
     RPCTypeCheck(params, list_of(array_type)(obj_type));
     Array arrMints = params[0].get_array();
-    CWalletDB walletdb(pwalletMain->strWalletFile);
 
     int count = 0;
     CAmount nValue = 0;
@@ -2754,7 +2801,7 @@ Value importzerocoins(const Array& params, bool fHelp)
         CZerocoinMint mint(denom, bnValue, bnRandom, bnSerial, fUsed);
         mint.SetTxHash(txid);
         mint.SetHeight(nHeight);
-        walletdb.WriteZerocoinMint(mint);
+        pwalletMain->zTPCTracker->Add(mint);
         count++;
         nValue += libzerocoin::ZerocoinDenominationToAmount(denom);
     }
@@ -14,6 +14,9 @@
 #include "sync.h"
 #include "sporkdb.h"
 #include "util.h"
+
+#include <atomic>
+
 #include <boost/lexical_cast.hpp>
 
 using namespace std;
@@ -27,6 +30,63 @@ CSporkManager sporkManager;
 std::map<uint256, CSporkMessage> mapSporks;
 std::map<int, CSporkMessage> mapSporksActive;
 
+// the value a spork has until the network sets it, -1 for unknown sporks
+static int64_t GetSporkDefaultValue(int nSporkID)
+{
+    int64_t r = -1;
+
+    if (nSporkID == SPORK_2_SWIFTTX) r = SPORK_2_SWIFTTX_DEFAULT;
+    if (nSporkID == SPORK_3_SWIFTTX_BLOCK_FILTERING) r = SPORK_3_SWIFTTX_BLOCK_FILTERING_DEFAULT;
+    if (nSporkID == SPORK_5_MAX_VALUE) r = SPORK_5_MAX_VALUE_DEFAULT;
+    if (nSporkID == SPORK_7_MASTERNODE_SCANNING) r = SPORK_7_MASTERNODE_SCANNING_DEFAULT;
+    if (nSporkID == SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT) r = SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT;
+    if (nSporkID == SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT) r = SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT_DEFAULT;
+    if (nSporkID == SPORK_10_MASTERNODE_PAY_UPDATED_NODES) r = SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT;
+    if (nSporkID == SPORK_11_LOCK_INVALID_UTXO) r = SPORK_11_LOCK_INVALID_UTXO_DEFAULT;
+    if (nSporkID == SPORK_13_ENABLE_SUPERBLOCKS) r = SPORK_13_ENABLE_SUPERBLOCKS_DEFAULT;
+    if (nSporkID == SPORK_14_NEW_PROTOCOL_ENFORCEMENT) r = SPORK_14_NEW_PROTOCOL_ENFORCEMENT_DEFAULT;
+    if (nSporkID == SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2) r = SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2_DEFAULT;
+    if (nSporkID == SPORK_16_ZEROCOIN_MAINTENANCE_MODE) r = SPORK_16_ZEROCOIN_MAINTENANCE_MODE_DEFAULT;
+    if (nSporkID == SPORK_18_OPERATION_FUND) r = SPORK_18_OPERATION_FUND_DEFAULT;
+    if (nSporkID == SPORK_20_SPAM_CHK) r = SPORK_20_SPAM_CHK_DEFAULT;
+    if (nSporkID == SPORK_21_STAKE_REQ_AG) r = SPORK_21_STAKE_REQ_AG_DEFAULT;
+    if (nSporkID == SPORK_22_STAKE_REQ_SZ) r = SPORK_22_STAKE_REQ_SZ_DEFAULT;
+
+    return r;
+}
+
+/**
+ * Current value of every spork id, indexed from SPORK_START. The hot paths
+ * read it with a single atomic load; mapSporksActive stays the record of the
+ * messages themselves and is only consulted when sporks are received or sent.
+ */
+class CSporkValues
+{
+private:
+    std::atomic<int64_t> vValues[SPORK_END - SPORK_START + 1];
+
+public:
+    CSporkValues()
+    {
+        for (int i = SPORK_START; i <= SPORK_END; ++i)
+            vValues[i - SPORK_START].store(GetSporkDefaultValue(i));
+    }
+
+    static bool InRange(int nSporkID) { return nSporkID >= SPORK_START && nSporkID <= SPORK_END; }
+
+    int64_t Get(int nSporkID) const { return vValues[nSporkID - SPORK_START].load(); }
+    void Set(int nSporkID, int64_t nValue) { vValues[nSporkID - SPORK_START].store(nValue); }
+};
+
+static CSporkValues sporkValues;
+
+// record a spork as the active one for its id
+static void SetSporkActive(const CSporkMessage& spork)
+{
+    mapSporksActive[spork.nSporkID] = spork;
+    if (CSporkValues::InRange(spork.nSporkID)) sporkValues.Set(spork.nSporkID, spork.nValue);
+}
+
 // TPC: on startup load spork values from previous session if they exist in the sporkDB
 void LoadSporksFromDB()
 {
@@ -44,7 +104,7 @@ void LoadSporksFromDB()
 
         // add spork to memory
         mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        SetSporkActive(spork);
         std::time_t result = spork.nValue;
         // If SPORK Value is greater than 1,000,000 assume it's actually a Date and then convert to a more readable format
         if (spork.nValue > 1000000) {
@@ -93,7 +153,7 @@ void ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
         }
 
         mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        SetSporkActive(spork);
         sporkManager.Relay(spork);
 
         // TPC: add to spork database.
@@ -115,26 +175,15 @@ int64_t GetSporkValue(int nSporkID)
 {
     int64_t r = -1;
 
+    if (CSporkValues::InRange(nSporkID)) {
+        r = sporkValues.Get(nSporkID);
+        if (r != -1) return r;
+    }
+
     if (mapSporksActive.count(nSporkID)) {
         r = mapSporksActive[nSporkID].nValue;
     } else {
-        if (nSporkID == SPORK_2_SWIFTTX) r = SPORK_2_SWIFTTX_DEFAULT;
-        if (nSporkID == SPORK_3_SWIFTTX_BLOCK_FILTERING) r = SPORK_3_SWIFTTX_BLOCK_FILTERING_DEFAULT;
-        if (nSporkID == SPORK_5_MAX_VALUE) r = SPORK_5_MAX_VALUE_DEFAULT;
-        if (nSporkID == SPORK_7_MASTERNODE_SCANNING) r = SPORK_7_MASTERNODE_SCANNING_DEFAULT;
-        if (nSporkID == SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT) r = SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT;
-        if (nSporkID == SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT) r = SPORK_9_MASTERNODE_BUDGET_ENFORCEMENT_DEFAULT;
-        if (nSporkID == SPORK_10_MASTERNODE_PAY_UPDATED_NODES) r = SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT;
-        if (nSporkID == SPORK_11_LOCK_INVALID_UTXO) r = SPORK_11_LOCK_INVALID_UTXO_DEFAULT;
-        if (nSporkID == SPORK_13_ENABLE_SUPERBLOCKS) r = SPORK_13_ENABLE_SUPERBLOCKS_DEFAULT;
-        if (nSporkID == SPORK_14_NEW_PROTOCOL_ENFORCEMENT) r = SPORK_14_NEW_PROTOCOL_ENFORCEMENT_DEFAULT;
-        if (nSporkID == SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2) r = SPORK_15_NEW_PROTOCOL_ENFORCEMENT_2_DEFAULT;
-        if (nSporkID == SPORK_16_ZEROCOIN_MAINTENANCE_MODE) r = SPORK_16_ZEROCOIN_MAINTENANCE_MODE_DEFAULT;
-        if (nSporkID == SPORK_18_OPERATION_FUND) r = SPORK_18_OPERATION_FUND_DEFAULT;
-        if (nSporkID == SPORK_20_SPAM_CHK) r = SPORK_20_SPAM_CHK_DEFAULT;
-        if (nSporkID == SPORK_21_STAKE_REQ_AG) r = SPORK_21_STAKE_REQ_AG_DEFAULT;
-        if (nSporkID == SPORK_22_STAKE_REQ_SZ) r = SPORK_22_STAKE_REQ_SZ_DEFAULT;
-
+        r = GetSporkDefaultValue(nSporkID);
         if (r == -1) LogPrintf("GetSpork::Unknown Spork %d\n", nSporkID);
     }
 
@@ -230,7 +279,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue)
     if (Sign(msg)) {
         Relay(msg);
         mapSporks[msg.GetHash()] = msg;
-        mapSporksActive[nSporkID] = msg;
+        SetSporkActive(msg);
         return true;
     }
 
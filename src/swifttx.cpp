@@ -14,19 +14,34 @@
 #include "spork.h"
 #include "sync.h"
 #include "util.h"
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
 
 using namespace std;
 using namespace boost;
 
-std::map<uint256, CTransaction> mapTxLockReq;
-std::map<uint256, CTransaction> mapTxLockReqRejected;
-std::map<uint256, CConsensusVote> mapTxLockVote;
-std::map<uint256, CTransactionLock> mapTxLocks;
+CCriticalSection cs_swifttx;
+
+TxLockReqMap mapTxLockReq;
+TxLockReqMap mapTxLockReqRejected;
+expiringmap<uint256, CConsensusVote, BlockHasher> mapTxLockVote(SWIFTTX_LOCK_VOTE_EXPIRY, MAX_SWIFTTX_LOCK_VOTES);
+TxLockMap mapTxLocks;
 std::map<COutPoint, uint256> mapLockedInputs;
 std::map<uint256, int64_t> mapUnknownVotes; //track votes with no tx for DOS
 int nCompleteTXLocks;
 
+// lock votes waiting for their signature check, each with a reference on its sender
+static CWaitableCriticalSection cs_pendingVotes;
+static CConditionVariable condPendingVotes;
+static std::vector<std::pair<CConsensusVote, CNode*> > vecPendingVotes;
+
+// masternode ranks of recent lock heights, with the time they were computed
+static std::map<int, std::pair<int64_t, std::map<COutPoint, int> > > mapVoterRanks;
+
+static CSwiftTXVoteStats voteStats = CSwiftTXVoteStats();
+static int64_t nVoteRateStart = 0;
+static uint64_t nVoteRateVotes = 0;
+
 //txlock - Locks transaction
 //
 //step 1.) Broadcast intention to lock transaction inputs, "txlreg", CTransaction
@@ -34,12 +49,17 @@ int nCompleteTXLocks;
 //         Send "txvote", CTransaction, Signature, Approve
 //step 3.) Top 1 masternode, waits for SWIFTTX_SIGNATURES_REQUIRED messages. Upon success, sends "txlock'
 
+static bool IsConsensusVoterValid(CNode* pnode, CConsensusVote& ctx);
+static bool QueueConsensusVote(const CConsensusVote& ctx, CNode* pnode);
+
 void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
 {
     if (fLiteMode) return; //disable all obfuscation/masternode related functionality
     if (!IsSporkActive(SPORK_2_SWIFTTX)) return;
     if (!masternodeSync.IsBlockchainSynced()) return;
 
+    LOCK2(cs_main, cs_swifttx);
+
     if (strCommand == "ix") {
         //LogPrintf("ProcessMessageSwiftTX::ix\n");
         CDataStream vMsg(vRecv);
@@ -105,7 +125,7 @@ void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& v
             }
 
             // resolve conflicts
-            std::map<uint256, CTransactionLock>::iterator i = mapTxLocks.find(tx.GetHash());
+            TxLockMap::iterator i = mapTxLocks.find(tx.GetHash());
             if (i != mapTxLocks.end()) {
                 //we only care if we have a complete tx lock
                 if ((*i).second.CountSignatures() >= SWIFTTX_SIGNATURES_REQUIRED) {
@@ -135,29 +155,11 @@ void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& v
 
         mapTxLockVote.insert(make_pair(ctx.GetHash(), ctx));
 
-        if (ProcessConsensusVote(pfrom, ctx)) {
-            //Spam/Dos protection
-            /*
-                Masternodes will sometimes propagate votes before the transaction is known to the client.
-                This tracks those messages and allows it at the same rate of the rest of the network, if
-                a peer violates it, it will simply be ignored
-            */
-            if (!mapTxLockReq.count(ctx.txHash) && !mapTxLockReqRejected.count(ctx.txHash)) {
-                if (!mapUnknownVotes.count(ctx.vinMasternode.prevout.hash)) {
-                    mapUnknownVotes[ctx.vinMasternode.prevout.hash] = GetTime() + (60 * 10);
-                }
-
-                if (mapUnknownVotes[ctx.vinMasternode.prevout.hash] > GetTime() &&
-                    mapUnknownVotes[ctx.vinMasternode.prevout.hash] - GetAverageVoteTime() > 60 * 10) {
-                    LogPrintf("ProcessMessageSwiftTX::ix - masternode is spamming transaction votes: %s %s\n",
-                        ctx.vinMasternode.ToString().c_str(),
-                        ctx.txHash.ToString().c_str());
-                    return;
-                } else {
-                    mapUnknownVotes[ctx.vinMasternode.prevout.hash] = GetTime() + (60 * 10);
-                }
-            }
-            RelayInv(inv);
+        // ThreadSwiftTXVotes checks the signature and applies the vote
+        if (!IsConsensusVoterValid(pfrom, ctx)) return;
+        if (!QueueConsensusVote(ctx, pfrom)) {
+            LogPrint("swiftx", "ProcessMessageSwiftTX::txlvote - too many pending votes, ignoring %s\n", ctx.GetHash().ToString());
+            mapTxLockVote.erase(ctx.GetHash());
         }
 
         return;
@@ -179,8 +181,8 @@ bool IsIXTXValid(const CTransaction& txCollateral)
     BOOST_FOREACH (const CTxIn i, txCollateral.vin) {
         CTransaction tx2;
         uint256 hash;
-        if (GetTransaction(i.prevout.hash, tx2, hash, true)) {
-            if (tx2.vout.size() > i.prevout.n) {
+        if (GetTransactionOutputs(i.prevout.hash, tx2, hash)) {
+            if (tx2.vout.size() > i.prevout.n && !tx2.vout[i.prevout.n].IsNull()) {
                 nValueIn += tx2.vout[i.prevout.n].nValue;
             }
         } else {
@@ -248,12 +250,42 @@ int64_t CreateNewLock(CTransaction tx)
     return nBlockHeight;
 }
 
+// Rank of a masternode among the lock voters of nBlockHeight, -1 if unknown.
+// The ranks of a height are computed once and reused for SWIFTTX_VOTER_RANKS_SECONDS,
+// instead of rescoring the whole masternode list for every vote.
+static int GetConsensusVoterRank(const CTxIn& vin, int nBlockHeight)
+{
+    int64_t nNow = GetTime();
+    std::map<int, std::pair<int64_t, std::map<COutPoint, int> > >::iterator it = mapVoterRanks.find(nBlockHeight);
+    if (it == mapVoterRanks.end() || nNow - it->second.first > SWIFTTX_VOTER_RANKS_SECONDS) {
+        std::map<COutPoint, int> mapRanks;
+        if (!mnodeman.GetMasternodeRankMap(nBlockHeight, mapRanks, MIN_SWIFTTX_PROTO_VERSION))
+            return -1;
+
+        std::map<int, std::pair<int64_t, std::map<COutPoint, int> > >::iterator itStale = mapVoterRanks.begin();
+        while (itStale != mapVoterRanks.end()) {
+            if (nNow - itStale->second.first > SWIFTTX_VOTER_RANKS_SECONDS)
+                mapVoterRanks.erase(itStale++);
+            else
+                ++itStale;
+        }
+        while (mapVoterRanks.size() >= MAX_SWIFTTX_VOTER_RANK_HEIGHTS)
+            mapVoterRanks.erase(mapVoterRanks.begin());
+
+        it = mapVoterRanks.insert(make_pair(nBlockHeight, make_pair(nNow, std::map<COutPoint, int>()))).first;
+        it->second.second.swap(mapRanks);
+    }
+
+    std::map<COutPoint, int>::const_iterator itRank = it->second.second.find(vin.prevout);
+    return itRank == it->second.second.end() ? -1 : itRank->second;
+}
+
 // check if we need to vote on this transaction
 void DoConsensusVote(CTransaction& tx, int64_t nBlockHeight)
 {
     if (!fMasterNode) return;
 
-    int n = mnodeman.GetMasternodeRank(activeMasternode.vin, nBlockHeight, MIN_SWIFTTX_PROTO_VERSION);
+    int n = GetConsensusVoterRank(activeMasternode.vin, nBlockHeight);
 
     if (n == -1) {
         LogPrint("swiftx", "SwiftX::DoConsensusVote - Unknown Masternode\n");
@@ -289,10 +321,10 @@ void DoConsensusVote(CTransaction& tx, int64_t nBlockHeight)
     RelayInv(inv);
 }
 
-//received a consensus vote
-bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
+// is the sender of a consensus vote one of the masternodes allowed to vote on its lock?
+static bool IsConsensusVoterValid(CNode* pnode, CConsensusVote& ctx)
 {
-    int n = mnodeman.GetMasternodeRank(ctx.vinMasternode, ctx.nBlockHeight, MIN_SWIFTTX_PROTO_VERSION);
+    int n = GetConsensusVoterRank(ctx.vinMasternode, ctx.nBlockHeight);
 
     CMasternode* pmn = mnodeman.Find(ctx.vinMasternode);
     if (pmn != NULL)
@@ -310,13 +342,27 @@ bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
         return false;
     }
 
-    if (!ctx.SignatureValid()) {
-        LogPrintf("SwiftX::ProcessConsensusVote - Signature invalid\n");
-        // don't ban, it could just be a non-synced masternode
-        mnodeman.AskForMN(pnode, ctx.vinMasternode);
-        return false;
+    return true;
+}
+
+static bool QueueConsensusVote(const CConsensusVote& ctx, CNode* pnode)
+{
+    boost::unique_lock<boost::mutex> lock(cs_pendingVotes);
+    if (vecPendingVotes.size() >= MAX_SWIFTTX_PENDING_VOTES) return false;
+
+    {
+        // keep the peer around until its vote has been processed
+        LOCK(cs_vNodes);
+        pnode->AddRef();
     }
+    vecPendingVotes.push_back(std::make_pair(ctx, pnode));
+    condPendingVotes.notify_one();
+    return true;
+}
 
+// add a consensus vote with a valid signature to its transaction lock
+static void AddConsensusVote(CConsensusVote& ctx)
+{
     if (!mapTxLocks.count(ctx.txHash)) {
         LogPrintf("SwiftX::ProcessConsensusVote - New Transaction Lock %s !\n", ctx.txHash.ToString().c_str());
 
@@ -330,55 +376,185 @@ bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx)
         LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Exists %s !\n", ctx.txHash.ToString().c_str());
 
     //compile consessus vote
-    std::map<uint256, CTransactionLock>::iterator i = mapTxLocks.find(ctx.txHash);
-    if (i != mapTxLocks.end()) {
-        (*i).second.AddSignature(ctx);
+    CTransactionLock& txLock = mapTxLocks[ctx.txHash];
+    txLock.AddSignature(ctx);
 
 #ifdef ENABLE_WALLET
-        if (pwalletMain) {
-            //when we get back signatures, we'll count them as requests. Otherwise the client will think it didn't propagate.
-            if (pwalletMain->mapRequestCount.count(ctx.txHash))
-                pwalletMain->mapRequestCount[ctx.txHash]++;
-        }
+    if (pwalletMain) {
+        //when we get back signatures, we'll count them as requests. Otherwise the client will think it didn't propagate.
+        if (pwalletMain->mapRequestCount.count(ctx.txHash))
+            pwalletMain->mapRequestCount[ctx.txHash]++;
+    }
 #endif
 
-        LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Votes %d - %s !\n", (*i).second.CountSignatures(), ctx.GetHash().ToString().c_str());
+    LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Votes %d - %s !\n", txLock.CountSignatures(), ctx.GetHash().ToString().c_str());
+}
+
+// lock the inputs of a transaction once enough votes for it came in
+static void CheckTransactionLockComplete(const uint256& txHash)
+{
+    TxLockMap::iterator i = mapTxLocks.find(txHash);
+    if (i == mapTxLocks.end()) return;
 
-        if ((*i).second.CountSignatures() >= SWIFTTX_SIGNATURES_REQUIRED) {
-            LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Is Complete %s !\n", (*i).second.GetHash().ToString().c_str());
+    if ((*i).second.CountSignatures() >= SWIFTTX_SIGNATURES_REQUIRED) {
+        LogPrint("swiftx", "SwiftX::ProcessConsensusVote - Transaction Lock Is Complete %s !\n", (*i).second.GetHash().ToString().c_str());
 
-            CTransaction& tx = mapTxLockReq[ctx.txHash];
-            if (!CheckForConflictingLocks(tx)) {
+        CTransaction& tx = mapTxLockReq[txHash];
+        if (!CheckForConflictingLocks(tx)) {
 #ifdef ENABLE_WALLET
-                if (pwalletMain) {
-                    if (pwalletMain->UpdatedTransaction((*i).second.txHash)) {
-                        nCompleteTXLocks++;
-                    }
+            if (pwalletMain) {
+                if (pwalletMain->UpdatedTransaction((*i).second.txHash)) {
+                    nCompleteTXLocks++;
                 }
+            }
 #endif
 
-                if (mapTxLockReq.count(ctx.txHash)) {
-                    BOOST_FOREACH (const CTxIn& in, tx.vin) {
-                        if (!mapLockedInputs.count(in.prevout)) {
-                            mapLockedInputs.insert(make_pair(in.prevout, ctx.txHash));
-                        }
+            if (mapTxLockReq.count(txHash)) {
+                BOOST_FOREACH (const CTxIn& in, tx.vin) {
+                    if (!mapLockedInputs.count(in.prevout)) {
+                        mapLockedInputs.insert(make_pair(in.prevout, txHash));
                     }
                 }
+            }
 
-                // resolve conflicts
+            // resolve conflicts
 
-                //if this tx lock was rejected, we need to remove the conflicting blocks
-                if (mapTxLockReqRejected.count((*i).second.txHash)) {
-                    //reprocess the last 15 blocks
-                    ReprocessBlocks(15);
-                }
+            //if this tx lock was rejected, we need to remove the conflicting blocks
+            if (mapTxLockReqRejected.count((*i).second.txHash)) {
+                //reprocess the last 15 blocks
+                ReprocessBlocks(15);
             }
         }
-        return true;
+    }
+}
+
+static void RelayConsensusVote(CConsensusVote& ctx)
+{
+    //Spam/Dos protection
+    /*
+        Masternodes will sometimes propagate votes before the transaction is known to the client.
+        This tracks those messages and allows it at the same rate of the rest of the network, if
+        a peer violates it, it will simply be ignored
+    */
+    if (!mapTxLockReq.count(ctx.txHash) && !mapTxLockReqRejected.count(ctx.txHash)) {
+        if (!mapUnknownVotes.count(ctx.vinMasternode.prevout.hash)) {
+            mapUnknownVotes[ctx.vinMasternode.prevout.hash] = GetTime() + (60 * 10);
+        }
+
+        if (mapUnknownVotes[ctx.vinMasternode.prevout.hash] > GetTime() &&
+            mapUnknownVotes[ctx.vinMasternode.prevout.hash] - GetAverageVoteTime() > 60 * 10) {
+            LogPrintf("ProcessMessageSwiftTX::ix - masternode is spamming transaction votes: %s %s\n",
+                ctx.vinMasternode.ToString().c_str(),
+                ctx.txHash.ToString().c_str());
+            return;
+        } else {
+            mapUnknownVotes[ctx.vinMasternode.prevout.hash] = GetTime() + (60 * 10);
+        }
     }
 
+    CInv inv(MSG_TXLOCK_VOTE, ctx.GetHash());
+    RelayInv(inv);
+}
 
-    return false;
+struct CompareConsensusVoteByLock {
+    bool operator()(const std::pair<CConsensusVote, CNode*>& a, const std::pair<CConsensusVote, CNode*>& b) const
+    {
+        return a.first.txHash < b.first.txHash;
+    }
+};
+
+// Wait for lock votes from peers, check their signatures and apply them in one batch
+static void ProcessPendingConsensusVotes()
+{
+    std::vector<std::pair<CConsensusVote, CNode*> > vecVotes;
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pendingVotes);
+        while (vecPendingVotes.empty())
+            condPendingVotes.wait(lock);
+        vecVotes.swap(vecPendingVotes);
+    }
+
+    int64_t nStart = GetTimeMicros();
+
+    // Group the votes of each lock, so a lock is completed once per batch
+    std::stable_sort(vecVotes.begin(), vecVotes.end(), CompareConsensusVoteByLock());
+
+    // Check the signatures first, without holding up the message handler
+    std::vector<bool> vValid(vecVotes.size());
+    for (unsigned int i = 0; i < vecVotes.size(); i++) {
+        vValid[i] = vecVotes[i].first.SignatureValid();
+        if (!vValid[i]) {
+            LogPrintf("SwiftX::ProcessConsensusVote - Signature invalid\n");
+            // don't ban, it could just be a non-synced masternode
+            mnodeman.AskForMN(vecVotes[i].second, vecVotes[i].first.vinMasternode);
+        }
+    }
+
+    unsigned int nAccepted = 0;
+    {
+        // completing a lock may reprocess blocks and touches the locked inputs
+        LOCK2(cs_main, cs_swifttx);
+        bool fLockChanged = false;
+        for (unsigned int i = 0; i < vecVotes.size(); i++) {
+            CConsensusVote& ctx = vecVotes[i].first;
+            if (vValid[i]) {
+                AddConsensusVote(ctx);
+                RelayConsensusVote(ctx);
+                fLockChanged = true;
+                nAccepted++;
+            }
+
+            bool fLastOfLock = i + 1 == vecVotes.size() || vecVotes[i + 1].first.txHash != ctx.txHash;
+            if (fLastOfLock && fLockChanged) {
+                CheckTransactionLockComplete(ctx.txHash);
+                fLockChanged = false;
+            }
+        }
+
+        int64_t nNow = GetTime();
+        voteStats.nVotes += vecVotes.size();
+        voteStats.nAccepted += nAccepted;
+        voteStats.nInvalid += vecVotes.size() - nAccepted;
+        voteStats.nBatches++;
+        voteStats.nCheckMicros += GetTimeMicros() - nStart;
+        if (nVoteRateStart == 0) nVoteRateStart = nNow;
+        nVoteRateVotes += vecVotes.size();
+        if (nNow - nVoteRateStart >= 60) {
+            voteStats.dVotesPerSecond = (double)nVoteRateVotes / (nNow - nVoteRateStart);
+            nVoteRateStart = nNow;
+            nVoteRateVotes = 0;
+        }
+    }
+
+    {
+        LOCK(cs_vNodes);
+        for (unsigned int i = 0; i < vecVotes.size(); i++)
+            vecVotes[i].second->Release();
+    }
+
+    LogPrint("swiftx", "SwiftX::ProcessPendingConsensusVotes - %u votes, %u accepted  %dus\n", vecVotes.size(), nAccepted, GetTimeMicros() - nStart);
+}
+
+void ThreadSwiftTXVotes()
+{
+    if (fLiteMode) return; //disable all obfuscation/masternode related functionality
+
+    RenameThread("tpc-swifttx");
+
+    while (true)
+        ProcessPendingConsensusVotes();
+}
+
+CSwiftTXVoteStats GetSwiftTXVoteStats()
+{
+    CSwiftTXVoteStats stats;
+    {
+        LOCK(cs_swifttx);
+        stats = voteStats;
+    }
+    boost::unique_lock<boost::mutex> lock(cs_pendingVotes);
+    stats.nPending = vecPendingVotes.size();
+    return stats;
 }
 
 bool CheckForConflictingLocks(CTransaction& tx)
@@ -423,7 +599,10 @@ void CleanTransactionLocksList()
 {
     if (chainActive.Tip() == NULL) return;
 
-    std::map<uint256, CTransactionLock>::iterator it = mapTxLocks.begin();
+    LOCK2(cs_main, cs_swifttx);
+    mapTxLockVote.expire();
+
+    TxLockMap::iterator it = mapTxLocks.begin();
 
     while (it != mapTxLocks.end()) {
         if (GetTime() > it->second.nExpiration) { //keep them for an hour
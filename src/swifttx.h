@@ -7,6 +7,7 @@
 #define SWIFTTX_H
 
 #include "base58.h"
+#include "expiringmap.h"
 #include "key.h"
 #include "main.h"
 #include "net.h"
@@ -34,11 +35,25 @@ class CTransaction;
 class CTransactionLock;
 
 static const int MIN_SWIFTTX_PROTO_VERSION = 70103;
-
-extern map<uint256, CTransaction> mapTxLockReq;
-extern map<uint256, CTransaction> mapTxLockReqRejected;
-extern map<uint256, CConsensusVote> mapTxLockVote;
-extern map<uint256, CTransactionLock> mapTxLocks;
+//! Lock votes are forgotten after the lifetime of a lock
+static const int64_t SWIFTTX_LOCK_VOTE_EXPIRY = 60 * 60;
+static const unsigned int MAX_SWIFTTX_LOCK_VOTES = 100000;
+//! Lock votes waiting for ThreadSwiftTXVotes to check them; more are dropped unseen
+static const unsigned int MAX_SWIFTTX_PENDING_VOTES = 10000;
+//! Seconds the masternode ranks of a block are reused to check lock voters
+static const int64_t SWIFTTX_VOTER_RANKS_SECONDS = 60;
+static const unsigned int MAX_SWIFTTX_VOTER_RANK_HEIGHTS = 32;
+
+typedef boost::unordered_map<uint256, CTransaction, BlockHasher> TxLockReqMap;
+typedef boost::unordered_map<uint256, CTransactionLock, BlockHasher> TxLockMap;
+
+// protects the SwiftX maps against the message handler, ThreadSwiftTXVotes and the cleanup
+extern CCriticalSection cs_swifttx;
+
+extern TxLockReqMap mapTxLockReq;
+extern TxLockReqMap mapTxLockReqRejected;
+extern expiringmap<uint256, CConsensusVote, BlockHasher> mapTxLockVote;
+extern TxLockMap mapTxLocks;
 extern std::map<COutPoint, uint256> mapLockedInputs;
 extern int nCompleteTXLocks;
 
@@ -55,14 +70,27 @@ void ProcessMessageSwiftTX(CNode* pfrom, std::string& strCommand, CDataStream& v
 //check if we need to vote on this transaction
 void DoConsensusVote(CTransaction& tx, int64_t nBlockHeight);
 
-//process consensus vote message
-bool ProcessConsensusVote(CNode* pnode, CConsensusVote& ctx);
+//check and apply the lock votes received from peers, in batches
+void ThreadSwiftTXVotes();
 
 // keep transaction locks in memory for an hour
 void CleanTransactionLocksList();
 
 int64_t GetAverageVoteTime();
 
+/** Counters of the lock votes checked by ThreadSwiftTXVotes */
+struct CSwiftTXVoteStats {
+    uint64_t nVotes;        // votes checked
+    uint64_t nAccepted;     // votes added to a lock
+    uint64_t nInvalid;      // votes with a bad signature
+    uint64_t nBatches;
+    uint64_t nPending;      // votes waiting to be checked
+    int64_t nCheckMicros;   // time spent checking and applying votes
+    double dVotesPerSecond; // votes checked per second over the last full minute
+};
+
+CSwiftTXVoteStats GetSwiftTXVoteStats();
+
 class CConsensusVote
 {
 public:
@@ -0,0 +1,179 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "base58.h"
+#include "key.h"
+#include "main.h"
+#include "script/standard.h"
+#include "spentindex.h"
+#include "timestampindex.h"
+#include "txdb.h"
+
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+BOOST_AUTO_TEST_CASE(address_index_key_types)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    CScript redeemScript = GetScriptForDestination(pubkey.GetID());
+
+    uint160 hashBytes;
+    int type = ADDRESS_TYPE_UNKNOWN;
+
+    BOOST_CHECK(GetAddressIndexKey(GetScriptForDestination(pubkey.GetID()), hashBytes, type));
+    BOOST_CHECK_EQUAL(type, ADDRESS_TYPE_PUBKEYHASH);
+    BOOST_CHECK(hashBytes == pubkey.GetID());
+
+    // Pay-to-pubkey outputs land under the matching P2PKH address
+    hashBytes = 0;
+    type = ADDRESS_TYPE_UNKNOWN;
+    BOOST_CHECK(GetAddressIndexKey(CScript() << ToByteVector(pubkey) << OP_CHECKSIG, hashBytes, type));
+    BOOST_CHECK_EQUAL(type, ADDRESS_TYPE_PUBKEYHASH);
+    BOOST_CHECK(hashBytes == pubkey.GetID());
+
+    BOOST_CHECK(GetAddressIndexKey(GetScriptForDestination(CScriptID(redeemScript)), hashBytes, type));
+    BOOST_CHECK_EQUAL(type, ADDRESS_TYPE_SCRIPTHASH);
+    BOOST_CHECK(hashBytes == CScriptID(redeemScript));
+
+    BOOST_CHECK(!GetAddressIndexKey(CScript() << OP_RETURN, hashBytes, type));
+
+    // Addresses given to the RPCs must resolve to the same keys
+    BOOST_CHECK(CBitcoinAddress(pubkey.GetID()).GetIndexKey(hashBytes, type));
+    BOOST_CHECK_EQUAL(type, ADDRESS_TYPE_PUBKEYHASH);
+    BOOST_CHECK(hashBytes == pubkey.GetID());
+    BOOST_CHECK(CBitcoinAddress(CScriptID(redeemScript)).GetIndexKey(hashBytes, type));
+    BOOST_CHECK_EQUAL(type, ADDRESS_TYPE_SCRIPTHASH);
+    BOOST_CHECK(hashBytes == CScriptID(redeemScript));
+}
+
+BOOST_AUTO_TEST_CASE(address_index_write_erase_read)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hashA(1), hashB(2);
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+    vEntries.push_back(std::make_pair(CAddressIndexKey(ADDRESS_TYPE_PUBKEYHASH, hashA, 20, 0, uint256(3), 0, true), -50));
+    vEntries.push_back(std::make_pair(CAddressIndexKey(ADDRESS_TYPE_PUBKEYHASH, hashA, 5, 1, uint256(1), 0, false), 50));
+    vEntries.push_back(std::make_pair(CAddressIndexKey(ADDRESS_TYPE_PUBKEYHASH, hashA, 10, 2, uint256(2), 1, false), 70));
+    vEntries.push_back(std::make_pair(CAddressIndexKey(ADDRESS_TYPE_SCRIPTHASH, hashA, 10, 0, uint256(4), 0, false), 90));
+    vEntries.push_back(std::make_pair(CAddressIndexKey(ADDRESS_TYPE_PUBKEYHASH, hashB, 10, 0, uint256(5), 0, false), 30));
+    BOOST_CHECK(db.WriteAddressIndex(vEntries));
+
+    // Entries come back in height order, limited to the address and its type
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vRead;
+    BOOST_CHECK(db.ReadAddressIndex(hashA, ADDRESS_TYPE_PUBKEYHASH, vRead));
+    BOOST_REQUIRE_EQUAL(vRead.size(), 3);
+    BOOST_CHECK_EQUAL(vRead[0].first.blockHeight, 5);
+    BOOST_CHECK_EQUAL(vRead[1].first.blockHeight, 10);
+    BOOST_CHECK_EQUAL(vRead[2].first.blockHeight, 20);
+    BOOST_CHECK_EQUAL(vRead[2].second, -50);
+    BOOST_CHECK(vRead[2].first.spending);
+
+    vRead.clear();
+    BOOST_CHECK(db.ReadAddressIndex(hashA, ADDRESS_TYPE_PUBKEYHASH, vRead, 6, 15));
+    BOOST_REQUIRE_EQUAL(vRead.size(), 1);
+    BOOST_CHECK(vRead[0].first.txhash == uint256(2));
+    BOOST_CHECK_EQUAL(vRead[0].second, 70);
+
+    vRead.clear();
+    BOOST_CHECK(db.ReadAddressIndex(hashA, ADDRESS_TYPE_SCRIPTHASH, vRead));
+    BOOST_CHECK_EQUAL(vRead.size(), 1);
+
+    // Disconnecting the block at height 20 erases its entries
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vErase(1, vEntries[0]);
+    BOOST_CHECK(db.EraseAddressIndex(vErase));
+    vRead.clear();
+    BOOST_CHECK(db.ReadAddressIndex(hashA, ADDRESS_TYPE_PUBKEYHASH, vRead));
+    BOOST_REQUIRE_EQUAL(vRead.size(), 2);
+    BOOST_CHECK_EQUAL(vRead[1].first.blockHeight, 10);
+
+    vRead.clear();
+    BOOST_CHECK(db.ReadAddressIndex(hashB, ADDRESS_TYPE_PUBKEYHASH, vRead));
+    BOOST_CHECK_EQUAL(vRead.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(address_unspent_index_update)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hashA(1);
+    CScript script = CScript() << OP_TRUE;
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUpdate;
+    vUpdate.push_back(std::make_pair(CAddressUnspentKey(ADDRESS_TYPE_PUBKEYHASH, hashA, uint256(1), 0), CAddressUnspentValue(50, script, 5)));
+    vUpdate.push_back(std::make_pair(CAddressUnspentKey(ADDRESS_TYPE_PUBKEYHASH, hashA, uint256(2), 1), CAddressUnspentValue(70, script, 10)));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vUpdate));
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vRead;
+    BOOST_CHECK(db.ReadAddressUnspentIndex(hashA, ADDRESS_TYPE_PUBKEYHASH, vRead));
+    BOOST_CHECK_EQUAL(vRead.size(), 2);
+
+    // A null value spends the output
+    vUpdate.clear();
+    vUpdate.push_back(std::make_pair(CAddressUnspentKey(ADDRESS_TYPE_PUBKEYHASH, hashA, uint256(1), 0), CAddressUnspentValue()));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vUpdate));
+
+    vRead.clear();
+    BOOST_CHECK(db.ReadAddressUnspentIndex(hashA, ADDRESS_TYPE_PUBKEYHASH, vRead));
+    BOOST_REQUIRE_EQUAL(vRead.size(), 1);
+    BOOST_CHECK(vRead[0].first.txhash == uint256(2));
+    BOOST_CHECK_EQUAL(vRead[0].second.satoshis, 70);
+    BOOST_CHECK_EQUAL(vRead[0].second.blockHeight, 10);
+    BOOST_CHECK(vRead[0].second.script == script);
+}
+
+BOOST_AUTO_TEST_CASE(spent_index_update)
+{
+    CBlockTreeDB db(1 << 20, true);
+    CSpentIndexKey key(uint256(1), 0);
+    CSpentIndexValue value;
+    BOOST_CHECK(!db.ReadSpentIndex(key, value));
+
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vUpdate;
+    vUpdate.push_back(std::make_pair(key, CSpentIndexValue(uint256(2), 3, 10, 50, ADDRESS_TYPE_PUBKEYHASH, uint160(4))));
+    BOOST_CHECK(db.UpdateSpentIndex(vUpdate));
+    BOOST_CHECK(db.ReadSpentIndex(key, value));
+    BOOST_CHECK(value.txid == uint256(2));
+    BOOST_CHECK_EQUAL(value.inputIndex, 3);
+    BOOST_CHECK_EQUAL(value.blockHeight, 10);
+    BOOST_CHECK_EQUAL(value.satoshis, 50);
+    BOOST_CHECK_EQUAL(value.addressType, ADDRESS_TYPE_PUBKEYHASH);
+    BOOST_CHECK(value.addressHash == uint160(4));
+
+    // Disconnecting the spend writes a null value, which erases the entry
+    vUpdate.clear();
+    vUpdate.push_back(std::make_pair(key, CSpentIndexValue()));
+    BOOST_CHECK(db.UpdateSpentIndex(vUpdate));
+    BOOST_CHECK(!db.ReadSpentIndex(key, value));
+}
+
+BOOST_AUTO_TEST_CASE(timestamp_index_write_erase_read)
+{
+    CBlockTreeDB db(1 << 20, true);
+    BOOST_CHECK(db.WriteTimestampIndex(CTimestampIndexKey(1000, uint256(1))));
+    BOOST_CHECK(db.WriteTimestampIndex(CTimestampIndexKey(2000, uint256(2))));
+    BOOST_CHECK(db.WriteTimestampIndex(CTimestampIndexKey(3000, uint256(3))));
+
+    // The range includes low and excludes high
+    std::vector<uint256> vHashes;
+    BOOST_CHECK(db.ReadTimestampIndex(3000, 1000, vHashes));
+    BOOST_REQUIRE_EQUAL(vHashes.size(), 2);
+    BOOST_CHECK(vHashes[0] == uint256(1));
+    BOOST_CHECK(vHashes[1] == uint256(2));
+
+    BOOST_CHECK(db.EraseTimestampIndex(CTimestampIndexKey(1000, uint256(1))));
+    vHashes.clear();
+    BOOST_CHECK(db.ReadTimestampIndex(4000, 0, vHashes));
+    BOOST_REQUIRE_EQUAL(vHashes.size(), 2);
+    BOOST_CHECK(vHashes[0] == uint256(2));
+    BOOST_CHECK(vHashes[1] == uint256(3));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
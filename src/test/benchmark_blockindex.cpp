@@ -0,0 +1,85 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//
+// Benchmark of chain walks over block index entries in the layouts they are loaded in
+//
+
+#include "chain.h"
+#include "main.h"
+#include "random.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#define BENCHMARK_CHAIN_LENGTH 300000
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(benchmark_blockindex)
+
+BOOST_AUTO_TEST_CASE(benchmark_blockindex_arena)
+{
+    // Entries loaded from the block tree database arrive in hash order, and
+    // allocated one at a time they end up scattered between the map nodes
+    // allocated alongside them. A snapshot load fills the arena in height order.
+    vector<int> vHashOrder(BENCHMARK_CHAIN_LENGTH);
+    for (int i = 0; i < BENCHMARK_CHAIN_LENGTH; i++)
+        vHashOrder[i] = i;
+    for (int i = BENCHMARK_CHAIN_LENGTH - 1; i > 0; i--)
+        swap(vHashOrder[i], vHashOrder[insecure_rand() % (i + 1)]);
+
+    const char* strLayout[] = {"Heap, hash order", "Arena, hash order", "Arena, height order"};
+    int64_t nSum[3];
+    cout << "\tBLOCK INDEX WALK ELAPSED TIME (" << BENCHMARK_CHAIN_LENGTH << " entries):" << endl;
+    for (int nLayout = 0; nLayout < 3; nLayout++) {
+        CBlockIndexArena arena;
+        vector<CBlockIndex*> vIndex(BENCHMARK_CHAIN_LENGTH);
+        vector<vector<char>*> vMapNodes;
+        for (int i = 0; i < BENCHMARK_CHAIN_LENGTH; i++) {
+            int nHeight = nLayout == 2 ? i : vHashOrder[i];
+            if (nLayout == 0) {
+                vIndex[nHeight] = new CBlockIndex();
+                vMapNodes.push_back(new vector<char>(64));
+            } else {
+                vIndex[nHeight] = arena.Create();
+            }
+        }
+        for (int i = 0; i < BENCHMARK_CHAIN_LENGTH; i++) {
+            vIndex[i]->nHeight = i;
+            vIndex[i]->pprev = i ? vIndex[i - 1] : NULL;
+            vIndex[i]->BuildSkip();
+        }
+
+        CChain chain;
+        chain.SetTip(vIndex[BENCHMARK_CHAIN_LENGTH / 2]);
+        int64_t nStart = GetTimeMicros();
+        nSum[nLayout] = 0;
+        for (int n = 0; n < 10; n++) {
+            for (const CBlockIndex* pindex = vIndex.back(); pindex; pindex = pindex->pprev)
+                nSum[nLayout] += pindex->nHeight;
+        }
+        for (int n = 0; n < 100000; n++) {
+            int nFrom = (n * 7919) % BENCHMARK_CHAIN_LENGTH;
+            nSum[nLayout] += vIndex[nFrom]->GetAncestor((n * 104729) % (nFrom + 1))->nHeight;
+            nSum[nLayout] += chain.FindFork(vIndex[nFrom])->nHeight;
+        }
+        cout << "\t\t" << strLayout[nLayout] << ": " << (GetTimeMicros() - nStart) / 1000 << " ms" << endl;
+
+        if (nLayout == 0) {
+            for (int i = 0; i < BENCHMARK_CHAIN_LENGTH; i++) {
+                delete vIndex[i];
+                delete vMapNodes[i];
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(nSum[0], nSum[1]);
+    BOOST_CHECK_EQUAL(nSum[0], nSum[2]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
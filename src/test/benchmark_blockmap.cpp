@@ -0,0 +1,62 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//
+// Benchmark of the memory-mapped block read path against fopen reads
+//
+
+#include "blockmap.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "main.h"
+#include "utiltime.h"
+
+#include <iostream>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(benchmark_blockmap)
+
+BOOST_AUTO_TEST_CASE(benchmark_block_read)
+{
+    // Rescans and witness generation read blocks back to back
+    const int nBlocks = 1000;
+    const int nPasses = 5;
+    const int nFile = 99;
+
+    CBlock genesis = Params().GenesisBlock();
+    unsigned int nEnd = 0;
+    vector<CDiskBlockPos> vPos;
+    for (int i = 0; i < nBlocks; i++) {
+        CDiskBlockPos pos(nFile, nEnd);
+        BOOST_REQUIRE(WriteBlockToDisk(genesis, pos));
+        nEnd = pos.nPos + ::GetSerializeSize(genesis, SER_DISK, CLIENT_VERSION);
+        vPos.push_back(pos);
+    }
+
+    int64_t nElapsed[2];
+    for (int fMapped = 0; fMapped < 2; fMapped++) {
+        blockFileMaps.SetMaxFiles(fMapped ? DEFAULT_BLOCK_MAP_FILES : 0);
+        int64_t nStart = GetTimeMicros();
+        for (int nPass = 0; nPass < nPasses; nPass++) {
+            BOOST_FOREACH (const CDiskBlockPos& pos, vPos) {
+                CBlock block;
+                BOOST_CHECK(ReadBlockFromDisk(block, pos));
+            }
+        }
+        nElapsed[fMapped] = GetTimeMicros() - nStart;
+    }
+
+    cout << "\tBLOCK READ ELAPSED TIME (" << nBlocks * nPasses << " reads):\n\t\tfopen: " << nElapsed[0] / 1000 << " ms\n\t\tMapped: " << nElapsed[1] / 1000 << " ms" << endl;
+
+    blockFileMaps.Invalidate(nFile);
+    boost::filesystem::remove(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk"));
+    blockFileMaps.SetMaxFiles(DEFAULT_BLOCK_MAP_FILES);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
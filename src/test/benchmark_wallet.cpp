@@ -0,0 +1,108 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//
+// Benchmarks of wallet coin selection and wallet database writes
+//
+
+#include "random.h"
+#include "utiltime.h"
+#include "wallet.h"
+#include "walletdb.h"
+
+#include <iostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(benchmark_wallet)
+
+BOOST_AUTO_TEST_CASE(benchmark_coin_selection)
+{
+    // Build sends from a wallet holding 100k outputs of 0.01 to 100 coins
+    const int nOutputs = 100000;
+    CWallet wallet;
+    vector<COutput> vCoins;
+    seed_insecure_rand(true);
+    for (int i = 0; i < nOutputs; i++) {
+        CMutableTransaction tx;
+        tx.nLockTime = i; // so all transactions get different hashes
+        tx.vout.resize(1);
+        tx.vout[0].nValue = (1 + insecure_rand() % 10000) * CENT;
+        vCoins.push_back(COutput(new CWalletTx(&wallet, tx), 0, 6 * 24, true));
+    }
+
+    set<pair<const CWalletTx*, unsigned int> > setCoinsRet;
+    CAmount nValueRet;
+    const CAmount vTargets[] = {CENT / 2, 5 * CENT, 3 * COIN, 250 * COIN, 20000 * COIN};
+    const int nTargets = sizeof(vTargets) / sizeof(vTargets[0]);
+    {
+        LOCK(wallet.cs_wallet);
+
+        int64_t nStart = GetTimeMicros();
+        BOOST_FOREACH (const CAmount& nTarget, vTargets) {
+            BOOST_CHECK(wallet.SelectCoinsMinConf(nTarget, 1, 6, vCoins, setCoinsRet, nValueRet));
+            BOOST_CHECK(nValueRet >= nTarget);
+        }
+        int64_t nSelect = GetTimeMicros() - nStart;
+
+        // The passes of one send share a single sorted pool
+        CCoinSelectionPool pool;
+        nStart = GetTimeMicros();
+        wallet.BuildCoinSelectionPool(vCoins, pool);
+        int64_t nBuild = GetTimeMicros() - nStart;
+
+        nStart = GetTimeMicros();
+        BOOST_FOREACH (const CAmount& nTarget, vTargets)
+            BOOST_CHECK(wallet.SelectCoinsMinConf(nTarget, 1, 6, pool, setCoinsRet, nValueRet));
+        int64_t nSelectPool = GetTimeMicros() - nStart;
+
+        cout << "\tCOIN SELECTION ELAPSED TIME (" << nOutputs << " outputs, " << nTargets << " sends):\n\t\tSelect: " << nSelect / 1000 << " ms\n\t\tPool build: " << nBuild / 1000 << " ms\n\t\tSelect from pool: " << nSelectPool / 1000 << " ms" << endl;
+    }
+
+    BOOST_FOREACH (COutput output, vCoins)
+        delete output.tx;
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_walletdb_batch)
+{
+    // A zerocoin mint of many coins and a block paying the wallet many times
+    // each write one record per coin or transaction
+    const int nRecords = 500;
+    const string strFile = "wallet_batch_benchmark.dat";
+    CWallet wallet;
+    CWalletDB(strFile, "cr+");
+
+    int64_t nElapsed[2];
+    for (int fBatched = 0; fBatched < 2; fBatched++) {
+        int64_t nStart = GetTimeMicros();
+        {
+            CWalletDBBatch* pbatch = fBatched ? new CWalletDBBatch(strFile) : NULL;
+            for (int i = 0; i < nRecords; i++) {
+                CZerocoinMint mint(libzerocoin::ZQ_ONE, CBigNum(1000 * fBatched + i + 1), CBigNum(100000 + 1000 * fBatched + i), CBigNum(3), false);
+                BOOST_CHECK(CWalletDB(strFile).WriteZerocoinMint(mint));
+
+                CMutableTransaction tx;
+                tx.nLockTime = 1000 * fBatched + i;
+                tx.vout.resize(1);
+                tx.vout[0].nValue = i + 1;
+                CWalletTx wtx(&wallet, tx);
+                BOOST_CHECK(CWalletDB(strFile).WriteTx(wtx.GetHash(), wtx));
+            }
+            if (pbatch)
+                BOOST_CHECK(pbatch->Commit());
+            delete pbatch;
+        }
+        nElapsed[fBatched] = GetTimeMicros() - nStart;
+    }
+
+    cout << "\tWALLET DB WRITE ELAPSED TIME (" << nRecords << " mints and " << nRecords << " transactions):\n\t\tUnbatched: " << nElapsed[0] / 1000 << " ms\n\t\tBatched: " << nElapsed[1] / 1000 << " ms" << endl;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
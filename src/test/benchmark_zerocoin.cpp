@@ -19,12 +19,14 @@
 #include <exception>
 #include <cstdlib>
 #include <sys/time.h>
+#include "random.h"
 #include "streams.h"
 #include "libzerocoin/ParamGeneration.h"
 #include "libzerocoin/Denominations.h"
 #include "libzerocoin/Coin.h"
 #include "libzerocoin/CoinSpend.h"
 #include "libzerocoin/Accumulator.h"
+#include "libzerocoin/SerialNumberSignatureOfKnowledge.h"
 
 using namespace std;
 using namespace libzerocoin;
@@ -337,10 +339,12 @@ Testb_MintAndSpend()
 
 		// Now spend the coin
 		timer.start();
-		CoinSpend spend(gg_Params, *(ggCoins[0]), acc, 0, wAcc, 0); //(0) presstab
+		CoinSpendTimings timings;
+		CoinSpend spend(gg_Params, *(ggCoins[0]), acc, 0, wAcc, 0, &timings); //(0) presstab
 		timer.stop();
 
 		cout << "\tSPEND ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+		cout << "\t\tCommitment PoK: " << timings.nCommitmentPoK / 1000 << " ms\n\t\tAccumulator PoK: " << timings.nAccumulatorPoK / 1000 << " ms\n\t\tSerial Number SoK: " << timings.nSerialNumberSoK / 1000 << " ms" << endl;
 
 		// Serialize the proof and deserialize into newSpend
 		CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
@@ -369,6 +373,71 @@ Testb_MintAndSpend()
 	return false;
 }
 
+bool
+Testb_SerialNumberSoKVerify()
+{
+	try {
+		if (ggCoins[0] == NULL)
+		{
+			Testb_MintCoin();
+			if (ggCoins[0] == NULL) {
+				return false;
+			}
+		}
+
+		const PrivateCoin& coin = *(ggCoins[0]);
+		Commitment commitment(&gg_Params->serialNumberSoKCommitmentGroup, coin.getPublicCoin().getValue());
+		uint256 msghash = GetRandHash();
+		uint256 msghashWrong = msghash;
+		++msghashWrong;
+
+		timer.start();
+		SerialNumberSignatureOfKnowledge sok(gg_Params, coin, commitment, msghash);
+		timer.stop();
+
+		cout << "\tSERIAL NUMBER SOK PROVE ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << endl;
+
+		const CBigNum serial = coin.getSerialNumber();
+		const CBigNum value = commitment.getCommitmentValue();
+
+		// The optimized verifier must agree with the reference one on the
+		// valid proof and on each kind of forgery
+		if (!sok.VerifyReference(serial, value, msghash) || !sok.Verify(serial, value, msghash))
+			return false;
+		if (sok.Verify(serial, value, msghashWrong) || sok.VerifyReference(serial, value, msghashWrong))
+			return false;
+		if (sok.Verify(serial + 1, value, msghash) || sok.VerifyReference(serial + 1, value, msghash))
+			return false;
+		if (sok.Verify(serial, value + 1, msghash) || sok.VerifyReference(serial, value + 1, msghash))
+			return false;
+
+		// Warm the per-params tables before timing
+		sok.Verify(serial, value, msghash);
+
+		const int nRounds = 5;
+		timer.start();
+		for (int i = 0; i < nRounds; i++)
+			sok.VerifyReference(serial, value, msghash);
+		timer.stop();
+		int nReference = timer.duration() / nRounds;
+
+		timer.start();
+		for (int i = 0; i < nRounds; i++)
+			sok.Verify(serial, value, msghash);
+		timer.stop();
+		int nOptimized = timer.duration() / nRounds;
+
+		cout << "\tSERIAL NUMBER SOK VERIFY ELAPSED TIME:\n\t\tReference: " << nReference << " ms\n\t\tOptimized: " << nOptimized << " ms" << endl;
+
+		return true;
+	} catch (runtime_error &e) {
+		cout << e.what() << endl;
+		return false;
+	}
+
+	return false;
+}
+
 void
 Testb_RunAllTests()
 {
@@ -388,6 +457,7 @@ Testb_RunAllTests()
 	gLogTestResult("coins can be minted", Testb_MintCoin);
 	gLogTestResult("the accumulator works", Testb_Accumulator);
 	gLogTestResult("a minted coin can be spent", Testb_MintAndSpend);
+	gLogTestResult("the serial number proof verifiers agree", Testb_SerialNumberSoKVerify);
 
 	// Summarize test results
 	if (ggSuccessfulTests < ggNumTests) {
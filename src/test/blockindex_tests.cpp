@@ -0,0 +1,182 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "clientversion.h"
+#include "main.h"
+#include "streams.h"
+#include "txdb.h"
+
+#include <map>
+#include <stdexcept>
+#include <stdio.h>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace libzerocoin;
+
+BOOST_AUTO_TEST_SUITE(blockindex_tests)
+
+BOOST_AUTO_TEST_CASE(blockindex_zerocoin_fields_format)
+{
+    // The compact fields must read and write the block index records written
+    // with a std::map supply and a std::vector of minted denominations
+    std::map<CoinDenomination, int64_t> mapSupply;
+    CZerocoinSupply supply;
+    for (unsigned int i = 0; i < zerocoinDenomList.size(); i++) {
+        mapSupply[zerocoinDenomList[i]] = 1000 * i + 7;
+        supply.at(zerocoinDenomList[i]) = 1000 * i + 7;
+    }
+
+    CDataStream ssMap(SER_DISK, CLIENT_VERSION), ssSupply(SER_DISK, CLIENT_VERSION);
+    ssMap << mapSupply;
+    ssSupply << supply;
+    BOOST_CHECK(ssMap.str() == ssSupply.str());
+    BOOST_CHECK_EQUAL(ssSupply.size(), ::GetSerializeSize(supply, SER_DISK, CLIENT_VERSION));
+
+    CZerocoinSupply supplyRead;
+    ssMap >> supplyRead;
+    BOOST_CHECK_EQUAL(supplyRead.at(ZQ_FIVE_THOUSAND), 7007);
+
+    std::vector<CoinDenomination> vMints = {ZQ_ONE, ZQ_ONE, ZQ_FIFTY, ZQ_FIVE_THOUSAND};
+    CBlockMintDenominations mints;
+    for (unsigned int i = 0; i < vMints.size(); i++)
+        mints.push_back(vMints[i]);
+    CDataStream ssVector(SER_DISK, CLIENT_VERSION), ssMints(SER_DISK, CLIENT_VERSION);
+    ssVector << vMints;
+    ssMints << mints;
+    BOOST_CHECK(ssVector.str() == ssMints.str());
+    BOOST_CHECK_EQUAL(ssMints.size(), ::GetSerializeSize(mints, SER_DISK, CLIENT_VERSION));
+
+    // Mints listed out of denomination order are counted the same
+    std::vector<CoinDenomination> vUnordered = {ZQ_FIFTY, ZQ_ONE, ZQ_FIVE_THOUSAND, ZQ_ONE};
+    CDataStream ssUnordered(SER_DISK, CLIENT_VERSION);
+    ssUnordered << vUnordered;
+    CBlockMintDenominations mintsRead;
+    ssUnordered >> mintsRead;
+    BOOST_CHECK_EQUAL(mintsRead.Count(ZQ_ONE), 2);
+    BOOST_CHECK_EQUAL(mintsRead.Count(ZQ_FIFTY), 1);
+    BOOST_CHECK_EQUAL(mintsRead.Count(ZQ_TEN), 0);
+    BOOST_CHECK_EQUAL(mintsRead.size(), 4U);
+
+    BOOST_CHECK_THROW(supply.at(ZQ_ERROR), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(blockindex_disk_roundtrip)
+{
+    CBlockIndex index;
+    index.nVersion = 4;
+    index.nHeight = 1234;
+    index.nAccumulatorCheckpoint = 99;
+    index.zerocoinSupply.at(ZQ_TEN) = 12;
+    index.mintDenominationsInBlock.push_back(ZQ_TEN);
+    index.mintDenominationsInBlock.push_back(ZQ_ONE_HUNDRED);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index);
+    CDiskBlockIndex diskindex;
+    ss >> diskindex;
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK_EQUAL(diskindex.nHeight, 1234);
+    BOOST_CHECK_EQUAL(diskindex.zerocoinSupply.at(ZQ_TEN), 12);
+    BOOST_CHECK_EQUAL(diskindex.zerocoinSupply.at(ZQ_ONE), 0);
+    BOOST_CHECK(diskindex.MintedDenomination(ZQ_ONE_HUNDRED));
+    BOOST_CHECK(!diskindex.MintedDenomination(ZQ_ONE));
+    BOOST_CHECK_EQUAL(diskindex.GetZerocoinSupply(), 12 * ZerocoinDenominationToAmount(ZQ_TEN));
+
+    BOOST_TEST_MESSAGE(strprintf("blockindex_disk_roundtrip: sizeof(CBlockIndex) = %u", sizeof(CBlockIndex)));
+}
+
+BOOST_AUTO_TEST_CASE(blockindex_snapshot_roundtrip)
+{
+    LOCK(cs_main);
+    boost::filesystem::path path = GetDataDir() / "blockindex_test.snapshot";
+    CBlockIndex* pindexGenesis = chainActive.Genesis();
+
+    // A zerocoin era child of the genesis entry
+    CBlockIndex* pindexChild = new CBlockIndex();
+    pindexChild->pprev = pindexGenesis;
+    pindexChild->nHeight = 1;
+    pindexChild->nVersion = 4;
+    pindexChild->nBits = pindexGenesis->nBits;
+    pindexChild->nStatus = BLOCK_VALID_TREE;
+    pindexChild->zerocoinSupply.at(ZQ_FIFTY) = 3;
+    pindexChild->mintDenominationsInBlock.push_back(ZQ_FIFTY);
+    uint256 hashChild = 1234;
+    pindexChild->phashBlock = &mapBlockIndex.insert(std::make_pair(hashChild, pindexChild)).first->first;
+
+    uint256 hashBestBlock = pindexGenesis->GetBlockHash();
+    BOOST_CHECK(pblocktree->WriteBlockIndexSnapshot(path, hashBestBlock));
+
+    BlockMap mapOriginal;
+    mapOriginal.swap(mapBlockIndex);
+    std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
+    size_t nArenaSize = blockIndexArena.Size();
+    BOOST_CHECK(pblocktree->LoadBlockIndexSnapshot(path, hashBestBlock, vSortedByHeight));
+    BOOST_CHECK_EQUAL(blockIndexArena.Size(), nArenaSize + 2);
+    BOOST_CHECK_EQUAL(mapBlockIndex.size(), 2U);
+    BOOST_CHECK_EQUAL(vSortedByHeight.size(), 2U);
+    if (vSortedByHeight.size() == 2) {
+        CBlockIndex* pindex = vSortedByHeight[1].second;
+        BOOST_CHECK(vSortedByHeight[0].second->GetBlockHash() == pindexGenesis->GetBlockHash());
+        BOOST_CHECK(pindex->GetBlockHash() == hashChild);
+        BOOST_CHECK(pindex->pprev == vSortedByHeight[0].second);
+        BOOST_CHECK_EQUAL(pindex->nHeight, 1);
+        BOOST_CHECK_EQUAL(pindex->zerocoinSupply.at(ZQ_FIFTY), 3);
+        BOOST_CHECK(pindex->MintedDenomination(ZQ_FIFTY));
+    }
+    mapBlockIndex.clear();
+    blockIndexArena.Truncate(nArenaSize);
+
+    // Loading consumes the snapshot
+    BOOST_CHECK(!pblocktree->LoadBlockIndexSnapshot(path, hashBestBlock, vSortedByHeight));
+    BOOST_CHECK(mapBlockIndex.empty());
+
+    // A snapshot taken against another coins database state is refused
+    mapBlockIndex.swap(mapOriginal);
+    BOOST_CHECK(pblocktree->WriteBlockIndexSnapshot(path, hashBestBlock));
+    mapOriginal.swap(mapBlockIndex);
+    BOOST_CHECK(!pblocktree->LoadBlockIndexSnapshot(path, hashChild, vSortedByHeight));
+    BOOST_CHECK(mapBlockIndex.empty());
+    BOOST_CHECK_EQUAL(blockIndexArena.Size(), nArenaSize);
+
+    // as is one taken before a block file changed
+    mapBlockIndex.swap(mapOriginal);
+    BOOST_CHECK(pblocktree->WriteBlockIndexSnapshot(path, hashBestBlock));
+    mapOriginal.swap(mapBlockIndex);
+    CBlockFileInfo info;
+    pblocktree->ReadBlockFileInfo(0, info);
+    CBlockFileInfo infoChanged = info;
+    infoChanged.nSize++;
+    BOOST_CHECK(pblocktree->WriteBlockFileInfo(0, infoChanged));
+    BOOST_CHECK(!pblocktree->LoadBlockIndexSnapshot(path, hashBestBlock, vSortedByHeight));
+    BOOST_CHECK(mapBlockIndex.empty());
+    BOOST_CHECK(pblocktree->WriteBlockFileInfo(0, info));
+
+    // A corrupted snapshot is refused and leaves nothing behind
+    mapBlockIndex.swap(mapOriginal);
+    BOOST_CHECK(pblocktree->WriteBlockIndexSnapshot(path, hashBestBlock));
+    mapOriginal.swap(mapBlockIndex);
+    FILE* file = fopen(path.string().c_str(), "r+b");
+    BOOST_CHECK(file != NULL);
+    if (file) {
+        fseek(file, 60, SEEK_SET);
+        int ch = fgetc(file);
+        fseek(file, 60, SEEK_SET);
+        fputc(ch ^ 0xff, file);
+        fclose(file);
+    }
+    BOOST_CHECK(!pblocktree->LoadBlockIndexSnapshot(path, hashBestBlock, vSortedByHeight));
+    BOOST_CHECK(mapBlockIndex.empty());
+    BOOST_CHECK_EQUAL(blockIndexArena.Size(), nArenaSize);
+
+    mapBlockIndex.swap(mapOriginal);
+    mapBlockIndex.erase(hashChild);
+    delete pindexChild;
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
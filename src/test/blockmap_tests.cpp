@@ -0,0 +1,94 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+//
+// Unit tests for the memory-mapped block read path
+//
+
+#include "blockmap.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "main.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockmap_tests)
+
+static CDiskBlockPos AppendBlock(CBlock& block, int nFile, unsigned int& nEnd)
+{
+    CDiskBlockPos pos(nFile, nEnd);
+    BOOST_CHECK(WriteBlockToDisk(block, pos));
+    nEnd = pos.nPos + ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    return pos;
+}
+
+static void RemoveBlockFile(int nFile)
+{
+    blockFileMaps.Invalidate(nFile);
+    boost::filesystem::remove(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk"));
+}
+
+BOOST_AUTO_TEST_CASE(blockmap_read_and_grow)
+{
+    CBlock genesis = Params().GenesisBlock();
+    blockFileMaps.SetMaxFiles(2);
+
+    unsigned int nEnd = 0;
+    std::vector<CDiskBlockPos> vPos;
+    for (int i = 0; i < 3; i++)
+        vPos.push_back(AppendBlock(genesis, 99, nEnd));
+
+    BOOST_FOREACH (const CDiskBlockPos& pos, vPos) {
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pos));
+        BOOST_CHECK(block.GetHash() == genesis.GetHash());
+    }
+    BOOST_CHECK_EQUAL(blockFileMaps.Size(), 1U);
+
+    // Appending past the end of the current mapping forces a remap
+    CDiskBlockPos posGrown = AppendBlock(genesis, 99, nEnd);
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, posGrown));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+    BOOST_CHECK_EQUAL(blockFileMaps.Size(), 1U);
+
+    blockFileMaps.Invalidate(99);
+    BOOST_CHECK_EQUAL(blockFileMaps.Size(), 0U);
+
+    RemoveBlockFile(99);
+    blockFileMaps.SetMaxFiles(DEFAULT_BLOCK_MAP_FILES);
+}
+
+BOOST_AUTO_TEST_CASE(blockmap_bounded_cache)
+{
+    CBlock genesis = Params().GenesisBlock();
+    blockFileMaps.SetMaxFiles(2);
+
+    for (int nFile = 97; nFile <= 99; nFile++) {
+        unsigned int nEnd = 0;
+        CDiskBlockPos pos = AppendBlock(genesis, nFile, nEnd);
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pos));
+        BOOST_CHECK(block.GetHash() == genesis.GetHash());
+        BOOST_CHECK(blockFileMaps.Size() <= 2);
+    }
+    BOOST_CHECK_EQUAL(blockFileMaps.Size(), 2U);
+
+    // With mapping disabled reads go through OpenBlockFile
+    blockFileMaps.SetMaxFiles(0);
+    BOOST_CHECK_EQUAL(blockFileMaps.Size(), 0U);
+    unsigned int nEnd = 0;
+    CDiskBlockPos pos = AppendBlock(genesis, 98, nEnd);
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pos));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+    BOOST_CHECK_EQUAL(blockFileMaps.Size(), 0U);
+
+    for (int nFile = 97; nFile <= 99; nFile++)
+        RemoveBlockFile(nFile);
+    blockFileMaps.SetMaxFiles(DEFAULT_BLOCK_MAP_FILES);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
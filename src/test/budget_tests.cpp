@@ -0,0 +1,96 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "clientversion.h"
+#include "masternode-budget.h"
+#include "streams.h"
+#include "utiltime.h"
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(budget_tests)
+
+static CBudgetVote MakeVote(int nMasternode, int nVote, int64_t nTime)
+{
+    CBudgetVote vote(CTxIn(COutPoint(uint256(nMasternode + 1), 0)), uint256(1), nVote);
+    vote.nTime = nTime;
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(budget_proposal_tallies)
+{
+    CBudgetProposal proposal;
+    std::string strError;
+    int64_t nTime = GetTime() - 2 * BUDGET_VOTE_UPDATE_MIN;
+
+    int vVotes[] = {VOTE_YES, VOTE_YES, VOTE_YES, VOTE_NO, VOTE_NO, VOTE_ABSTAIN};
+    for (int i = 0; i < 6; i++) {
+        CBudgetVote vote = MakeVote(i, vVotes[i], nTime);
+        BOOST_CHECK(proposal.AddOrUpdateVote(vote, strError));
+    }
+    BOOST_CHECK_EQUAL(proposal.GetYeas(), 3);
+    BOOST_CHECK_EQUAL(proposal.GetNays(), 2);
+    BOOST_CHECK_EQUAL(proposal.GetAbstains(), 1);
+
+    // A changed vote moves from one tally to the other
+    CBudgetVote vote = MakeVote(0, VOTE_NO, GetTime());
+    BOOST_CHECK(proposal.AddOrUpdateVote(vote, strError));
+    BOOST_CHECK_EQUAL(proposal.GetYeas(), 2);
+    BOOST_CHECK_EQUAL(proposal.GetNays(), 3);
+
+    // A rejected update leaves the tallies alone
+    vote = MakeVote(1, VOTE_NO, nTime + 1);
+    BOOST_CHECK(!proposal.AddOrUpdateVote(vote, strError));
+    BOOST_CHECK_EQUAL(proposal.GetYeas(), 2);
+    BOOST_CHECK_EQUAL(proposal.GetNays(), 3);
+
+    CBudgetProposal copy(proposal);
+    BOOST_CHECK_EQUAL(copy.GetYeas(), 2);
+    BOOST_CHECK_EQUAL(copy.GetNays(), 3);
+    BOOST_CHECK_EQUAL(copy.GetAbstains(), 1);
+
+    // Votes of masternodes we don't know stop counting
+    proposal.CleanAndRemove(false);
+    BOOST_CHECK_EQUAL(proposal.GetYeas(), 0);
+    BOOST_CHECK_EQUAL(proposal.GetNays(), 0);
+    BOOST_CHECK_EQUAL(proposal.GetAbstains(), 0);
+    BOOST_CHECK_EQUAL(proposal.mapVotes.size(), 6U);
+}
+
+BOOST_AUTO_TEST_CASE(budget_proposal_tallies_serialize)
+{
+    CBudgetProposal proposal;
+    std::string strError;
+    int64_t nTime = GetTime() - 2 * BUDGET_VOTE_UPDATE_MIN;
+
+    int vVotes[] = {VOTE_YES, VOTE_YES, VOTE_NO, VOTE_ABSTAIN};
+    for (int i = 0; i < 4; i++) {
+        CBudgetVote vote = MakeVote(i, vVotes[i], nTime);
+        BOOST_CHECK(proposal.AddOrUpdateVote(vote, strError));
+    }
+
+    // Tallies are not stored, they are recounted from the loaded votes
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << proposal;
+    CBudgetProposal loaded;
+    ss >> loaded;
+    BOOST_CHECK_EQUAL(loaded.mapVotes.size(), 4U);
+    BOOST_CHECK_EQUAL(loaded.GetYeas(), 2);
+    BOOST_CHECK_EQUAL(loaded.GetNays(), 1);
+    BOOST_CHECK_EQUAL(loaded.GetAbstains(), 1);
+
+    // and stay consistent when a loaded vote is updated or invalidated
+    CBudgetVote vote = MakeVote(0, VOTE_NO, GetTime());
+    BOOST_CHECK(loaded.AddOrUpdateVote(vote, strError));
+    BOOST_CHECK_EQUAL(loaded.GetYeas(), 1);
+    BOOST_CHECK_EQUAL(loaded.GetNays(), 2);
+    loaded.CleanAndRemove(false);
+    BOOST_CHECK_EQUAL(loaded.GetYeas(), 0);
+    BOOST_CHECK_EQUAL(loaded.GetNays(), 0);
+    BOOST_CHECK_EQUAL(loaded.GetAbstains(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,67 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "expiringmap.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "utiltime.h"
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(expiringmap_tests)
+
+BOOST_AUTO_TEST_CASE(expiringmap_expiry_and_size)
+{
+    SetMockTime(1000);
+    expiringmap<int, int> map(60, 3);
+
+    map.insert(std::make_pair(1, 10));
+    SetMockTime(1030);
+    map[2] = 20;
+    map.insert(std::make_pair(3, 30));
+    BOOST_CHECK_EQUAL(map.size(), 3U);
+
+    // full: the oldest entry goes first
+    map[4] = 40;
+    BOOST_CHECK_EQUAL(map.size(), 3U);
+    BOOST_CHECK(!map.count(1));
+    BOOST_CHECK_EQUAL(map[4], 40);
+
+    // erased and reinserted entries expire from their new insertion time
+    map.erase(2);
+    SetMockTime(1050);
+    map[2] = 21;
+    SetMockTime(1090);
+    map.expire();
+    BOOST_CHECK(!map.count(3) && !map.count(4));
+    BOOST_CHECK_EQUAL(map[2], 21);
+    BOOST_CHECK_EQUAL(map.evicted(), 3U);
+
+    SetMockTime(1110);
+    map.expire();
+    BOOST_CHECK(map.empty());
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(expiringmap_serialization)
+{
+    std::map<int, std::string> mapPlain;
+    for (int i = 0; i < 50; i++)
+        mapPlain[i] = std::string(i, 'x');
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << mapPlain;
+    expiringmap<int, std::string> map(0, 0);
+    ss >> map;
+    BOOST_CHECK_EQUAL(map.size(), mapPlain.size());
+
+    ss << map;
+    std::map<int, std::string> mapRead;
+    ss >> mapRead;
+    BOOST_CHECK(mapRead == mapPlain);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,10 @@
 
 #include "primitives/transaction.h"
 #include "main.h"
+#include "validationinterface.h"
+
+#include <string>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -48,4 +52,58 @@ BOOST_AUTO_TEST_CASE(subsidy_limit_test)
     BOOST_CHECK(nSum == 4109975100000000ULL);
 }
 
+namespace
+{
+/** Records the order in which disconnect notifications arrive */
+class CDisconnectRecorder : public CValidationInterface
+{
+public:
+    std::vector<std::string> vEvents;
+
+protected:
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+    {
+        vEvents.push_back("block " + block.GetHash().ToString());
+    }
+    void TransactionAddedToMempool(const CTransaction& tx)
+    {
+        vEvents.push_back("added " + tx.GetHash().ToString());
+    }
+    void TransactionRemovedFromMempool(const CTransaction& tx)
+    {
+        vEvents.push_back("removed " + tx.GetHash().ToString());
+    }
+};
+}
+
+BOOST_AUTO_TEST_CASE(block_disconnected_before_mempool_changes)
+{
+    CBlock block;
+    block.nTime = 1;
+    CBlockIndex index(block);
+
+    // The block's transactions return to the mempool, others are evicted
+    std::list<CTransaction> txAdded, txRemoved;
+    for (int i = 0; i < 2; i++) {
+        CMutableTransaction tx;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i + 1;
+        txAdded.push_back(tx);
+        tx.vout[0].nValue = i + 10;
+        txRemoved.push_back(tx);
+    }
+
+    CDisconnectRecorder recorder;
+    RegisterValidationInterface(&recorder);
+    NotifyBlockDisconnected(block, &index, txAdded, txRemoved);
+    UnregisterValidationInterface(&recorder);
+
+    BOOST_REQUIRE_EQUAL(recorder.vEvents.size(), 5);
+    BOOST_CHECK_EQUAL(recorder.vEvents[0], "block " + block.GetHash().ToString());
+    BOOST_CHECK_EQUAL(recorder.vEvents[1], "added " + txAdded.front().GetHash().ToString());
+    BOOST_CHECK_EQUAL(recorder.vEvents[2], "added " + txAdded.back().GetHash().ToString());
+    BOOST_CHECK_EQUAL(recorder.vEvents[3], "removed " + txRemoved.front().GetHash().ToString());
+    BOOST_CHECK_EQUAL(recorder.vEvents[4], "removed " + txRemoved.back().GetHash().ToString());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,51 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "clientversion.h"
+#include "key.h"
+#include "masternode-payments.h"
+#include "script/standard.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(masternode_payments_tests)
+
+BOOST_AUTO_TEST_CASE(payments_leading_payee_index)
+{
+    CKey keyA, keyB;
+    keyA.MakeNewKey(true);
+    keyB.MakeNewKey(true);
+    CScript payeeA = GetScriptForDestination(keyA.GetPubKey().GetID());
+    CScript payeeB = GetScriptForDestination(keyB.GetPubKey().GetID());
+
+    CMasternodePayments payments;
+    payments.mapMasternodeBlocks[3] = CMasternodeBlockPayees(3);
+    payments.mapMasternodeBlocks[3].AddPayee(payeeA, 2);
+    payments.mapMasternodeBlocks[3].AddPayee(payeeB, 1);
+    payments.mapMasternodeBlocks[20] = CMasternodeBlockPayees(20);
+    payments.mapMasternodeBlocks[20].AddPayee(payeeB, 5);
+
+    // The index is rebuilt when the payments are loaded
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << payments;
+    CMasternodePayments loaded;
+    ss >> loaded;
+
+    // Only the leading payee of a height in the window is scheduled
+    BOOST_CHECK(loaded.IsScheduled(payeeA, 0, -1));
+    BOOST_CHECK(!loaded.IsScheduled(payeeA, 0, 3));
+    BOOST_CHECK(!loaded.IsScheduled(payeeA, 4, -1));
+    BOOST_CHECK(!loaded.IsScheduled(payeeB, 0, -1));
+    BOOST_CHECK(loaded.IsScheduled(payeeB, 12, -1));
+    BOOST_CHECK(!loaded.IsScheduled(payeeB, 21, -1));
+
+    BOOST_CHECK_EQUAL(loaded.GetOldestBlock(), 3);
+    BOOST_CHECK_EQUAL(loaded.GetNewestBlock(), 20);
+
+    loaded.Clear();
+    BOOST_CHECK(!loaded.IsScheduled(payeeA, 0, -1));
+    BOOST_CHECK(!loaded.IsScheduled(payeeB, 12, -1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hash.h"
+#include "masternode-sync.h"
+#include "utilstrencodings.h"
+
+#include <set>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(masternode_sync_tests)
+
+BOOST_AUTO_TEST_CASE(sync_set_summary_filter)
+{
+    std::vector<CInv> vInv;
+    for (int i = 0; i < 1000; i++)
+        vInv.push_back(CInv(MSG_MASTERNODE_ANNOUNCE, Hash(BEGIN(i), END(i))));
+
+    // the requester lacks the first three objects and has one the peer lacks
+    CSyncSetSummary summary = CSyncSetSummary::ForItems(vInv.size());
+    BOOST_CHECK_EQUAL(summary.vBuckets.size(), 1000U / MASTERNODE_SYNC_SUMMARY_BUCKET_SIZE);
+    for (unsigned int i = 3; i < vInv.size(); i++)
+        summary.Add(vInv[i].hash);
+    int nExtra = -1;
+    summary.Add(Hash(BEGIN(nExtra), END(nExtra)));
+
+    std::vector<CInv> vMissing = vInv;
+    summary.FilterKnown(vMissing);
+    std::set<uint256> setMissing;
+    BOOST_FOREACH (const CInv& inv, vMissing)
+        setMissing.insert(inv.hash);
+    for (unsigned int i = 0; i < 3; i++)
+        BOOST_CHECK(setMissing.count(vInv[i].hash));
+    BOOST_CHECK(vMissing.size() < vInv.size() / 10);
+
+    // identical sets announce nothing, peers without a summary get everything
+    summary.Add(Hash(BEGIN(nExtra), END(nExtra)));
+    for (unsigned int i = 0; i < 3; i++)
+        summary.Add(vInv[i].hash);
+    vMissing = vInv;
+    summary.FilterKnown(vMissing);
+    BOOST_CHECK(vMissing.empty());
+
+    vMissing = vInv;
+    CSyncSetSummary().FilterKnown(vMissing);
+    BOOST_CHECK_EQUAL(vMissing.size(), vInv.size());
+    BOOST_CHECK(CSyncSetSummary::ForItems(0).IsNull());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
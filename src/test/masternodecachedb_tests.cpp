@@ -0,0 +1,66 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternodecachedb.h"
+#include "utilstrencodings.h"
+
+#include <map>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(masternodecachedb_tests)
+
+BOOST_AUTO_TEST_CASE(masternodecachedb_writes_changes_only)
+{
+    std::map<uint256, int64_t> mapEntries;
+    for (int i = 0; i < 100; i++)
+        mapEntries[Hash(BEGIN(i), END(i))] = i;
+
+    unsigned int nWritten = 0, nErased = 0;
+    {
+        CMasternodeCacheDB db(0, false, true);
+        BOOST_CHECK(!db.IsInitialized());
+        for (std::map<uint256, int64_t>::const_iterator it = mapEntries.begin(); it != mapEntries.end(); ++it)
+            db.Put('x', it->first, it->second);
+        db.Put('y', std::string("meta"), std::string("first"));
+        BOOST_CHECK(db.WriteChanges(nWritten, nErased));
+        BOOST_CHECK_EQUAL(nWritten, 101U);
+        BOOST_CHECK_EQUAL(nErased, 0U);
+        BOOST_CHECK(db.IsInitialized());
+    }
+
+    // A reopened store knows what it holds: unchanged entries are not rewritten
+    boost::scoped_ptr<CMasternodeCacheDB> pdb(new CMasternodeCacheDB(0, false, false));
+    BOOST_CHECK(pdb->IsInitialized());
+    std::map<uint256, int64_t> mapLoaded;
+    BOOST_CHECK(pdb->Load('x', mapLoaded));
+    BOOST_CHECK(mapLoaded == mapEntries);
+
+    mapEntries.begin()->second = -1;
+    mapEntries.erase(--mapEntries.end());
+    for (std::map<uint256, int64_t>::const_iterator it = mapEntries.begin(); it != mapEntries.end(); ++it)
+        pdb->Put('x', it->first, it->second);
+    pdb->Put('y', std::string("meta"), std::string("first"));
+    BOOST_CHECK(pdb->WriteChanges(nWritten, nErased));
+    BOOST_CHECK_EQUAL(nWritten, 1U);
+    BOOST_CHECK_EQUAL(nErased, 1U);
+
+    // Entries that are not put again are erased
+    pdb->Put('y', std::string("meta"), std::string("second"));
+    BOOST_CHECK(pdb->WriteChanges(nWritten, nErased));
+    BOOST_CHECK_EQUAL(nWritten, 1U);
+    BOOST_CHECK_EQUAL(nErased, mapEntries.size());
+
+    mapLoaded.clear();
+    BOOST_CHECK(pdb->Load('x', mapLoaded));
+    BOOST_CHECK(mapLoaded.empty());
+    std::map<std::string, std::string> mapMeta;
+    BOOST_CHECK(pdb->Load('y', mapMeta));
+    BOOST_CHECK_EQUAL(mapMeta.size(), 1U);
+    BOOST_CHECK_EQUAL(mapMeta["meta"], "second");
+    BOOST_CHECK(pdb->IsInitialized());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
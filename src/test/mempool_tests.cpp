@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "coins.h"
 #include "main.h"
 #include "txmempool.h"
 #include "util.h"
@@ -99,4 +100,58 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     removed.clear();
 }
 
+BOOST_AUTO_TEST_CASE(MempoolRemoveCoinbaseSpendsTest)
+{
+    // Spends of a coinbase that became immature again after a disconnect
+    // must be evicted and reported, together with their descendants
+    CMutableTransaction txCoinbase;
+    txCoinbase.vin.resize(1);
+    txCoinbase.vin[0].prevout.SetNull();
+    txCoinbase.vin[0].scriptSig = CScript() << OP_11;
+    txCoinbase.vout.resize(1);
+    txCoinbase.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txCoinbase.vout[0].nValue = 33000LL;
+
+    CMutableTransaction txSpend;
+    txSpend.vin.resize(1);
+    txSpend.vin[0].scriptSig = CScript() << OP_11;
+    txSpend.vin[0].prevout.hash = txCoinbase.GetHash();
+    txSpend.vin[0].prevout.n = 0;
+    txSpend.vout.resize(1);
+    txSpend.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txSpend.vout[0].nValue = 22000LL;
+
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_11;
+    txChild.vin[0].prevout.hash = txSpend.GetHash();
+    txChild.vin[0].prevout.n = 0;
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = 11000LL;
+
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    {
+        CCoinsModifier coins = view.ModifyCoins(txCoinbase.GetHash());
+        coins->FromTx(txCoinbase, 10);
+    }
+
+    CTxMemPool testPool(CFeeRate(0));
+    std::list<CTransaction> removed;
+    testPool.addUnchecked(txSpend.GetHash(), CTxMemPoolEntry(txSpend, 0, 0, 0.0, 1));
+    testPool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 0, 0, 0.0, 1));
+
+    // Mature at this height: nothing to evict
+    testPool.removeCoinbaseSpends(&view, 10 + Params().COINBASE_MATURITY(), removed);
+    BOOST_CHECK_EQUAL(removed.size(), 0);
+    BOOST_CHECK_EQUAL(testPool.size(), 2);
+
+    // Immature: the spend and its child are handed back to the caller
+    testPool.removeCoinbaseSpends(&view, 11, removed);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    BOOST_CHECK_EQUAL(testPool.size(), 0);
+    BOOST_CHECK(removed.front().GetHash() == txSpend.GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -172,4 +172,53 @@ BOOST_AUTO_TEST_CASE(rpc_boostasiotocnetaddr)
     BOOST_CHECK_EQUAL(BoostAsioToCNetAddr(boost::asio::ip::address::from_string("::ffff:127.0.0.1")).ToString(), "127.0.0.1");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_streamed_reply)
+{
+    Object obj;
+    obj.push_back(Pair("hash", "000001a2b3c4d5e6f708"));
+    obj.push_back(Pair("height", 123456));
+    obj.push_back(Pair("amount", 12.5));
+    obj.push_back(Pair("negative", -0.00000001));
+    obj.push_back(Pair("flag", true));
+    obj.push_back(Pair("nothing", Value::null));
+    obj.push_back(Pair("escaped", "quote\" slash\\ tab\t"));
+    Array arr;
+    for (int i = 0; i < 5000; i++)
+        arr.push_back(obj);
+    Value result = arr;
+
+    // Streamed reply must be byte-identical to the string reply
+    std::ostringstream direct;
+    JSONRPCWriteReply(direct, result, Value::null, Value(7));
+    BOOST_CHECK_EQUAL(direct.str(), JSONRPCReply(result, Value::null, Value(7)));
+
+    Object objError = JSONRPCError(RPC_MISC_ERROR, "failure");
+    std::ostringstream error;
+    JSONRPCWriteReply(error, result, objError, Value("id"));
+    BOOST_CHECK_EQUAL(error.str(), JSONRPCReply(result, objError, Value("id")));
+
+    // Round trip through chunked framing with a small chunk size
+    std::stringstream wire;
+    {
+        HTTPChunkedStreamBuf chunked(wire, 1000);
+        std::ostream os(&chunked);
+        JSONRPCWriteReply(os, result, Value::null, Value(7));
+        chunked.Finish();
+    }
+    BOOST_CHECK(wire.str().size() > direct.str().size());
+    BOOST_CHECK(wire.str().substr(0, 5) == "3e8\r\n");
+
+    std::stringstream response;
+    response << "Transfer-Encoding: chunked\r\n\r\n" << wire.str();
+    map<string, string> mapHeaders;
+    string strBody;
+    BOOST_CHECK_EQUAL(ReadHTTPMessage(response, mapHeaders, strBody, 1, std::numeric_limits<size_t>::max()), HTTP_OK);
+    BOOST_CHECK_EQUAL(strBody, direct.str());
+
+    // Body larger than the allowed size is rejected
+    std::stringstream limited;
+    limited << "Transfer-Encoding: chunked\r\n\r\n" << wire.str();
+    BOOST_CHECK_EQUAL(ReadHTTPMessage(limited, mapHeaders, strBody, 1, 100), HTTP_INTERNAL_SERVER_ERROR);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -99,4 +99,29 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(blockindex_arena_test)
+{
+    CBlockIndexArena arena;
+    std::vector<CBlockIndex*> vIndex;
+    for (int i = 0; i < 10000; i++) {
+        vIndex.push_back(arena.Create());
+        vIndex.back()->nHeight = i;
+    }
+    BOOST_CHECK_EQUAL(arena.Size(), 10000U);
+    // Entries never move as the arena grows
+    for (int i = 0; i < 10000; i++)
+        BOOST_CHECK_EQUAL(vIndex[i]->nHeight, i);
+
+    arena.Truncate(5000);
+    BOOST_CHECK_EQUAL(arena.Size(), 5000U);
+    BOOST_CHECK_EQUAL(vIndex[4999]->nHeight, 4999);
+    // The next entry takes the first released slot, freshly constructed
+    CBlockIndex* pindex = arena.Create();
+    BOOST_CHECK(pindex == vIndex[5000]);
+    BOOST_CHECK_EQUAL(pindex->nHeight, 0);
+
+    arena.Clear();
+    BOOST_CHECK_EQUAL(arena.Size(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "wallet.h"
+#include "walletdb.h"
 
 #include <set>
 #include <stdint.h>
@@ -11,6 +12,7 @@
 
 #include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 // how many times to run all the tests to have a chance to catch errors that only show up with particular random shuffles
 #define RUN_TESTS 100
@@ -305,4 +307,199 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(coin_selection_pool_test)
+{
+    CoinSet setCoinsRet;
+    CAmount nValueRet;
+
+    LOCK(wallet.cs_wallet);
+
+    empty_wallet();
+    seed_insecure_rand(true);
+    for (int i = 0; i < 1000; i++)
+        add_coin((1 + insecure_rand() % 10000) * CENT);
+
+    const CAmount vTargets[] = {CENT / 2, 5 * CENT, 3 * COIN, 250 * COIN, 2000 * COIN};
+    BOOST_FOREACH (const CAmount& nTarget, vTargets) {
+        BOOST_CHECK(wallet.SelectCoinsMinConf(nTarget, 1, 6, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK(nValueRet >= nTarget);
+    }
+
+    // The passes of one send share a single sorted pool
+    CCoinSelectionPool pool;
+    wallet.BuildCoinSelectionPool(vCoins, pool);
+    BOOST_CHECK_EQUAL(pool.vEntries.size(), vCoins.size());
+    for (size_t i = 1; i < pool.vEntries.size(); i++)
+        BOOST_CHECK(pool.vEntries[i - 1].nValue >= pool.vEntries[i].nValue);
+
+    // An amount two of the coins add up to exactly needs no change
+    CAmount nExact = vCoins[7].Value() + vCoins[999].Value();
+    BOOST_CHECK(wallet.SelectCoinsMinConf(nExact, 1, 6, pool, setCoinsRet, nValueRet));
+    BOOST_CHECK_EQUAL(nValueRet, nExact);
+    empty_wallet();
+}
+
+// Balances and coins computed by walking all of mapWallet, as before the spendable index
+static CAmount FullScanBalance(const CWallet& w)
+{
+    CAmount nTotal = 0;
+    for (map<uint256, CWalletTx>::const_iterator it = w.mapWallet.begin(); it != w.mapWallet.end(); ++it)
+        if (it->second.IsTrusted())
+            nTotal += it->second.GetAvailableCredit();
+    return nTotal;
+}
+
+static size_t FullScanCoins(const CWallet& w)
+{
+    size_t nCoins = 0;
+    for (map<uint256, CWalletTx>::const_iterator it = w.mapWallet.begin(); it != w.mapWallet.end(); ++it) {
+        if (!it->second.IsTrusted())
+            continue;
+        for (unsigned int i = 0; i < it->second.vout.size(); i++)
+            if (!w.IsSpent(it->first, i) && w.IsMine(it->second.vout[i]) == ISMINE_SPENDABLE && it->second.vout[i].nValue > 0)
+                nCoins++;
+    }
+    return nCoins;
+}
+
+static void CheckSpendableIndex(const CWallet& w)
+{
+    vector<COutput> vAvailable;
+    w.AvailableCoins(vAvailable, true, NULL, false, ALL_COINS, false);
+    BOOST_CHECK_EQUAL(w.GetBalance(), FullScanBalance(w));
+    BOOST_CHECK_EQUAL(vAvailable.size(), FullScanCoins(w));
+}
+
+BOOST_AUTO_TEST_CASE(spendable_index_consistency)
+{
+    CWallet w("wallet_spendable_test.dat");
+    LOCK2(cs_main, w.cs_wallet);
+
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_CHECK(w.AddKey(key));
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+    CScript scriptOther = GetScriptForDestination(keyOther.GetPubKey().GetID());
+
+    // Every transaction "confirms" in the genesis block, the current tip
+    const uint256 hashGenesis = chainActive.Genesis()->GetBlockHash();
+
+    vector<CTransaction> vFunding, vSpends;
+    for (int i = 0; i < 20; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        tx.vout.resize(2);
+        tx.vout[0].nValue = (i + 1) * COIN;
+        tx.vout[0].scriptPubKey = scriptMine;
+        tx.vout[1].nValue = COIN;
+        tx.vout[1].scriptPubKey = scriptOther;
+        CWalletTx wtx(&w, tx);
+        wtx.hashBlock = hashGenesis;
+        wtx.nIndex = 0;
+        wtx.fMerkleVerified = true;
+        BOOST_CHECK(w.AddToWallet(wtx));
+        vFunding.push_back(tx);
+    }
+    CheckSpendableIndex(w);
+    BOOST_CHECK_EQUAL(w.GetSpendableTxs().size(), 20U);
+
+    // Spend the first half in confirmed transactions paying someone else
+    for (int i = 0; i < 10; i++) {
+        CMutableTransaction tx;
+        tx.vin.push_back(CTxIn(vFunding[i].GetHash(), 0));
+        tx.vout.resize(1);
+        tx.vout[0].nValue = (i + 1) * COIN;
+        tx.vout[0].scriptPubKey = scriptOther;
+        CWalletTx wtx(&w, tx);
+        wtx.hashBlock = hashGenesis;
+        wtx.nIndex = 0;
+        wtx.fMerkleVerified = true;
+        BOOST_CHECK(w.AddToWallet(wtx));
+        w.mapWallet[vFunding[i].GetHash()].MarkDirty();
+        vSpends.push_back(tx);
+    }
+    BOOST_CHECK_EQUAL(w.GetBalance(), 155 * COIN);
+    CheckSpendableIndex(w);
+
+    // Fully spent funding and the outgoing spends drop out on the next tip
+    w.MarkDirty();
+    BOOST_CHECK_EQUAL(w.GetSpendableTxs().size(), 10U);
+    CheckSpendableIndex(w);
+
+    // Un-confirm half of the spends, as a reorg would; they are neither in a
+    // block nor in the mempool any more, so their inputs are unspent again
+    for (int i = 0; i < 5; i++) {
+        CWalletTx& wtx = w.mapWallet[vSpends[i].GetHash()];
+        wtx.hashBlock = 0;
+        wtx.nIndex = -1;
+        wtx.fMerkleVerified = false;
+        w.SyncTransaction(vSpends[i], NULL);
+    }
+    BOOST_CHECK_EQUAL(w.GetBalance(), 170 * COIN);
+    CheckSpendableIndex(w);
+    w.MarkDirty();
+    BOOST_CHECK_EQUAL(w.GetSpendableTxs().size(), 15U);
+
+    // Erasing a spend also brings back what it spent
+    w.EraseFromWallet(vSpends[5].GetHash());
+    w.mapWallet[vFunding[5].GetHash()].MarkDirty();
+    BOOST_CHECK_EQUAL(w.GetBalance(), 176 * COIN);
+    CheckSpendableIndex(w);
+}
+
+static unsigned int KeyPoolSize(CWallet& w)
+{
+    LOCK(w.cs_wallet);
+    return w.GetKeyPoolSize();
+}
+
+static bool WaitForKeyPoolSize(CWallet& w, unsigned int nSize)
+{
+    for (int i = 0; i < 1000 && KeyPoolSize(w) < nSize; i++)
+        MilliSleep(10);
+    return KeyPoolSize(w) >= nSize;
+}
+
+BOOST_AUTO_TEST_CASE(keypool_background_fill)
+{
+    const std::string strFile = "wallet_keypool_test.dat";
+    CWalletDB(strFile, "cr+");
+    CWallet w(strFile);
+    mapArgs["-keypool"] = "20";
+    mapArgs["-keypoollow"] = "5";
+
+    // The filler starts with a fill of its own
+    boost::thread filler(boost::bind(&CWallet::ThreadKeyPoolFiller, &w));
+    BOOST_CHECK(WaitForKeyPoolSize(w, 21));
+    BOOST_CHECK(w.GetKeyPoolFillStats().fRunning);
+
+    // Drawing the pool down to the low watermark wakes the filler, and
+    // address requests never have to generate keys themselves
+    CPubKey pubkey;
+    for (int i = 0; i < 16; i++)
+        BOOST_CHECK(w.GetKeyFromPool(pubkey));
+    BOOST_CHECK(WaitForKeyPoolSize(w, 21));
+    BOOST_CHECK_EQUAL(KeyPoolSize(w), 21U);
+
+    CKeyPoolFillStats stats = w.GetKeyPoolFillStats();
+    BOOST_CHECK_EQUAL(stats.nBackgroundKeys, 21 + 16);
+    BOOST_CHECK_EQUAL(stats.nForegroundKeys, 0);
+
+    filler.interrupt();
+    filler.join();
+    BOOST_CHECK(!w.GetKeyPoolFillStats().fRunning);
+
+    // Without the filler a reserve tops the pool up itself
+    BOOST_CHECK(w.GetKeyFromPool(pubkey));
+    BOOST_CHECK(w.GetKeyFromPool(pubkey));
+    BOOST_CHECK_EQUAL(KeyPoolSize(w), 20U);
+    BOOST_CHECK_EQUAL(w.GetKeyPoolFillStats().nForegroundKeys, 1);
+
+    mapArgs.erase("-keypool");
+    mapArgs.erase("-keypoollow");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
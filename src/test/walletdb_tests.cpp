@@ -0,0 +1,58 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet.h"
+#include "walletdb.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(walletdb_tests)
+
+static const std::string strBatchFile = "wallet_batch_test.dat";
+
+BOOST_AUTO_TEST_CASE(walletdb_batch_commit_and_abort)
+{
+    CWalletDB(strBatchFile, "cr+");
+
+    {
+        CWalletDBBatch batch(strBatchFile);
+        // Short-lived handles opened inside the batch write through it
+        for (int64_t i = 1; i <= 10; i++)
+            BOOST_CHECK(CWalletDB(strBatchFile).WritePool(i, CKeyPool()));
+
+        // and see its uncommitted writes
+        CKeyPool keypool;
+        BOOST_CHECK(CWalletDB(strBatchFile).ReadPool(5, keypool));
+
+        // A nested batch joins the outer one
+        CWalletDBBatch batchInner(strBatchFile);
+        BOOST_CHECK(CWalletDB(strBatchFile).WritePool(11, CKeyPool()));
+        BOOST_CHECK(batchInner.Commit());
+        BOOST_CHECK(batch.Commit());
+    }
+    CKeyPool keypool;
+    for (int64_t i = 1; i <= 11; i++)
+        BOOST_CHECK(CWalletDB(strBatchFile).ReadPool(i, keypool));
+
+    // A batch dropped without committing discards its writes
+    {
+        CWalletDB walletdb(strBatchFile);
+        BOOST_CHECK(walletdb.BatchBegin());
+        BOOST_CHECK(CWalletDB(strBatchFile).WritePool(12, CKeyPool()));
+        BOOST_CHECK(CWalletDB(strBatchFile).ErasePool(1));
+    }
+    BOOST_CHECK(!CWalletDB(strBatchFile).ReadPool(12, keypool));
+    BOOST_CHECK(CWalletDB(strBatchFile).ReadPool(1, keypool));
+
+    // as does a CWalletDBBatch left on an error path
+    {
+        CWalletDBBatch batch(strBatchFile);
+        BOOST_CHECK(CWalletDB(strBatchFile).WritePool(13, CKeyPool()));
+        BOOST_CHECK(CWalletDB(strBatchFile).ErasePool(2));
+    }
+    BOOST_CHECK(!CWalletDB(strBatchFile).ReadPool(13, keypool));
+    BOOST_CHECK(CWalletDB(strBatchFile).ReadPool(2, keypool));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,7 +10,9 @@
 #include "wallet.h"
 #include "walletdb.h"
 #include "txdb.h"
+#include "utiltime.h"
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 #include <iostream>
 
 using namespace libzerocoin;
@@ -53,4 +55,54 @@ BOOST_AUTO_TEST_CASE(zerocoin_spend_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(zerocoin_parallel_mint_test)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    mapArgs["-mintthreads"] = "3";
+
+    std::vector<CoinDenomination> vDenoms;
+    for (int i = 0; i < 7; i++)
+        vDenoms.push_back(zerocoinDenomList[i % zerocoinDenomList.size()]);
+    std::vector<CZerocoinMint> vMints;
+    int64_t nStart = GetTimeMicros();
+    GenerateZerocoinMints(vDenoms, vMints);
+    BOOST_TEST_MESSAGE(strprintf("zerocoin_parallel_mint_test: %u mints on 3 threads in %dms", vMints.size(), (GetTimeMicros() - nStart) / 1000));
+
+    // Every slot holds a valid coin of the requested denomination
+    BOOST_CHECK_EQUAL(vMints.size(), vDenoms.size());
+    std::set<CBigNum> setSerials;
+    for (size_t i = 0; i < vMints.size(); i++) {
+        BOOST_CHECK(vMints[i].GetDenomination() == vDenoms[i]);
+        BOOST_CHECK(PublicCoin(Params().Zerocoin_Params(), vMints[i].GetValue(), vDenoms[i]).validate());
+        setSerials.insert(vMints[i].GetSerialNumber());
+    }
+    BOOST_CHECK_EQUAL(setSerials.size(), vMints.size());
+    mapArgs.erase("-mintthreads");
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_mint_pool_test)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    mapArgs["-zmintpool"] = "1";
+
+    CWallet wallet;
+    CZerocoinMint mint;
+    BOOST_CHECK(!wallet.TakeMintFromPool(ZQ_FIVE, mint));
+
+    // The filler generates one coin of every denomination
+    boost::thread filler(boost::bind(&CWallet::ThreadMintPoolFiller, &wallet));
+    for (int i = 0; i < 6000 && wallet.GetMintPoolCounts().size() < zerocoinDenomList.size(); i++)
+        MilliSleep(10);
+    filler.interrupt();
+    filler.join();
+    BOOST_CHECK_EQUAL(wallet.GetMintPoolCounts().size(), zerocoinDenomList.size());
+
+    BOOST_CHECK(wallet.TakeMintFromPool(ZQ_FIVE, mint));
+    BOOST_CHECK(mint.GetDenomination() == ZQ_FIVE);
+    BOOST_CHECK(PublicCoin(Params().Zerocoin_Params(), mint.GetValue(), ZQ_FIVE).validate());
+    BOOST_CHECK_EQUAL(wallet.GetMintPoolCounts()[ZQ_FIVE], 0);
+    BOOST_CHECK(!wallet.TakeMintFromPool(ZQ_FIVE, mint));
+    mapArgs.erase("-zmintpool");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,76 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ztpctracker.h"
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(ztpctracker_tests)
+
+static CZerocoinMint MakeMint(int n, libzerocoin::CoinDenomination denom)
+{
+    CZerocoinMint mint(denom, CBigNum(1000 + n), CBigNum(2000 + n), CBigNum(3000 + n), false);
+    mint.SetTxHash(uint256(n));
+    return mint;
+}
+
+BOOST_AUTO_TEST_CASE(ztpctracker_add_spend_erase)
+{
+    // A tracker without a wallet file keeps everything in memory
+    CzTPCTracker tracker("");
+    tracker.Init();
+
+    for (int i = 1; i <= 5; i++)
+        BOOST_CHECK(tracker.Add(MakeMint(i, libzerocoin::ZQ_ONE)));
+    BOOST_CHECK_EQUAL(tracker.Size(), 5U);
+
+    // Overwriting a mint keeps a single entry
+    CZerocoinMint mint = MakeMint(3, libzerocoin::ZQ_ONE);
+    mint.SetHeight(10);
+    BOOST_CHECK(tracker.Add(mint));
+    BOOST_CHECK_EQUAL(tracker.Size(), 5U);
+    CZerocoinMint mintRead;
+    BOOST_CHECK(tracker.GetMint(mint.GetValue(), mintRead));
+    BOOST_CHECK_EQUAL(mintRead.GetHeight(), 10);
+
+    BOOST_CHECK(tracker.HasPubcoin(CBigNum(1001)));
+    BOOST_CHECK(!tracker.HasPubcoin(CBigNum(1006)));
+    BOOST_CHECK(tracker.HasUnusedSerial(CBigNum(3002)));
+    BOOST_CHECK(!tracker.HasUnusedSerial(CBigNum(2002)));
+
+    // A spend record hides the mint from unused listings and marks it used
+    CZerocoinSpend spend(CBigNum(3002), uint256(100), CBigNum(1002), libzerocoin::ZQ_ONE, 0);
+    BOOST_CHECK(tracker.AddSpend(spend));
+    BOOST_CHECK(tracker.IsSpentSerial(CBigNum(3002)));
+    BOOST_CHECK(!tracker.HasUnusedSerial(CBigNum(3002)));
+    BOOST_CHECK_EQUAL(tracker.ListMints(true, false, false).size(), 4U);
+    BOOST_CHECK(tracker.GetMint(CBigNum(1002), mintRead));
+    BOOST_CHECK(mintRead.IsUsed());
+    BOOST_CHECK_EQUAL(tracker.ListMints(false, false, false).size(), 5U);
+    BOOST_CHECK_EQUAL(tracker.ListSpends().size(), 1U);
+
+    BOOST_CHECK(tracker.EraseSpend(CBigNum(3002)));
+    BOOST_CHECK(!tracker.IsSpentSerial(CBigNum(3002)));
+
+    // Erased and archived mints leave every index
+    BOOST_CHECK(tracker.Erase(MakeMint(4, libzerocoin::ZQ_ONE)));
+    BOOST_CHECK(tracker.Archive(MakeMint(5, libzerocoin::ZQ_ONE)));
+    BOOST_CHECK_EQUAL(tracker.Size(), 3U);
+    BOOST_CHECK(!tracker.HasUnusedSerial(CBigNum(3004)));
+    BOOST_CHECK(!tracker.HasPubcoin(CBigNum(1005)));
+
+    BOOST_CHECK(tracker.Unarchive(MakeMint(5, libzerocoin::ZQ_ONE)));
+    BOOST_CHECK(tracker.HasUnusedSerial(CBigNum(3005)));
+
+    // Listings come back in pubcoin hash order, like the wallet database cursor
+    uint256 hashPrev = 0;
+    BOOST_FOREACH (const CZerocoinMint& m, tracker.ListMints(false, false, false)) {
+        uint256 hash = CzTPCTracker::GetHashForValue(m.GetValue());
+        BOOST_CHECK(hashPrev < hash);
+        hashPrev = hash;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,9 +10,15 @@
 #include "pow.h"
 #include "uint256.h"
 #include "accumulators.h"
+#include "blockmap.h"
+#include "hash.h"
+#include "random.h"
 
 #include <stdint.h>
 
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -184,6 +190,169 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value)
+{
+    return Read(make_pair('p', key), value);
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& vect)
+{
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        if (it->second.IsNull())
+            batch.Erase(make_pair('p', it->first));
+        else
+            batch.Write(make_pair('p', it->first), it->second);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vect)
+{
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = vect.begin(); it != vect.end(); it++) {
+        if (it->second.IsNull())
+            batch.Erase(make_pair('u', it->first));
+        else
+            batch.Write(make_pair('u', it->first), it->second);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair('u', CAddressIndexIteratorKey(type, addressHash));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressUnspentKey indexKey;
+            ssKey >> chType;
+            if (chType != 'u')
+                break;
+            ssKey >> indexKey;
+            if (indexKey.type != (unsigned int)type || indexKey.hashBytes != addressHash)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CAddressUnspentValue nValue;
+            ssValue >> nValue;
+            unspentOutputs.push_back(make_pair(indexKey, nValue));
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect)
+{
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = vect.begin(); it != vect.end(); it++)
+        batch.Write(make_pair('a', it->first), it->second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect)
+{
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = vect.begin(); it != vect.end(); it++)
+        batch.Erase(make_pair('a', it->first));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex, int start, int end)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    if (start > 0 && end > 0)
+        ssKeySet << make_pair('a', CAddressIndexIteratorHeightKey(type, addressHash, start));
+    else
+        ssKeySet << make_pair('a', CAddressIndexIteratorKey(type, addressHash));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressIndexKey indexKey;
+            ssKey >> chType;
+            if (chType != 'a')
+                break;
+            ssKey >> indexKey;
+            if (indexKey.type != (unsigned int)type || indexKey.hashBytes != addressHash)
+                break;
+            if (end > 0 && indexKey.blockHeight > end)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CAmount nValue;
+            ssValue >> nValue;
+            addressIndex.push_back(make_pair(indexKey, nValue));
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey& timestampIndex)
+{
+    return Write(make_pair('s', timestampIndex), '0');
+}
+
+bool CBlockTreeDB::EraseTimestampIndex(const CTimestampIndexKey& timestampIndex)
+{
+    return Erase(make_pair('s', timestampIndex));
+}
+
+bool CBlockTreeDB::ReadTimestampIndex(const unsigned int& high, const unsigned int& low, std::vector<uint256>& hashes)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair('s', CTimestampIndexIteratorKey(low));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CTimestampIndexKey indexKey;
+            ssKey >> chType;
+            if (chType != 's')
+                break;
+            ssKey >> indexKey;
+            if (indexKey.timestamp >= high)
+                break;
+            hashes.push_back(indexKey.blockHash);
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string& name, bool fValue)
 {
     return Write(std::make_pair('F', name), fValue ? '1' : '0');
@@ -208,6 +377,137 @@ bool CBlockTreeDB::ReadInt(const std::string& name, int& nValue)
     return Read(std::make_pair('I', name), nValue);
 }
 
+namespace
+{
+//! Block index records read from the database before their hashes are computed together
+const size_t BLOCK_INDEX_LOAD_BATCH = 4096;
+
+void ThreadBlockIndexHashWorker(const std::vector<CDiskBlockIndex>* pvRecords, std::vector<uint256>* pvHashes, unsigned int nWorker, unsigned int nThreads)
+{
+    for (size_t i = nWorker; i < pvRecords->size(); i += nThreads)
+        (*pvHashes)[i] = (*pvRecords)[i].GetBlockHash();
+}
+
+/**
+ * Compute the hashes of a batch of block index records. Headers before
+ * version 4 use XEVAN, which dominates the load time, so the batch is
+ * spread over the script verification threads, idle at this point.
+ */
+void HashBlockIndexRecords(const std::vector<CDiskBlockIndex>& vRecords, std::vector<uint256>& vHashes)
+{
+    vHashes.resize(vRecords.size());
+    unsigned int nThreads = std::max(1, std::min(nScriptCheckThreads, (int)vRecords.size()));
+    if (nThreads <= 1) {
+        ThreadBlockIndexHashWorker(&vRecords, &vHashes, 0, 1);
+    } else {
+        boost::this_thread::disable_interruption di;
+        boost::thread_group threadGroup;
+        for (unsigned int i = 0; i < nThreads; i++)
+            threadGroup.create_thread(boost::bind(&ThreadBlockIndexHashWorker, &vRecords, &vHashes, i, nThreads));
+        threadGroup.join_all();
+    }
+}
+
+/** Fill an in-memory entry, already linked to its hash and predecessor, from its stored record */
+bool LoadBlockIndexEntry(const CDiskBlockIndex& diskindex, CBlockIndex* pindexNew)
+{
+    pindexNew->nHeight = diskindex.nHeight;
+    pindexNew->nFile = diskindex.nFile;
+    pindexNew->nDataPos = diskindex.nDataPos;
+    pindexNew->nUndoPos = diskindex.nUndoPos;
+    pindexNew->nVersion = diskindex.nVersion;
+    pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+    pindexNew->nTime = diskindex.nTime;
+    pindexNew->nBits = diskindex.nBits;
+    pindexNew->nNonce = diskindex.nNonce;
+    pindexNew->nStatus = diskindex.nStatus;
+    pindexNew->nTx = diskindex.nTx;
+
+    //zerocoin
+    pindexNew->nAccumulatorCheckpoint = diskindex.nAccumulatorCheckpoint;
+    pindexNew->zerocoinSupply = diskindex.zerocoinSupply;
+    pindexNew->mintDenominationsInBlock = diskindex.mintDenominationsInBlock;
+
+    //Proof Of Stake
+    pindexNew->nMint = diskindex.nMint;
+    pindexNew->nMoneySupply = diskindex.nMoneySupply;
+    pindexNew->nFlags = diskindex.nFlags;
+    pindexNew->nStakeModifier = diskindex.nStakeModifier;
+    pindexNew->prevoutStake = diskindex.prevoutStake;
+    pindexNew->nStakeTime = diskindex.nStakeTime;
+    pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
+
+    if (pindexNew->nHeight <= Params().LAST_POW_BLOCK()) {
+        if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
+            return error("LoadBlockIndex() : CheckProofOfWork failed: %s", pindexNew->ToString());
+    }
+
+    return true;
+}
+
+/** Record what a loaded entry adds to the stake and accumulator caches */
+void AddBlockIndexEntry(const CBlockIndex* pindexNew, uint256& nPreviousCheckpoint)
+{
+    // ppcoin: build setStakeSeen
+    if (pindexNew->IsProofOfStake())
+        setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+
+    //populate accumulator checksum map in memory
+    if(pindexNew->nAccumulatorCheckpoint != 0 && pindexNew->nAccumulatorCheckpoint != nPreviousCheckpoint) {
+        //Don't load any invalid checkpoints
+        if (!InvalidCheckpointRange(pindexNew->nHeight))
+            LoadAccumulatorValuesFromDB(pindexNew->nAccumulatorCheckpoint);
+
+        nPreviousCheckpoint = pindexNew->nAccumulatorCheckpoint;
+    }
+}
+
+/** Snapshot entries in file order; each names its predecessor by position */
+template <typename Stream>
+bool ReadBlockIndexSnapshot(Stream& s, const uint256& nSnapshotId, const uint256& hashBestBlock, const uint256& hashBlockFiles, std::vector<CBlockIndex*>& vIndex)
+{
+    unsigned char pchMessageStart[4];
+    int nSnapshotVersion;
+    uint256 nFileId;
+    uint256 hashFileBestBlock;
+    uint256 hashFileBlockFiles;
+    uint64_t nEntries;
+    s >> FLATDATA(pchMessageStart) >> nSnapshotVersion;
+    if (memcmp(pchMessageStart, Params().MessageStart(), sizeof(pchMessageStart)))
+        return error("%s : Invalid network magic number", __func__);
+    if (nSnapshotVersion != BLOCK_INDEX_SNAPSHOT_VERSION)
+        return error("%s : Unsupported version %d", __func__, nSnapshotVersion);
+    s >> nFileId >> hashFileBestBlock >> hashFileBlockFiles >> nEntries;
+    if (nFileId != nSnapshotId)
+        return error("%s : Snapshot does not match the block index database", __func__);
+    if (hashFileBestBlock != hashBestBlock)
+        return error("%s : Snapshot does not match the coins database best block", __func__);
+    if (hashFileBlockFiles != hashBlockFiles)
+        return error("%s : Snapshot does not match the block files", __func__);
+
+    vIndex.reserve(nEntries);
+    for (uint64_t i = 0; i < nEntries; i++) {
+        uint256 hash;
+        int32_t nPrev;
+        CDiskBlockIndex diskindex;
+        s >> hash >> nPrev >> diskindex;
+        if (nPrev < -1 || nPrev >= (int64_t)i)
+            return error("%s : Invalid predecessor of %s", __func__, hash.ToString());
+
+        if (mapBlockIndex.count(hash))
+            return error("%s : Duplicate entry %s", __func__, hash.ToString());
+        CBlockIndex* pindexNew = InsertBlockIndex(hash);
+        vIndex.push_back(pindexNew);
+        pindexNew->pprev = nPrev < 0 ? NULL : vIndex[nPrev];
+        if (!LoadBlockIndexEntry(diskindex, pindexNew))
+            return false;
+        if (i > 0 && pindexNew->nHeight < vIndex[i - 1]->nHeight)
+            return error("%s : Entries are not in height order", __func__);
+    }
+    return true;
+}
+} // anon namespace
+
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
     boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
@@ -218,75 +518,200 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
 
     // Load mapBlockIndex
     uint256 nPreviousCheckpoint;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-            leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == 'b') {
+    std::vector<CDiskBlockIndex> vRecords;
+    std::vector<uint256> vHashes;
+    bool fDone = false;
+    while (!fDone) {
+        // Read a batch of records, then hash them all at once
+        vRecords.clear();
+        while (vRecords.size() < BLOCK_INDEX_LOAD_BATCH) {
+            boost::this_thread::interruption_point();
+            if (!pcursor->Valid()) {
+                fDone = true;
+                break;
+            }
+            try {
+                leveldb::Slice slKey = pcursor->key();
+                CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+                char chType;
+                ssKey >> chType;
+                if (chType != 'b') {
+                    fDone = true; // if shutdown requested or finished loading block index
+                    break;
+                }
                 leveldb::Slice slValue = pcursor->value();
                 CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskindex;
-                ssValue >> diskindex;
-
-                // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev = InsertBlockIndex(diskindex.hashPrev);
-                pindexNew->pnext = InsertBlockIndex(diskindex.hashNext);
-                pindexNew->nHeight = diskindex.nHeight;
-                pindexNew->nFile = diskindex.nFile;
-                pindexNew->nDataPos = diskindex.nDataPos;
-                pindexNew->nUndoPos = diskindex.nUndoPos;
-                pindexNew->nVersion = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime = diskindex.nTime;
-                pindexNew->nBits = diskindex.nBits;
-                pindexNew->nNonce = diskindex.nNonce;
-                pindexNew->nStatus = diskindex.nStatus;
-                pindexNew->nTx = diskindex.nTx;
-
-                //zerocoin
-                pindexNew->nAccumulatorCheckpoint = diskindex.nAccumulatorCheckpoint;
-                pindexNew->mapZerocoinSupply = diskindex.mapZerocoinSupply;
-                pindexNew->vMintDenominationsInBlock = diskindex.vMintDenominationsInBlock;
-
-                //Proof Of Stake
-                pindexNew->nMint = diskindex.nMint;
-                pindexNew->nMoneySupply = diskindex.nMoneySupply;
-                pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake = diskindex.prevoutStake;
-                pindexNew->nStakeTime = diskindex.nStakeTime;
-                pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
-
-                if (pindexNew->nHeight <= Params().LAST_POW_BLOCK()) {
-                    if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
-                        return error("LoadBlockIndex() : CheckProofOfWork failed: %s", pindexNew->ToString());
-                }
-                // ppcoin: build setStakeSeen
-                if (pindexNew->IsProofOfStake())
-                    setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+                vRecords.push_back(CDiskBlockIndex());
+                ssValue >> vRecords.back();
+                pcursor->Next();
+            } catch (std::exception& e) {
+                return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+            }
+        }
 
-                //populate accumulator checksum map in memory
-                if(pindexNew->nAccumulatorCheckpoint != 0 && pindexNew->nAccumulatorCheckpoint != nPreviousCheckpoint) {
-                    //Don't load any invalid checkpoints
-                    if (!InvalidCheckpointRange(pindexNew->nHeight))
-                        LoadAccumulatorValuesFromDB(pindexNew->nAccumulatorCheckpoint);
+        HashBlockIndexRecords(vRecords, vHashes);
+        for (size_t i = 0; i < vRecords.size(); i++) {
+            const CDiskBlockIndex& diskindex = vRecords[i];
+
+            // Construct block index object
+            CBlockIndex* pindexNew = InsertBlockIndex(vHashes[i]);
+            pindexNew->pprev = InsertBlockIndex(diskindex.hashPrev);
+            pindexNew->pnext = InsertBlockIndex(diskindex.hashNext);
+            if (!LoadBlockIndexEntry(diskindex, pindexNew))
+                return false;
+            AddBlockIndexEntry(pindexNew, nPreviousCheckpoint);
+        }
+    }
 
-                    nPreviousCheckpoint = pindexNew->nAccumulatorCheckpoint;
-                }
+    return true;
+}
 
-                pcursor->Next();
-            } else {
-                break; // if shutdown requested or finished loading block index
+uint256 CBlockTreeDB::GetBlockFilesHash()
+{
+    // Same records LoadBlockIndexDB reads: up to the last file and any after it
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    int nLastFile = 0;
+    ReadLastBlockFile(nLastFile);
+    ss << nLastFile;
+    for (int nFile = 0; true; nFile++) {
+        CBlockFileInfo info;
+        if (!ReadBlockFileInfo(nFile, info) && nFile > nLastFile)
+            break;
+        ss << info;
+    }
+    return ss.GetHash();
+}
+
+bool CBlockTreeDB::WriteBlockIndexSnapshot(const boost::filesystem::path& path, const uint256& hashBestBlock)
+{
+    int64_t nStart = GetTimeMillis();
+
+    std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
+    vSortedByHeight.reserve(mapBlockIndex.size());
+    BOOST_FOREACH (const PAIRTYPE(uint256, CBlockIndex*) & item, mapBlockIndex)
+        vSortedByHeight.push_back(make_pair(item.second->nHeight, item.second));
+    sort(vSortedByHeight.begin(), vSortedByHeight.end());
+    std::map<const CBlockIndex*, int32_t> mapPosition;
+    for (size_t i = 0; i < vSortedByHeight.size(); i++)
+        mapPosition[vSortedByHeight[i].second] = i;
+
+    uint256 nSnapshotId = GetRandHash();
+    boost::filesystem::path pathTmp = path.string() + ".new";
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    // Entries are written in chunks, each added to the checksum as it goes
+    try {
+        CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << FLATDATA(Params().MessageStart()) << BLOCK_INDEX_SNAPSHOT_VERSION << nSnapshotId << hashBestBlock << GetBlockFilesHash() << (uint64_t)vSortedByHeight.size();
+        for (size_t i = 0; i < vSortedByHeight.size(); i++) {
+            CBlockIndex* pindex = vSortedByHeight[i].second;
+            int32_t nPrev = -1;
+            if (pindex->pprev) {
+                std::map<const CBlockIndex*, int32_t>::const_iterator mi = mapPosition.find(pindex->pprev);
+                if (mi == mapPosition.end())
+                    return error("%s : Predecessor of %s is not indexed", __func__, pindex->GetBlockHash().ToString());
+                nPrev = mi->second;
             }
-        } catch (std::exception& e) {
-            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+            ss << pindex->GetBlockHash() << nPrev << CDiskBlockIndex(pindex);
+
+            if (ss.size() >= 1000000 || i + 1 == vSortedByHeight.size()) {
+                hasher.write(&ss[0], ss.size());
+                fileout.write(&ss[0], ss.size());
+                ss.clear();
+            }
+        }
+        fileout << hasher.GetHash();
+    } catch (std::exception& e) {
+        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path))
+        return error("%s : Rename-into-place failed", __func__);
+    if (!Write(make_pair('S', std::string("blockindex")), nSnapshotId, true))
+        return error("%s : Failed to record the snapshot id", __func__);
+
+    LogPrintf("%s : wrote %u block index entries in %dms\n", __func__, vSortedByHeight.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
+bool CBlockTreeDB::DiscardBlockIndexSnapshot()
+{
+    return Erase(make_pair('S', std::string("blockindex")), true);
+}
+
+bool CBlockTreeDB::LoadBlockIndexSnapshot(const boost::filesystem::path& path, const uint256& hashBestBlock, std::vector<std::pair<int, CBlockIndex*> >& vSortedByHeight)
+{
+    uint256 nSnapshotId;
+    if (!Read(make_pair('S', std::string("blockindex")), nSnapshotId))
+        return false;
+    // From here on the database may change, which leaves the snapshot stale
+    if (!DiscardBlockIndexSnapshot())
+        return error("%s : Failed to clear the snapshot id", __func__);
+
+    int64_t nStart = GetTimeMillis();
+    uint256 hashBlockFiles = GetBlockFilesHash();
+    std::vector<CBlockIndex*> vIndex;
+    size_t nArenaSize = blockIndexArena.Size();
+    bool fLoaded = false;
+    try {
+        boost::shared_ptr<CMappedFile> file(new CMappedFile());
+        CDataStream ssFile(SER_DISK, CLIENT_VERSION);
+        const unsigned char* pbegin;
+        uint64_t nSize;
+        if (file->Open(path)) {
+            pbegin = file->begin();
+            nSize = file->size();
+        } else {
+            // No memory mappings on this platform: read the file instead
+            CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("%s : Failed to open file %s", __func__, path.string());
+            ssFile.resize(boost::filesystem::file_size(path));
+            filein.read(&ssFile[0], ssFile.size());
+            pbegin = (const unsigned char*)&ssFile[0];
+            nSize = ssFile.size();
+        }
+
+        if (nSize < sizeof(uint256))
+            return error("%s : File %s is truncated", __func__, path.string());
+        uint256 hashIn;
+        memcpy(hashIn.begin(), pbegin + nSize - sizeof(uint256), sizeof(uint256));
+        if (hashIn != Hash(pbegin, pbegin + nSize - sizeof(uint256)))
+            return error("%s : Checksum mismatch, data corrupted", __func__);
+
+        if (!file->IsNull()) {
+            CMappedFileReader reader(file, 0, nSize - sizeof(uint256), SER_DISK, CLIENT_VERSION);
+            fLoaded = ReadBlockIndexSnapshot(reader, nSnapshotId, hashBestBlock, hashBlockFiles, vIndex);
+        } else {
+            CDataStream ssData(ssFile.begin(), ssFile.end() - sizeof(uint256), SER_DISK, CLIENT_VERSION);
+            fLoaded = ReadBlockIndexSnapshot(ssData, nSnapshotId, hashBestBlock, hashBlockFiles, vIndex);
         }
+    } catch (std::exception& e) {
+        error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
 
+    if (!fLoaded) {
+        mapBlockIndex.clear();
+        blockIndexArena.Truncate(nArenaSize);
+        return false;
+    }
+
+    // Only a complete load touches the stake and accumulator caches
+    uint256 nPreviousCheckpoint;
+    BOOST_FOREACH (CBlockIndex* pindex, vIndex)
+        AddBlockIndexEntry(pindex, nPreviousCheckpoint);
+
+    vSortedByHeight.clear();
+    vSortedByHeight.reserve(vIndex.size());
+    BOOST_FOREACH (CBlockIndex* pindex, vIndex)
+        vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
+    LogPrintf("%s : loaded %u block index entries in %dms\n", __func__, vIndex.size(), GetTimeMillis() - nStart);
     return true;
 }
 
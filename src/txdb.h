@@ -8,15 +8,20 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include "addressindex.h"
 #include "leveldbwrapper.h"
 #include "main.h"
 #include "primitives/zerocoin.h"
+#include "spentindex.h"
+#include "timestampindex.h"
 
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <boost/filesystem/path.hpp>
+
 class CCoins;
 class uint256;
 
@@ -26,6 +31,12 @@ static const int64_t nDefaultDbCache = 100;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 4096 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -blockindexsnapshot default
+static const bool DEFAULT_BLOCK_INDEX_SNAPSHOT = true;
+//! Block index snapshot file in the data directory
+static const char* const BLOCK_INDEX_SNAPSHOT_FILENAME = "blockindex.snapshot";
+//! Format version of the block index snapshot file
+static const int BLOCK_INDEX_SNAPSHOT_VERSION = 2;
 
 /** CCoinsView backed by the LevelDB coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
@@ -63,11 +74,39 @@ public:
     bool ReadReindexing(bool& fReindex);
     bool ReadTxIndex(const uint256& txid, CDiskTxPos& pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& list);
+    bool ReadSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value);
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& vect);
+    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vect);
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vect);
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect);
+    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect);
+    bool ReadAddressIndex(uint160 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex, int start = 0, int end = 0);
+    bool WriteTimestampIndex(const CTimestampIndexKey& timestampIndex);
+    bool EraseTimestampIndex(const CTimestampIndexKey& timestampIndex);
+    bool ReadTimestampIndex(const unsigned int& high, const unsigned int& low, std::vector<uint256>& vect);
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
     bool WriteInt(const std::string& name, int nValue);
     bool ReadInt(const std::string& name, int& nValue);
     bool LoadBlockIndexGuts();
+
+    /** Hash of the block file records, which change whenever a block is stored */
+    uint256 GetBlockFilesHash();
+    /**
+     * Dump mapBlockIndex to a snapshot file and mark it as matching this
+     * database, its block file records and the coins database best block
+     */
+    bool WriteBlockIndexSnapshot(const boost::filesystem::path& path, const uint256& hashBestBlock);
+    /**
+     * Fill mapBlockIndex from a snapshot file, if it was written against the
+     * current contents of this database and a coins database at hashBestBlock,
+     * and return its entries in height order. The snapshot is consumed: it
+     * will not be used again until the next WriteBlockIndexSnapshot. On
+     * failure mapBlockIndex is left empty.
+     */
+    bool LoadBlockIndexSnapshot(const boost::filesystem::path& path, const uint256& hashBestBlock, std::vector<std::pair<int, CBlockIndex*> >& vSortedByHeight);
+    /** Mark any snapshot file as stale, before the block index is changed without loading it */
+    bool DiscardBlockIndexSnapshot();
 };
 
 class CZerocoinDB : public CLevelDBWrapper
@@ -11,6 +11,7 @@
 #include "base58.h"
 #include "checkpoints.h"
 #include "coincontrol.h"
+#include "init.h"
 #include "kernel.h"
 #include "masternode-budget.h"
 #include "net.h"
@@ -58,14 +59,6 @@ int64_t nStartupTime = GetAdjustedTime();
  * @{
  */
 
-struct CompareValueOnly {
-    bool operator()(const pair<CAmount, pair<const CWalletTx*, unsigned int> >& t1,
-        const pair<CAmount, pair<const CWalletTx*, unsigned int> >& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
 std::string COutput::ToString() const
 {
     return strprintf("COutput(%s, %d, %d) [%s]", tx->GetHash().ToString(), i, nDepth, FormatMoney(tx->vout[i].nValue));
@@ -439,6 +432,63 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+/**
+ * True if every output of ours is spent by a wallet transaction that is
+ * already in a block. Such a transaction can only contribute to a balance
+ * again after a reorg or a change in which scripts are ours.
+ */
+bool CWallet::IsFullySpent(const CWalletTx& wtx) const
+{
+    if ((wtx.IsCoinBase() || wtx.IsCoinStake()) && wtx.GetBlocksToMaturity() > 0)
+        return false;
+
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+        bool fSpent = false;
+        pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hash, i));
+        for (TxSpends::const_iterator it = range.first; it != range.second && !fSpent; ++it) {
+            std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+            fSpent = mit != mapWallet.end() && mit->second.GetDepthInMainChain(false) >= 1;
+        }
+        if (!fSpent && IsMine(wtx.vout[i]) != ISMINE_NO)
+            return false;
+    }
+    return true;
+}
+
+std::vector<const CWalletTx*> CWallet::GetSpendableTxs() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (fSpendableTxsDirty) {
+        setSpendableTxs.clear();
+        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+            setSpendableTxs.insert(setSpendableTxs.end(), it->first);
+        fSpendableTxsDirty = false;
+        hashSpendableTxsTip = 0;
+    }
+
+    // Spends only become confirmed when the tip moves, so look for fully
+    // spent transactions once per tip
+    uint256 hashTip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256(0);
+    bool fPrune = hashTip != hashSpendableTxsTip;
+    hashSpendableTxsTip = hashTip;
+
+    std::vector<const CWalletTx*> vTxs;
+    vTxs.reserve(setSpendableTxs.size());
+    for (std::set<uint256>::iterator it = setSpendableTxs.begin(); it != setSpendableTxs.end();) {
+        map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(*it);
+        if (mi == mapWallet.end() || (fPrune && IsFullySpent(mi->second))) {
+            setSpendableTxs.erase(it++);
+            continue;
+        }
+        vTxs.push_back(&mi->second);
+        ++it;
+    }
+    return vTxs;
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(make_pair(outpoint, wtxid));
@@ -601,6 +651,8 @@ bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
         Lock();
         Unlock(strWalletPassphrase);
         NewKeyPool();
+        // Pre-generated mints were stored in the clear
+        ClearMintPool();
         Lock();
 
         // Need to completely rewrite the wallet file; if we don't, bdb might keep
@@ -653,6 +705,36 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         BOOST_FOREACH (PAIRTYPE(const uint256, CWalletTx) & item, mapWallet)
             item.second.MarkDirty();
+        // IsMine may have changed for outputs dropped from the spendable index
+        fSpendableTxsDirty = true;
+        // and for the inputs obfuscation rounds were counted through
+        mapObfuscationRounds.clear();
+    }
+}
+
+void CWallet::InvalidateObfuscationRounds(const uint256& hashTx)
+{
+    AssertLockHeld(cs_wallet);
+    std::vector<uint256> vToErase(1, hashTx);
+    std::set<uint256> setErased;
+    while (!vToErase.empty()) {
+        uint256 hash = vToErase.back();
+        vToErase.pop_back();
+        if (!setErased.insert(hash).second)
+            continue;
+
+        std::map<COutPoint, int>::iterator it = mapObfuscationRounds.lower_bound(COutPoint(hash, 0));
+        while (it != mapObfuscationRounds.end() && it->first.hash == hash)
+            mapObfuscationRounds.erase(it++);
+
+        const CWalletTx* wtx = GetWalletTx(hash);
+        if (wtx == NULL)
+            continue;
+        for (unsigned int i = 0; i < wtx->vout.size(); i++) {
+            pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hash, i));
+            for (TxSpends::const_iterator itSpend = range.first; itSpend != range.second; ++itSpend)
+                vToErase.push_back(itSpend->second);
+        }
     }
 }
 
@@ -664,6 +746,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
         mapWallet[hash] = wtxIn;
         mapWallet[hash].BindWallet(this);
         AddToSpends(hash);
+        setSpendableTxs.insert(hash);
+        // Transactions load in no particular order; rounds are counted on first use
+        InvalidateObfuscationRounds(hash);
     } else {
         LOCK(cs_wallet);
         // Inserts only if not already there, returns tx inserted or tx found
@@ -744,6 +829,15 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
 
         // Break debit/credit balance caches:
         wtx.MarkDirty();
+        setSpendableTxs.insert(hash);
+
+        // Count the obfuscation rounds of our new outputs while the inputs are cached
+        if (fInsertedNew) {
+            InvalidateObfuscationRounds(hash);
+            for (unsigned int i = 0; i < wtx.vout.size(); i++)
+                if (IsMine(wtx.vout[i]) != ISMINE_NO)
+                    GetRealInputObfuscationRounds(CTxIn(hash, i), 0);
+        }
 
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -784,6 +878,7 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
 {
     LOCK2(cs_main, cs_wallet);
+    zTPCTracker->SyncTransaction(tx, pblock);
     if (!AddToWalletIfInvolvingMe(tx, pblock, true))
         return; // Not one of ours
 
@@ -791,19 +886,33 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     // available of the outputs it spends. So force those to be
     // recomputed, also:
     BOOST_FOREACH (const CTxIn& txin, tx.vin) {
-        if (!tx.IsZerocoinSpend() && mapWallet.count(txin.prevout.hash))
+        if (!tx.IsZerocoinSpend() && mapWallet.count(txin.prevout.hash)) {
             mapWallet[txin.prevout.hash].MarkDirty();
+            setSpendableTxs.insert(txin.prevout.hash);
+        }
     }
 }
 
+void CWallet::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    zTPCTracker->BlockDisconnected(block);
+}
+
 void CWallet::EraseFromWallet(const uint256& hash)
 {
     if (!fFileBacked)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
-            CWalletDB(strWalletFile).EraseTx(hash);
+        map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it == mapWallet.end())
+            return;
+        // The outputs this transaction spent are unspent again
+        BOOST_FOREACH (const CTxIn& txin, it->second.vin)
+            setSpendableTxs.insert(txin.prevout.hash);
+        InvalidateObfuscationRounds(hash);
+        mapWallet.erase(it);
+        CWalletDB(strWalletFile).EraseTx(hash);
     }
     return;
 }
@@ -825,7 +934,7 @@ isminetype CWallet::IsMine(const CTxIn& txin) const
 
 bool CWallet::IsMyZerocoinSpend(const CBigNum& bnSerial) const
 {
-    return CWalletDB(strWalletFile).ReadZerocoinSpendSerialEntry(bnSerial);
+    return zTPCTracker->IsSpentSerial(bnSerial);
 }
 
 CAmount CWallet::GetDebit(const CTxIn& txin, const isminefilter& filter) const
@@ -846,7 +955,7 @@ CAmount CWallet::GetDebit(const CTxIn& txin, const isminefilter& filter) const
 // Recursively determine the rounds of a given input (How deep is the Obfuscation chain for a given input)
 int CWallet::GetRealInputObfuscationRounds(CTxIn in, int rounds) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
+    AssertLockHeld(cs_wallet);
 
     if (rounds >= 16) return 15; // 16 rounds max
 
@@ -855,17 +964,10 @@ int CWallet::GetRealInputObfuscationRounds(CTxIn in, int rounds) const
 
     const CWalletTx* wtx = GetWalletTx(hash);
     if (wtx != NULL) {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        // not known yet, let's add it
-        if (mdwi == mDenomWtxes.end()) {
-            LogPrint("obfuscation", "GetInputObfuscationRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        }
-        // found and it's not an initial value, just return it
-        else if (mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
-
+        // already counted, just return it
+        std::map<COutPoint, int>::const_iterator mri = mapObfuscationRounds.find(in.prevout);
+        if (mri != mapObfuscationRounds.end())
+            return mri->second;
 
         // bounds check
         if (nout >= wtx->vout.size()) {
@@ -874,18 +976,20 @@ int CWallet::GetRealInputObfuscationRounds(CTxIn in, int rounds) const
             return -4;
         }
 
-        if (pwalletMain->IsCollateralAmount(wtx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+        int& nRounds = mapObfuscationRounds[in.prevout];
+
+        if (IsCollateralAmount(wtx->vout[nout].nValue)) {
+            nRounds = -3;
+            LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, nRounds);
+            return nRounds;
         }
 
         //make sure the final output is non-denominate
         if (/*rounds == 0 && */ !IsDenominatedAmount(wtx->vout[nout].nValue)) //NOT DENOM
         {
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            nRounds = -2;
+            LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, nRounds);
+            return nRounds;
         }
 
         bool fAllDenoms = true;
@@ -894,9 +998,9 @@ int CWallet::GetRealInputObfuscationRounds(CTxIn in, int rounds) const
         }
         // this one is denominated but there is another non-denominated output found in the same tx
         if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            nRounds = 0;
+            LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, nRounds);
+            return nRounds;
         }
 
         int nShortest = -10; // an initial value, should be no way to get this by calculations
@@ -912,11 +1016,11 @@ int CWallet::GetRealInputObfuscationRounds(CTxIn in, int rounds) const
                 }
             }
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound ? (nShortest >= 15 ? 16 : nShortest + 1) // good, we a +1 to the shortest one but only 16 rounds max allowed
-                                                             :
-                                                             0; // too bad, we are the fist one in that chain
-        LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
+        nRounds = fDenomFound ? (nShortest >= 15 ? 16 : nShortest + 1) // good, we a +1 to the shortest one but only 16 rounds max allowed
+                                :
+                                0; // too bad, we are the fist one in that chain
+        LogPrint("obfuscation", "GetInputObfuscationRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, nRounds);
+        return nRounds;
     }
 
     return rounds - 1;
@@ -1126,17 +1230,127 @@ bool CWalletTx::WriteToDisk()
     return CWalletDB(pwallet->strWalletFile).WriteTx(GetHash(), *this);
 }
 
+namespace
+{
+/** A block handed to the rescan workers */
+struct CRescanBlock {
+    CBlockIndex* pindex;
+    uint256 hash;
+    CDiskBlockPos pos;
+    CBlock block;
+    bool fRead;
+    std::vector<bool> vMatch; //! per transaction: some output may be ours
+};
+
+/**
+ * Quick filter for the rescan workers. Pay-to-pubkey-hash, pay-to-script-hash
+ * and pay-to-pubkey outputs can only be ours if their script is in setScripts;
+ * anything else falls back to IsMine. setScripts is taken when the batch is
+ * queued, so the commit rechecks every transaction if the wallet gained
+ * scripts since.
+ */
+bool IsRescanCandidate(const CKeyStore& keystore, const std::set<CScript>& setScripts, const CScript& script)
+{
+    if (setScripts.count(script))
+        return true;
+    if (script.IsPayToScriptHash())
+        return false;
+    if (script.size() == 25 && script[0] == OP_DUP && script[1] == OP_HASH160 && script[2] == 20 &&
+        script[23] == OP_EQUALVERIFY && script[24] == OP_CHECKSIG)
+        return false;
+    if (((script.size() == 35 && script[0] == 33) || (script.size() == 67 && script[0] == 65)) && script.back() == OP_CHECKSIG)
+        return false;
+    return IsMine(keystore, script) != ISMINE_NO;
+}
+
+void ThreadRescanWorker(const CKeyStore* pkeystore, const std::set<CScript>* psetScripts, std::vector<CRescanBlock>* pvBlocks, unsigned int nThread, unsigned int nThreads)
+{
+    for (unsigned int i = nThread; i < pvBlocks->size(); i += nThreads) {
+        CRescanBlock& rb = (*pvBlocks)[i];
+        rb.fRead = ReadBlockFromDisk(rb.block, rb.pos) && rb.block.GetHash() == rb.hash;
+        if (!rb.fRead)
+            continue;
+
+        rb.vMatch.assign(rb.block.vtx.size(), false);
+        for (unsigned int j = 0; j < rb.block.vtx.size(); j++) {
+            BOOST_FOREACH (const CTxOut& txout, rb.block.vtx[j].vout) {
+                if (IsRescanCandidate(*pkeystore, *psetScripts, txout.scriptPubKey)) {
+                    rb.vMatch[j] = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/** Queue up to RESCAN_BATCH_BLOCKS blocks from pindex on; returns the block after the batch */
+CBlockIndex* CollectRescanBatch(CBlockIndex* pindex, std::vector<CRescanBlock>& vBlocks)
+{
+    AssertLockHeld(cs_main);
+    vBlocks.clear();
+    while (pindex && vBlocks.size() < RESCAN_BATCH_BLOCKS) {
+        vBlocks.push_back(CRescanBlock());
+        CRescanBlock& rb = vBlocks.back();
+        rb.pindex = pindex;
+        rb.hash = pindex->GetBlockHash();
+        rb.pos = pindex->GetBlockPos();
+        rb.fRead = false;
+        pindex = chainActive.Next(pindex);
+    }
+    return pindex;
+}
+
+void StartRescanWorkers(boost::thread_group& threadGroup, const CKeyStore* pkeystore, const std::set<CScript>* psetScripts, std::vector<CRescanBlock>* pvBlocks, unsigned int nThreads)
+{
+    for (unsigned int i = 0; i < nThreads; i++)
+        threadGroup.create_thread(boost::bind(&ThreadRescanWorker, pkeystore, psetScripts, pvBlocks, i, nThreads));
+}
+} // anon namespace
+
+/** Every script IsMine can recognise without solving it, for the rescan filter */
+void CWallet::GetRescanScripts(std::set<CScript>& setScripts) const
+{
+    std::set<CKeyID> setKeyIds;
+    GetKeys(setKeyIds);
+    BOOST_FOREACH (const CKeyID& keyID, setKeyIds) {
+        setScripts.insert(GetScriptForDestination(keyID));
+        CPubKey pubkey;
+        if (GetPubKey(keyID, pubkey))
+            setScripts.insert(CScript() << ToByteVector(pubkey) << OP_CHECKSIG);
+    }
+
+    LOCK(cs_KeyStore);
+    for (ScriptMap::const_iterator it = mapScripts.begin(); it != mapScripts.end(); ++it)
+        setScripts.insert(GetScriptForDestination(CScriptID(it->second)));
+    setScripts.insert(setWatchOnly.begin(), setWatchOnly.end());
+    setScripts.insert(setMultiSig.begin(), setMultiSig.end());
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * Blocks are read and filtered against the wallet's scripts, as of the
+ * time each batch is queued, by -rescanthreads workers, one batch ahead of
+ * the batch being committed.
+ * Matches are committed in chain order under cs_main and cs_wallet, which
+ * are released between batches. Progress is stored in the wallet so a
+ * rescan cut short by shutdown resumes at the next start.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
+    LOCK(cs_rescan);
+
     int ret = 0;
     int64_t nNow = GetTime();
+    unsigned int nThreads = std::max(1, std::min(16, (int)GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS)));
 
+    std::set<CScript> setScriptsCurrent, setScriptsNext;
+    std::vector<CRescanBlock> vCurrent, vNext;
     CBlockIndex* pindex = pindexStart;
+    CBlockIndex* pindexNext = NULL;
+    double dProgressStart, dProgressTip;
     {
         LOCK2(cs_main, cs_wallet);
 
@@ -1145,30 +1359,140 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainActive.Tip(), false);
-        while (pindex) {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-
-            CBlock block;
-            ReadBlockFromDisk(block, pindex);
-            BOOST_FOREACH (CTransaction& tx, block.vtx) {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
-                    ret++;
+        GetRescanScripts(setScriptsCurrent);
+        dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainActive.Tip(), false);
+        if (pindex && fFileBacked)
+            CWalletDB(strWalletFile).WriteRescanProgress(chainActive.GetLocator(pindex->pprev ? pindex->pprev : pindex));
+
+        LOCK(cs_rescanStatus);
+        rescanStatus = CWalletRescanStatus();
+        rescanStatus.fActive = true;
+        rescanStatus.nStartTime = nNow;
+        rescanStatus.nStartHeight = rescanStatus.nHeight = pindex ? pindex->nHeight : chainActive.Height();
+        rescanStatus.nStopHeight = chainActive.Height();
+
+        pindexNext = CollectRescanBatch(pindex, vCurrent);
+    }
+
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+    {
+        boost::thread_group threadGroup;
+        StartRescanWorkers(threadGroup, this, &setScriptsCurrent, &vCurrent, nThreads);
+        threadGroup.join_all();
+    }
+
+    bool fInterrupted = false;
+    while (!vCurrent.empty()) {
+        // Read the following batch while this one is committed
+        {
+            LOCK(cs_main);
+            pindexNext = CollectRescanBatch(pindexNext, vNext);
+        }
+        setScriptsNext.clear();
+        GetRescanScripts(setScriptsNext);
+        boost::thread_group threadGroup;
+        StartRescanWorkers(threadGroup, this, &setScriptsNext, &vNext, nThreads);
+
+        const CBlockIndex* pindexFork = NULL;
+        {
+            LOCK2(cs_main, cs_wallet);
+            CWalletDBBatch batch(strWalletFile);
+            CBlockIndex* pindexLast = NULL;
+            // Keys or scripts added after the batch was filtered: let
+            // AddToWalletIfInvolvingMe run IsMine/IsFromMe on every transaction
+            std::set<CScript> setScriptsNow;
+            GetRescanScripts(setScriptsNow);
+            bool fScriptsChanged = setScriptsNow != setScriptsCurrent;
+            BOOST_FOREACH (CRescanBlock& rb, vCurrent) {
+                if (!chainActive.Contains(rb.pindex)) {
+                    // The chain was reorganized under us; continue from the fork
+                    pindexFork = chainActive.FindFork(rb.pindex);
+                    break;
+                }
+                if (!rb.fRead) {
+                    LogPrintf("%s : failed to read block %s\n", __func__, rb.hash.ToString());
+                    continue;
+                }
+
+                for (unsigned int j = 0; j < rb.block.vtx.size(); j++) {
+                    const CTransaction& tx = rb.block.vtx[j];
+                    bool fCandidate = fScriptsChanged || rb.vMatch[j] || mapWallet.count(tx.GetHash());
+                    for (unsigned int k = 0; k < tx.vin.size() && !fCandidate; k++)
+                        fCandidate = mapWallet.count(tx.vin[k].prevout.hash) > 0;
+                    if (fCandidate && AddToWalletIfInvolvingMe(tx, &rb.block, fUpdate))
+                        ret++;
+                }
+                pindexLast = rb.pindex;
             }
-            pindex = chainActive.Next(pindex);
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(pindex));
+            batch.Commit();
+
+            if (pindexLast) {
+                if (fFileBacked)
+                    CWalletDB(strWalletFile).WriteRescanProgress(chainActive.GetLocator(pindexLast));
+                if (dProgressTip - dProgressStart > 0.0)
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(pindexLast, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+
+                LOCK(cs_rescanStatus);
+                rescanStatus.nHeight = pindexLast->nHeight;
+                rescanStatus.nStopHeight = chainActive.Height();
+                rescanStatus.nFound = ret;
+                rescanStatus.dProgress = chainActive.Height() > rescanStatus.nStartHeight ?
+                    (double)(pindexLast->nHeight - rescanStatus.nStartHeight) / (chainActive.Height() - rescanStatus.nStartHeight) : 1.0;
             }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+        threadGroup.join_all();
+
+        if (ShutdownRequested()) {
+            fInterrupted = true;
+            break;
+        }
+
+        if (pindexFork) {
+            LOCK(cs_main);
+            pindexNext = CollectRescanBatch(chainActive.Next(pindexFork), vNext);
+            setScriptsNext.clear();
+            GetRescanScripts(setScriptsNext);
+            boost::thread_group threadGroupFork;
+            StartRescanWorkers(threadGroupFork, this, &setScriptsNext, &vNext, nThreads);
+            threadGroupFork.join_all();
+        }
+        vCurrent.swap(vNext);
+        setScriptsCurrent.swap(setScriptsNext);
+
+        if (GetTime() >= nNow + 60 && !vCurrent.empty()) {
+            nNow = GetTime();
+            LogPrintf("Still rescanning. At block %d. Progress=%f\n", vCurrent[0].pindex->nHeight, Checkpoints::GuessVerificationProgress(vCurrent[0].pindex));
+        }
+    }
+
+    if (fInterrupted)
+        LogPrintf("%s : rescan interrupted, it will resume at the next start\n", __func__);
+    else if (fFileBacked)
+        CWalletDB(strWalletFile).EraseRescanProgress();
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+    {
+        LOCK(cs_rescanStatus);
+        rescanStatus.fActive = false;
+        if (!fInterrupted)
+            rescanStatus.dProgress = 1.0;
     }
     return ret;
 }
 
+CWalletRescanStatus CWallet::GetRescanStatus() const
+{
+    LOCK(cs_rescanStatus);
+    return rescanStatus;
+}
+
+bool CWallet::IsRescanning() const
+{
+    LOCK(cs_rescanStatus);
+    return rescanStatus.fActive;
+}
+
 void CWallet::ReacceptWalletTransactions()
 {
     LOCK2(cs_main, cs_wallet);
@@ -1204,6 +1528,7 @@ void CWalletTx::RelayWalletTransaction(std::string strCommand)
             LogPrintf("Relaying wtx %s\n", hash.ToString());
 
             if (strCommand == "ix") {
+                LOCK2(cs_main, cs_swifttx);
                 mapTxLockReq.insert(make_pair(hash, (CTransaction) * this));
                 CreateNewLock(((CTransaction) * this));
                 RelayTransactionLockReq((CTransaction) * this, true);
@@ -1274,8 +1599,7 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -1296,7 +1620,7 @@ CAmount CWallet::GetZerocoinBalance(bool fMatureOnly) const
     {
         LOCK2(cs_main, cs_wallet);
         // Get Unused coins
-        list<CZerocoinMint> listPubCoin = CWalletDB(strWalletFile).ListMintedCoins(true, fMatureOnly, true);
+        list<CZerocoinMint> listPubCoin = zTPCTracker->ListMints(true, fMatureOnly, true);
         for (auto& mint : listPubCoin) {
             libzerocoin::CoinDenomination denom = mint.GetDenomination();
             nTotal += libzerocoin::ZerocoinDenominationToAmount(denom);
@@ -1321,8 +1645,6 @@ CAmount CWallet::GetImmatureZerocoinBalance() const
 CAmount CWallet::GetUnconfirmedZerocoinBalance() const
 {
     CAmount nUnconfirmed = 0;
-    CWalletDB walletdb(pwalletMain->strWalletFile);
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(true, false, true);
 
     std::map<libzerocoin::CoinDenomination, int> mapUnconfirmed;
     for (const auto& denom : libzerocoin::zerocoinDenomList){
@@ -1331,6 +1653,7 @@ CAmount CWallet::GetUnconfirmedZerocoinBalance() const
 
     {
         LOCK2(cs_main, cs_wallet);
+        list<CZerocoinMint> listMints = zTPCTracker->ListMints(true, false, true);
         for (auto& mint : listMints){
             if (!mint.GetHeight() || mint.GetHeight() > chainActive.Height() - Params().Zerocoin_MintRequiredConfirmations()) {
                 libzerocoin::CoinDenomination denom = mint.GetDenomination();
@@ -1358,8 +1681,7 @@ CAmount CWallet::GetUnlockedCoins() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
 
             if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
                 nTotal += pcoin->GetUnlockedCredit();
@@ -1376,8 +1698,7 @@ CAmount CWallet::GetLockedCoins() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
 
             if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
                 nTotal += pcoin->GetLockedCredit();
@@ -1395,7 +1716,7 @@ std::map<libzerocoin::CoinDenomination, CAmount> CWallet::GetMyZerocoinDistribut
         spread.insert(std::pair<libzerocoin::CoinDenomination, CAmount>(denom, 0));
     {
         LOCK2(cs_main, cs_wallet);
-        list<CZerocoinMint> listPubCoin = CWalletDB(strWalletFile).ListMintedCoins(true, true, true);
+        list<CZerocoinMint> listPubCoin = zTPCTracker->ListMints(true, true, true);
         for (auto& mint : listPubCoin)
             spread.at(mint.GetDenomination())++;
     }
@@ -1410,8 +1731,7 @@ CAmount CWallet::GetAnonymizableBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
 
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAnonymizableCredit();
@@ -1428,8 +1748,7 @@ CAmount CWallet::GetAnonymizedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
 
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAnonymizedCredit();
@@ -1450,10 +1769,9 @@ double CWallet::GetAverageAnonymizedRounds() const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
 
-            uint256 hash = (*it).first;
+            const uint256& hash = pcoin->GetHash();
 
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
                 CTxIn vin = CTxIn(hash, i);
@@ -1482,10 +1800,9 @@ CAmount CWallet::GetNormalizedAnonymizedBalance() const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
 
-            uint256 hash = (*it).first;
+            const uint256& hash = pcoin->GetHash();
 
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
                 CTxIn vin = CTxIn(hash, i);
@@ -1509,8 +1826,7 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
 
             nTotal += pcoin->GetDenominatedCredit(unconfirmed);
         }
@@ -1524,8 +1840,7 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
             if (!IsFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -1538,8 +1853,7 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -1551,8 +1865,7 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -1566,8 +1879,7 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
             if (!IsFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -1580,8 +1892,7 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -1597,9 +1908,8 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+        BOOST_FOREACH (const CWalletTx* pcoin, GetSpendableTxs()) {
+            const uint256& wtxid = pcoin->GetHash();
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -1650,11 +1960,11 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
                 if (mine == ISMINE_WATCH_ONLY)
                     continue;
 
-                if (IsLockedCoin((*it).first, i) && nCoinType != ONLY_1000)
+                if (IsLockedCoin(wtxid, i) && nCoinType != ONLY_1000)
                     continue;
                 if (pcoin->vout[i].nValue <= 0 && !fIncludeZeroValue)
                     continue;
-                if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected((*it).first, i))
+                if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(wtxid, i))
                     continue;
 
                 bool fIsSpendable = false;
@@ -1688,13 +1998,21 @@ map<CBitcoinAddress, vector<COutput> > CWallet::AvailableCoinsByAddress(bool fCo
     return mapCoins;
 }
 
-static void ApproximateBestSubset(vector<pair<CAmount, pair<const CWalletTx*, unsigned int> > > vValue, const CAmount& nTotalLower, const CAmount& nTargetValue, vector<char>& vfBest, CAmount& nBest, int iterations = 1000)
+/** Coin visits one ApproximateBestSubset call may spend before cutting its iterations short */
+static const int64_t KNAPSACK_MAX_WORK = 1000000;
+static const int KNAPSACK_MIN_ITERATIONS = 10;
+
+static void ApproximateBestSubset(const vector<pair<CAmount, pair<const CWalletTx*, unsigned int> > >& vValue, const CAmount& nTotalLower, const CAmount& nTargetValue, vector<char>& vfBest, CAmount& nBest, int iterations = 1000)
 {
     vector<char> vfIncluded;
 
     vfBest.assign(vValue.size(), true);
     nBest = nTotalLower;
 
+    // Keep large wallets from spending seconds here; small ones get the full iteration count
+    if (!vValue.empty())
+        iterations = std::max(KNAPSACK_MIN_ITERATIONS, (int)std::min((int64_t)iterations, KNAPSACK_MAX_WORK / (int64_t)vValue.size()));
+
     seed_insecure_rand();
 
     for (int nRep = 0; nRep < iterations && nBest != nTargetValue; nRep++) {
@@ -1727,22 +2045,67 @@ static void ApproximateBestSubset(vector<pair<CAmount, pair<const CWalletTx*, un
     }
 }
 
+/** Branch and bound gives up after this many steps and leaves the work to ApproximateBestSubset */
+static const int BNB_MAX_TRIES = 100000;
+/** A P2PKH change output plus the input that spends it later */
+static const unsigned int CHANGE_OUTPUT_COST_BYTES = 34 + 148;
 
-// TODO: find appropriate place for this sort function
-// move denoms down
-bool less_then_denom(const COutput& out1, const COutput& out2)
+/**
+ * Depth-first search for the input set closest to nTargetValue that exceeds it
+ * by at most nMaxExcess, so no change output is needed. vValue must be sorted
+ * by descending value and sum to nTotal. Larger coins are tried first, and a
+ * coin is not tried again after an excluded coin of the same value, which
+ * would only lead to an equivalent selection.
+ */
+static bool SelectCoinsBnB(const vector<pair<CAmount, pair<const CWalletTx*, unsigned int> > >& vValue, const CAmount& nTotal, const CAmount& nTargetValue, const CAmount& nMaxExcess, vector<char>& vfBest, CAmount& nBest)
 {
-    const CWalletTx* pcoin1 = out1.tx;
-    const CWalletTx* pcoin2 = out2.tx;
+    vector<char> vfSelection; // include/exclude decision for each coin on the current branch
+    vfSelection.reserve(vValue.size());
+    CAmount nCurrent = 0;
+    CAmount nAvailable = nTotal; // value of the coins not decided on yet
+    bool fFound = false;
 
-    bool found1 = false;
-    bool found2 = false;
-    BOOST_FOREACH (CAmount d, obfuScationDenominations) // loop through predefined denoms
-    {
-        if (pcoin1->vout[out1.i].nValue == d) found1 = true;
-        if (pcoin2->vout[out2.i].nValue == d) found2 = true;
+    if (nTotal < nTargetValue)
+        return false;
+
+    for (int nTries = 0; nTries < BNB_MAX_TRIES; nTries++) {
+        bool fBacktrack = false;
+        if (nCurrent + nAvailable < nTargetValue || nCurrent > nTargetValue + nMaxExcess) {
+            fBacktrack = true;
+        } else if (nCurrent >= nTargetValue) {
+            if (!fFound || nCurrent < nBest) {
+                nBest = nCurrent;
+                vfBest = vfSelection;
+                vfBest.resize(vValue.size(), false);
+                fFound = true;
+            }
+            if (nBest == nTargetValue)
+                break;
+            fBacktrack = true;
+        }
+
+        if (fBacktrack) {
+            // Walk back to the last included coin whose exclusion branch is still unexplored
+            while (!vfSelection.empty() && !vfSelection.back()) {
+                vfSelection.pop_back();
+                nAvailable += vValue[vfSelection.size()].first;
+            }
+            if (vfSelection.empty())
+                break;
+            vfSelection.back() = false;
+            nCurrent -= vValue[vfSelection.size() - 1].first;
+        } else {
+            const CAmount& n = vValue[vfSelection.size()].first;
+            nAvailable -= n;
+            if (!vfSelection.empty() && !vfSelection.back() && n == vValue[vfSelection.size() - 1].first) {
+                vfSelection.push_back(false);
+            } else {
+                vfSelection.push_back(true);
+                nCurrent += n;
+            }
+        }
     }
-    return (!found1 && found2);
+    return fFound;
 }
 
 bool CWallet::SelectStakeCoins(std::set<std::pair<const CWalletTx*, unsigned int> >& setCoins, CAmount nTargetAmount) const
@@ -1842,7 +2205,56 @@ bool CWallet::MintableCoins()
     return false;
 }
 
-bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, vector<COutput> vCoins, set<pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const
+size_t CCoinSelectionPool::FindLower(CAmount nValue) const
+{
+    size_t nBegin = 0, nEnd = vEntries.size();
+    while (nBegin < nEnd) {
+        size_t nMid = nBegin + (nEnd - nBegin) / 2;
+        if (vEntries[nMid].nValue >= nValue)
+            nBegin = nMid + 1;
+        else
+            nEnd = nMid;
+    }
+    return nBegin;
+}
+
+struct CompareEntryValueDesc {
+    bool operator()(const CCoinSelectionPool::CEntry& e1, const CCoinSelectionPool::CEntry& e2) const
+    {
+        return e1.nValue > e2.nValue;
+    }
+};
+
+void CWallet::BuildCoinSelectionPool(const vector<COutput>& vCoins, CCoinSelectionPool& pool) const
+{
+    pool.vEntries.clear();
+    pool.vEntries.reserve(vCoins.size());
+    BOOST_FOREACH (const COutput& output, vCoins) {
+        if (!output.fSpendable)
+            continue;
+
+        CCoinSelectionPool::CEntry entry;
+        entry.nValue = output.tx->vout[output.i].nValue;
+        entry.nDepth = output.nDepth;
+        entry.fFromMe = output.tx->IsFromMe(ISMINE_ALL);
+        entry.fDenominated = IsDenominatedAmount(entry.nValue);
+        entry.coin = make_pair(output.tx, (unsigned int)output.i);
+        pool.vEntries.push_back(entry);
+    }
+
+    // Shuffle first so coins of equal value are picked in random order
+    random_shuffle(pool.vEntries.begin(), pool.vEntries.end(), GetRandInt);
+    stable_sort(pool.vEntries.begin(), pool.vEntries.end(), CompareEntryValueDesc());
+}
+
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const vector<COutput>& vCoins, set<pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const
+{
+    CCoinSelectionPool pool;
+    BuildCoinSelectionPool(vCoins, pool);
+    return SelectCoinsMinConf(nTargetValue, nConfMine, nConfTheirs, pool, setCoinsRet, nValueRet);
+}
+
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const CCoinSelectionPool& pool, set<pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const
 {
     setCoinsRet.clear();
     nValueRet = 0;
@@ -1854,42 +2266,39 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
     vector<pair<CAmount, pair<const CWalletTx*, unsigned int> > > vValue;
     CAmount nTotalLower = 0;
 
-    random_shuffle(vCoins.begin(), vCoins.end(), GetRandInt);
-
-    // move denoms down on the list
-    sort(vCoins.begin(), vCoins.end(), less_then_denom);
+    // Entries before nLowerBegin are worth at least nTargetValue + CENT
+    const size_t nLowerBegin = pool.FindLower(nTargetValue + CENT);
 
     // try to find nondenom first to prevent unneeded spending of mixed coins
     for (unsigned int tryDenom = 0; tryDenom < 2; tryDenom++) {
         if (fDebug) LogPrint("selectcoins", "tryDenom: %d\n", tryDenom);
         vValue.clear();
         nTotalLower = 0;
-        BOOST_FOREACH (const COutput& output, vCoins) {
-            if (!output.fSpendable)
-                continue;
 
-            const CWalletTx* pcoin = output.tx;
-
-            //            if (fDebug) LogPrint("selectcoins", "value %s confirms %d\n", FormatMoney(pcoin->vout[output.i].nValue), output.nDepth);
-            if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
+        // The smallest usable larger coin is the first one found walking up from nLowerBegin
+        for (size_t i = nLowerBegin; i-- > 0;) {
+            const CCoinSelectionPool::CEntry& entry = pool.vEntries[i];
+            if (entry.nDepth < (entry.fFromMe ? nConfMine : nConfTheirs))
                 continue;
+            if (tryDenom == 0 && entry.fDenominated) continue; // we don't want denom values on first run
+            if (entry.nValue < coinLowestLarger.first)
+                coinLowestLarger = make_pair(entry.nValue, entry.coin);
+            break;
+        }
 
-            int i = output.i;
-            CAmount n = pcoin->vout[i].nValue;
-            if (tryDenom == 0 && IsDenominatedAmount(n)) continue; // we don't want denom values on first run
-
-            pair<CAmount, pair<const CWalletTx*, unsigned int> > coin = make_pair(n, make_pair(pcoin, i));
+        for (size_t i = nLowerBegin; i < pool.vEntries.size(); i++) {
+            const CCoinSelectionPool::CEntry& entry = pool.vEntries[i];
+            if (entry.nDepth < (entry.fFromMe ? nConfMine : nConfTheirs))
+                continue;
+            if (tryDenom == 0 && entry.fDenominated) continue; // we don't want denom values on first run
 
-            if (n == nTargetValue) {
-                setCoinsRet.insert(coin.second);
-                nValueRet += coin.first;
+            if (entry.nValue == nTargetValue) {
+                setCoinsRet.insert(entry.coin);
+                nValueRet += entry.nValue;
                 return true;
-            } else if (n < nTargetValue + CENT) {
-                vValue.push_back(coin);
-                nTotalLower += n;
-            } else if (n < coinLowestLarger.first) {
-                coinLowestLarger = coin;
             }
+            vValue.push_back(make_pair(entry.nValue, entry.coin));
+            nTotalLower += entry.nValue;
         }
 
         if (nTotalLower == nTargetValue) {
@@ -1919,18 +2328,23 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
         break;
     }
 
-    // Solve subset sum by stochastic approximation
-    sort(vValue.rbegin(), vValue.rend(), CompareValueOnly());
+    // vValue is in descending value order already
     vector<char> vfBest;
     CAmount nBest;
 
-    ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest, 1000);
-    if (nBest != nTargetValue && nTotalLower >= nTargetValue + CENT)
-        ApproximateBestSubset(vValue, nTotalLower, nTargetValue + CENT, vfBest, nBest, 1000);
+    // Prefer a set whose excess is smaller than what a change output would cost to create and spend later
+    bool fNoChange = SelectCoinsBnB(vValue, nTotalLower, nTargetValue, ::minRelayTxFee.GetFee(CHANGE_OUTPUT_COST_BYTES), vfBest, nBest);
+
+    // Otherwise solve subset sum by stochastic approximation
+    if (!fNoChange) {
+        ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest, 1000);
+        if (nBest != nTargetValue && nTotalLower >= nTargetValue + CENT)
+            ApproximateBestSubset(vValue, nTotalLower, nTargetValue + CENT, vfBest, nBest, 1000);
+    }
 
     // If we have a bigger coin and (either the stochastic approximation didn't find a good solution,
     //                                   or the next bigger coin is closer), return the bigger coin
-    if (coinLowestLarger.second.first &&
+    if (!fNoChange && coinLowestLarger.second.first &&
         ((nBest != nTargetValue && nBest < nTargetValue + CENT) || coinLowestLarger.first <= nBest)) {
         setCoinsRet.insert(coinLowestLarger.second);
         nValueRet += coinLowestLarger.first;
@@ -1995,9 +2409,11 @@ bool CWallet::SelectCoins(const CAmount& nTargetValue, set<pair<const CWalletTx*
         return (nValueRet >= nTargetValue);
     }
 
-    return (SelectCoinsMinConf(nTargetValue, 1, 6, vCoins, setCoinsRet, nValueRet) ||
-            SelectCoinsMinConf(nTargetValue, 1, 1, vCoins, setCoinsRet, nValueRet) ||
-            (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue, 0, 1, vCoins, setCoinsRet, nValueRet)));
+    CCoinSelectionPool pool;
+    BuildCoinSelectionPool(vCoins, pool);
+    return (SelectCoinsMinConf(nTargetValue, 1, 6, pool, setCoinsRet, nValueRet) ||
+            SelectCoinsMinConf(nTargetValue, 1, 1, pool, setCoinsRet, nValueRet) ||
+            (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue, 0, 1, pool, setCoinsRet, nValueRet)));
 }
 
 struct CompareByPriority {
@@ -2742,10 +3158,8 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, std:
         LOCK2(cs_main, cs_wallet);
         LogPrintf("CommitTransaction:\n%s", wtxNew.ToString());
         {
-            // This is only to keep the database open to defeat the auto-flush for the
-            // duration of this scope.  This is the only place where this optimization
-            // maybe makes sense; please don't do it anywhere else.
-            CWalletDB* pwalletdb = fFileBacked ? new CWalletDB(strWalletFile, "r") : NULL;
+            // Key pool, transaction and order position records go to disk together
+            CWalletDBBatch batch(strWalletFile);
 
             // Take key pair from key pool so it won't be used again
             reservekey.KeepKey();
@@ -2767,9 +3181,7 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, std:
                     updated_hahes.insert(txin.prevout.hash);
                 }
             }
-
-            if (fFileBacked)
-                delete pwalletdb;
+            batch.Commit();
         }
 
         // Track how many getdata requests our transaction gets
@@ -3066,6 +3478,7 @@ bool CWallet::NewKeyPool()
 {
     {
         LOCK(cs_wallet);
+        CWalletDBBatch batch(strWalletFile);
         CWalletDB walletdb(strWalletFile);
         BOOST_FOREACH (int64_t nIndex, setKeyPool)
             walletdb.ErasePool(nIndex);
@@ -3080,12 +3493,13 @@ bool CWallet::NewKeyPool()
             walletdb.WritePool(nIndex, CKeyPool(GenerateNewKey()));
             setKeyPool.insert(nIndex);
         }
+        batch.Commit();
         LogPrintf("CWallet::NewKeyPool wrote %d new keys\n", nKeys);
     }
     return true;
 }
 
-bool CWallet::TopUpKeyPool(unsigned int kpSize)
+bool CWallet::TopUpKeyPool(unsigned int kpSize, unsigned int nMaxNew)
 {
     {
         LOCK(cs_wallet);
@@ -3093,6 +3507,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         if (IsLocked())
             return false;
 
+        // One commit for the whole refill rather than one per key and pool entry
+        CWalletDBBatch batch(strWalletFile);
         CWalletDB walletdb(strWalletFile);
 
         // Top up key pool
@@ -3102,22 +3518,121 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         else
             nTargetSize = max(GetArg("-keypool", 1000), (int64_t)0);
 
-        while (setKeyPool.size() < (nTargetSize + 1)) {
+        unsigned int nNew = 0;
+        std::vector<int64_t> vAdded;
+        while (setKeyPool.size() < (nTargetSize + 1) && (nMaxNew == 0 || nNew < nMaxNew)) {
+            nNew++;
             int64_t nEnd = 1;
             if (!setKeyPool.empty())
                 nEnd = *(--setKeyPool.end()) + 1;
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey())))
+            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey()))) {
+                // The batch is aborted, so none of this refill reaches the disk
+                BOOST_FOREACH (int64_t nIndex, vAdded)
+                    setKeyPool.erase(nIndex);
                 throw runtime_error("TopUpKeyPool() : writing generated key failed");
+            }
             setKeyPool.insert(nEnd);
+            vAdded.push_back(nEnd);
             LogPrintf("keypool added key %d, size=%u\n", nEnd, setKeyPool.size());
-            double dProgress = 100.f * nEnd / (nTargetSize + 1);
-            std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
-            uiInterface.InitMessage(strMsg);
+            if (nMaxNew == 0) {
+                double dProgress = 100.f * nEnd / (nTargetSize + 1);
+                std::string strMsg = strprintf(_("Loading wallet... (%3.2f %%)"), dProgress);
+                uiInterface.InitMessage(strMsg);
+            }
+        }
+        if (!batch.Commit()) {
+            BOOST_FOREACH (int64_t nIndex, vAdded)
+                setKeyPool.erase(nIndex);
+            throw runtime_error("TopUpKeyPool() : writing generated keys failed");
         }
     }
     return true;
 }
 
+void CWallet::RequestKeyPoolTopUp()
+{
+    bool fRunning;
+    {
+        LOCK(cs_wallet);
+        fRunning = keyPoolFillStats.fRunning;
+    }
+    if (!fRunning) {
+        TopUpKeyPool();
+        return;
+    }
+
+    boost::unique_lock<boost::mutex> lock(cs_keyPoolFill);
+    fKeyPoolFillRequested = true;
+    cvKeyPoolFill.notify_one();
+}
+
+void CWallet::ThreadKeyPoolFiller()
+{
+    RenameThread("tpc-keypool");
+    {
+        LOCK(cs_wallet);
+        keyPoolFillStats.fRunning = true;
+    }
+    {
+        // Start with a fill in case the pool was drawn down before shutdown
+        boost::unique_lock<boost::mutex> lock(cs_keyPoolFill);
+        fKeyPoolFillRequested = true;
+    }
+
+    try {
+        while (true) {
+            {
+                boost::unique_lock<boost::mutex> lock(cs_keyPoolFill);
+                while (!fKeyPoolFillRequested)
+                    cvKeyPoolFill.wait(lock);
+                fKeyPoolFillRequested = false;
+            }
+
+            // Generate keys a batch at a time so address requests and block
+            // processing only ever wait for a few key derivations
+            int64_t nStart = GetTimeMicros();
+            int64_t nKeys = 0;
+            while (true) {
+                boost::this_thread::interruption_point();
+                LOCK(cs_wallet);
+                if (IsLocked())
+                    break;
+                size_t nBefore = setKeyPool.size();
+                TopUpKeyPool(0, KEYPOOL_FILL_BATCH);
+                if (setKeyPool.size() == nBefore)
+                    break;
+                nKeys += setKeyPool.size() - nBefore;
+                keyPoolFillStats.nBackgroundKeys += setKeyPool.size() - nBefore;
+            }
+
+            if (nKeys > 0) {
+                LOCK(cs_wallet);
+                keyPoolFillStats.nFills++;
+                keyPoolFillStats.nLastFillMicros = GetTimeMicros() - nStart;
+                LogPrint("wallet", "ThreadKeyPoolFiller : added %d keys in %dms, size=%u\n", nKeys, keyPoolFillStats.nLastFillMicros / 1000, setKeyPool.size());
+            }
+        }
+    } catch (boost::thread_interrupted) {
+        LOCK(cs_wallet);
+        keyPoolFillStats.fRunning = false;
+        throw;
+    } catch (std::exception& e) {
+        PrintExceptionContinue(&e, "ThreadKeyPoolFiller()");
+    } catch (...) {
+        PrintExceptionContinue(NULL, "ThreadKeyPoolFiller()");
+    }
+
+    // The thread is gone: address requests top the pool up themselves again
+    LOCK(cs_wallet);
+    keyPoolFillStats.fRunning = false;
+}
+
+CKeyPoolFillStats CWallet::GetKeyPoolFillStats() const
+{
+    LOCK(cs_wallet);
+    return keyPoolFillStats;
+}
+
 void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool)
 {
     nIndex = -1;
@@ -3125,13 +3640,25 @@ void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool)
     {
         LOCK(cs_wallet);
 
-        if (!IsLocked())
-            TopUpKeyPool();
+        // With the background filler running only an empty pool is topped up
+        // here, and only by one batch; the filler does the rest
+        bool fFillerRunning = keyPoolFillStats.fRunning;
+        if (!IsLocked() && (!fFillerRunning || setKeyPool.empty())) {
+            size_t nBefore = setKeyPool.size();
+            TopUpKeyPool(0, fFillerRunning ? KEYPOOL_FILL_BATCH : 0);
+            keyPoolFillStats.nForegroundKeys += setKeyPool.size() - nBefore;
+        }
 
         // Get the oldest key
         if (setKeyPool.empty())
             return;
 
+        if (fFillerRunning) {
+            int64_t nLow = std::min(GetArg("-keypoollow", DEFAULT_KEYPOOL_LOW), GetArg("-keypool", 1000));
+            if ((int64_t)setKeyPool.size() <= nLow + 1)
+                RequestKeyPoolTopUp();
+        }
+
         CWalletDB walletdb(strWalletFile);
 
         nIndex = *(setKeyPool.begin());
@@ -3964,7 +4491,8 @@ int CMerkleTx::GetTransactionLockSignatures() const
     if (!fEnableSwiftTX) return -1;
 
     //compile consessus vote
-    std::map<uint256, CTransactionLock>::iterator i = mapTxLocks.find(GetHash());
+    LOCK(cs_swifttx);
+    TxLockMap::iterator i = mapTxLocks.find(GetHash());
     if (i != mapTxLocks.end()) {
         return (*i).second.CountSignatures();
     }
@@ -3977,7 +4505,8 @@ bool CMerkleTx::IsTransactionLockTimedOut() const
     if (!fEnableSwiftTX) return 0;
 
     //compile consessus vote
-    std::map<uint256, CTransactionLock>::iterator i = mapTxLocks.find(GetHash());
+    LOCK(cs_swifttx);
+    TxLockMap::iterator i = mapTxLocks.find(GetHash());
     if (i != mapTxLocks.end()) {
         return GetTime() > (*i).second.nTimeout;
     }
@@ -3985,6 +4514,207 @@ bool CMerkleTx::IsTransactionLockTimedOut() const
     return false;
 }
 
+namespace
+{
+/** Mint the coins of pvDenoms at positions nWorker, nWorker + nThreads, ... */
+void ThreadMintWorker(const std::vector<libzerocoin::CoinDenomination>* pvDenoms, std::vector<CZerocoinMint>* pvMints, unsigned int nWorker, unsigned int nThreads)
+{
+    for (size_t i = nWorker; i < pvDenoms->size(); i += nThreads) {
+        try {
+            // mint a new coin (create Pedersen Commitment) and extract PublicCoin that is shareable from it
+            libzerocoin::PrivateCoin newCoin(Params().Zerocoin_Params(), (*pvDenoms)[i]);
+            const libzerocoin::PublicCoin& pubCoin = newCoin.getPublicCoin();
+            if (!pubCoin.validate())
+                continue;
+            (*pvMints)[i] = CZerocoinMint((*pvDenoms)[i], pubCoin.getValue(), newCoin.getRandomness(), newCoin.getSerialNumber(), false);
+        } catch (const std::exception& e) {
+            LogPrintf("ThreadMintWorker() : %s\n", e.what());
+        }
+    }
+}
+} // anon namespace
+
+void GenerateZerocoinMints(const std::vector<libzerocoin::CoinDenomination>& vDenoms, std::vector<CZerocoinMint>& vMints)
+{
+    vMints.assign(vDenoms.size(), CZerocoinMint());
+    unsigned int nThreads = std::max(1, std::min(16, (int)GetArg("-mintthreads", DEFAULT_MINT_THREADS)));
+    nThreads = std::min(nThreads, (unsigned int)vDenoms.size());
+    if (nThreads <= 1) {
+        ThreadMintWorker(&vDenoms, &vMints, 0, 1);
+        return;
+    }
+
+    // Each coin is a search for a prime commitment, independent of the others.
+    // The workers write into vMints, so they are always joined.
+    boost::this_thread::disable_interruption di;
+    boost::thread_group threadGroup;
+    for (unsigned int i = 0; i < nThreads; i++)
+        threadGroup.create_thread(boost::bind(&ThreadMintWorker, &vDenoms, &vMints, i, nThreads));
+    threadGroup.join_all();
+}
+
+bool CWallet::AddMintToPool(const CZerocoinMint& mint)
+{
+    AssertLockHeld(cs_wallet);
+    if (IsLocked())
+        return false;
+
+    uint256 hashPubcoin = CzTPCTracker::GetHashForValue(mint.GetValue());
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << mint;
+
+    CMintPoolEntry entry;
+    entry.denom = mint.GetDenomination();
+    entry.fCrypted = IsCrypted();
+    if (entry.fCrypted) {
+        CKeyingMaterial vchPlaintext(ss.begin(), ss.end());
+        if (!EncryptWithMasterKey(vchPlaintext, hashPubcoin, entry.vchMint))
+            return error("%s : failed to encrypt mint", __func__);
+    } else {
+        entry.vchMint.assign(ss.begin(), ss.end());
+    }
+
+    if (fFileBacked && !CWalletDB(strWalletFile).WriteMintPoolEntry(hashPubcoin, entry))
+        return error("%s : failed to write mint", __func__);
+    mapMintPool[hashPubcoin] = entry;
+    return true;
+}
+
+bool CWallet::TakeMintFromPool(libzerocoin::CoinDenomination denom, CZerocoinMint& mint)
+{
+    LOCK(cs_wallet);
+    if (IsLocked())
+        return false;
+
+    for (std::map<uint256, CMintPoolEntry>::iterator it = mapMintPool.begin(); it != mapMintPool.end(); ++it) {
+        const CMintPoolEntry& entry = it->second;
+        if (entry.denom != denom || entry.fCrypted != IsCrypted())
+            continue;
+
+        std::vector<unsigned char> vchMint;
+        if (entry.fCrypted) {
+            CKeyingMaterial vchPlaintext;
+            if (!DecryptWithMasterKey(entry.vchMint, it->first, vchPlaintext))
+                continue;
+            vchMint.assign(vchPlaintext.begin(), vchPlaintext.end());
+        } else {
+            vchMint = entry.vchMint;
+        }
+        try {
+            CDataStream ss(vchMint, SER_DISK, CLIENT_VERSION);
+            ss >> mint;
+        } catch (const std::exception&) {
+            continue;
+        }
+        if (mint.GetDenomination() != denom || CzTPCTracker::GetHashForValue(mint.GetValue()) != it->first)
+            continue;
+
+        // A mint leaves the pool for good once handed out, even if its
+        // transaction is never sent; it was never published either
+        if (fFileBacked)
+            CWalletDB(strWalletFile).EraseMintPoolEntry(it->first);
+        mapMintPool.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void CWallet::LoadMintPoolEntry(const uint256& hashPubcoin, const CMintPoolEntry& entry)
+{
+    LOCK(cs_wallet);
+    mapMintPool[hashPubcoin] = entry;
+}
+
+void CWallet::ClearMintPool()
+{
+    LOCK(cs_wallet);
+    if (fFileBacked) {
+        CWalletDBBatch batch(strWalletFile);
+        CWalletDB walletdb(strWalletFile);
+        for (std::map<uint256, CMintPoolEntry>::const_iterator it = mapMintPool.begin(); it != mapMintPool.end(); ++it)
+            walletdb.EraseMintPoolEntry(it->first);
+        batch.Commit();
+    }
+    mapMintPool.clear();
+}
+
+std::map<libzerocoin::CoinDenomination, int> CWallet::GetMintPoolCounts() const
+{
+    LOCK(cs_wallet);
+    std::map<libzerocoin::CoinDenomination, int> mapCounts;
+    for (std::map<uint256, CMintPoolEntry>::const_iterator it = mapMintPool.begin(); it != mapMintPool.end(); ++it) {
+        if (it->second.fCrypted == IsCrypted())
+            mapCounts[it->second.denom]++;
+    }
+    return mapCounts;
+}
+
+void CWallet::RequestMintPoolRefill()
+{
+    boost::unique_lock<boost::mutex> lock(cs_mintPoolFill);
+    fMintPoolFillRequested = true;
+    cvMintPoolFill.notify_one();
+}
+
+void CWallet::ThreadMintPoolFiller()
+{
+    RenameThread("tpc-mintpool");
+    const int nTarget = GetArg("-zmintpool", DEFAULT_ZMINT_POOL);
+    RequestMintPoolRefill();
+
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(cs_mintPoolFill);
+            while (!fMintPoolFillRequested)
+                cvMintPoolFill.wait(lock);
+            fMintPoolFillRequested = false;
+        }
+
+        while (true) {
+            if (IsLocked())
+                break;
+
+            std::vector<libzerocoin::CoinDenomination> vDenoms;
+            std::map<libzerocoin::CoinDenomination, int> mapCounts = GetMintPoolCounts();
+            BOOST_FOREACH (libzerocoin::CoinDenomination denom, libzerocoin::zerocoinDenomList) {
+                for (int n = mapCounts[denom]; n < nTarget && vDenoms.size() < ZMINT_POOL_BATCH; n++)
+                    vDenoms.push_back(denom);
+            }
+            if (vDenoms.empty())
+                break;
+
+            // Generate without holding cs_wallet, store in one transaction
+            int64_t nStart = GetTimeMicros();
+            int nAdded = 0;
+            try {
+                std::vector<CZerocoinMint> vMints;
+                GenerateZerocoinMints(vDenoms, vMints);
+                boost::this_thread::interruption_point();
+
+                LOCK(cs_wallet);
+                CWalletDBBatch batch(strWalletFile);
+                BOOST_FOREACH (const CZerocoinMint& mint, vMints) {
+                    if (mint.GetDenomination() != libzerocoin::ZQ_ERROR && AddMintToPool(mint))
+                        nAdded++;
+                }
+                batch.Commit();
+            } catch (boost::thread_interrupted) {
+                throw;
+            } catch (std::exception& e) {
+                // Minting falls back to generating coins itself; retry on the next request
+                PrintExceptionContinue(&e, "ThreadMintPoolFiller()");
+                break;
+            } catch (...) {
+                PrintExceptionContinue(NULL, "ThreadMintPoolFiller()");
+                break;
+            }
+            LogPrint("zero", "ThreadMintPoolFiller : added %d mints in %dms, pool size=%u\n", nAdded, (GetTimeMicros() - nStart) / 1000, mapMintPool.size());
+            if (nAdded == 0)
+                break;
+        }
+    }
+}
+
 bool CWallet::CreateZerocoinMintTransaction(const CAmount nValue, CMutableTransaction& txNew, vector<CZerocoinMint>& vMints, CReserveKey* reservekey, int64_t& nFeeRet, std::string& strFailReason, const CCoinControl* coinControl, const bool isZCSpendChange)
 {
     if (IsLocked()) {
@@ -3994,11 +4724,12 @@ bool CWallet::CreateZerocoinMintTransaction(const CAmount nValue, CMutableTransa
     }
 
     //add multiple mints that will fit the amount requested as closely as possible
+    std::vector<libzerocoin::CoinDenomination> vDenoms;
     CAmount nMintingValue = 0;
     CAmount nValueRemaining = 0;
     while (true) {
         //mint a coin with the closest denomination to what is being requested
-        nFeeRet = max(static_cast<int>(txNew.vout.size()), 1) * Params().Zerocoin_MintFee();
+        nFeeRet = max(static_cast<int>(txNew.vout.size() + vDenoms.size()), 1) * Params().Zerocoin_MintFee();
         nValueRemaining = nValue - nMintingValue - (isZCSpendChange ? nFeeRet : 0);
 
         // if this is change of a zerocoinspend, then we can't mint all change, at least something must be given as a fee
@@ -4009,25 +4740,42 @@ bool CWallet::CreateZerocoinMintTransaction(const CAmount nValue, CMutableTransa
         if (denomination == libzerocoin::ZQ_ERROR)
             break;
 
-        CAmount nValueNewMint = libzerocoin::ZerocoinDenominationToAmount(denomination);
-        nMintingValue += nValueNewMint;
+        nMintingValue += libzerocoin::ZerocoinDenominationToAmount(denomination);
+        vDenoms.push_back(denomination);
+    }
 
-        // mint a new coin (create Pedersen Commitment) and extract PublicCoin that is shareable from it
-        libzerocoin::PrivateCoin newCoin(Params().Zerocoin_Params(), denomination);
-        libzerocoin::PublicCoin pubCoin = newCoin.getPublicCoin();
+    // Use pre-generated coins from the mint pool where there are any and
+    // generate the rest in parallel
+    std::vector<CZerocoinMint> vNewMints(vDenoms.size());
+    std::vector<libzerocoin::CoinDenomination> vGenerate;
+    std::vector<size_t> vGenerateIndex;
+    for (size_t i = 0; i < vDenoms.size(); i++) {
+        if (!TakeMintFromPool(vDenoms[i], vNewMints[i])) {
+            vGenerate.push_back(vDenoms[i]);
+            vGenerateIndex.push_back(i);
+        }
+    }
+    if (vGenerate.size() < vDenoms.size())
+        RequestMintPoolRefill();
+    if (!vGenerate.empty()) {
+        std::vector<CZerocoinMint> vGenerated;
+        GenerateZerocoinMints(vGenerate, vGenerated);
+        for (size_t i = 0; i < vGenerated.size(); i++)
+            vNewMints[vGenerateIndex[i]] = vGenerated[i];
+    }
 
+    BOOST_FOREACH (const CZerocoinMint& mint, vNewMints) {
         // Validate
-        if(!pubCoin.validate()) {
+        if (mint.GetDenomination() == libzerocoin::ZQ_ERROR) {
             strFailReason = _("failed to validate zerocoin");
             return false;
         }
 
-        CScript scriptSerializedCoin = CScript() << OP_ZEROCOINMINT << pubCoin.getValue().getvch().size() << pubCoin.getValue().getvch();
-        CTxOut outMint(nValueNewMint, scriptSerializedCoin);
+        CScript scriptSerializedCoin = CScript() << OP_ZEROCOINMINT << mint.GetValue().getvch().size() << mint.GetValue().getvch();
+        CTxOut outMint(libzerocoin::ZerocoinDenominationToAmount(mint.GetDenomination()), scriptSerializedCoin);
         txNew.vout.push_back(outMint);
 
         //store as CZerocoinMint for later use
-        CZerocoinMint mint(denomination, pubCoin.getValue(), newCoin.getRandomness(), newCoin.getSerialNumber(), false);
         vMints.push_back(mint);
     }
 
@@ -4093,44 +4841,66 @@ bool CWallet::CreateZerocoinMintTransaction(const CAmount nValue, CMutableTransa
     return true;
 }
 
-bool CWallet::MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, const uint256& hashTxOut, CTxIn& newTxIn, CZerocoinSpendReceipt& receipt)
+namespace
 {
-    // Default error status if not changed below
-    receipt.SetStatus("Transaction Mint Started", ZTPC_TXMINT_GENERAL);
+/** One zerocoin input of a spend; everything past the mint height is filled in by BuildSpendInput() */
+struct CSpendInput {
+    CZerocoinMint mint;
+    int nHeightMintAdded; //! -1 if the mint transaction was not found
+    CTxIn txin;
+    CBigNum bnSerial;
+    uint32_t nAccumulatorChecksum;
+    int nMintsAdded;
+    std::string strStatus;
+    int nStatus;
+    CZerocoinSpendTimings timings;
+};
 
-    libzerocoin::CoinDenomination denomination = zerocoinSelected.GetDenomination();
+/** Witness, proofs and checks for one input. Takes no locks; the caller holds cs_main. */
+void BuildSpendInput(CSpendInput& input, int nSecurityLevel, const uint256& hashTxOut)
+{
+    libzerocoin::CoinDenomination denomination = input.mint.GetDenomination();
     // 2. Get pubcoin from the private coin
-    libzerocoin::PublicCoin pubCoinSelected(Params().Zerocoin_Params(), zerocoinSelected.GetValue(), denomination);
+    libzerocoin::PublicCoin pubCoinSelected(Params().Zerocoin_Params(), input.mint.GetValue(), denomination);
     LogPrintf("%s : pubCoinSelected:\n denom=%d\n value%s\n", __func__, denomination, pubCoinSelected.getValue().GetHex());
     if (!pubCoinSelected.validate()) {
-        receipt.SetStatus("the selected mint coin is an invalid coin", ZTPC_INVALID_COIN);
-        return false;
+        input.strStatus = "the selected mint coin is an invalid coin";
+        input.nStatus = ZTPC_INVALID_COIN;
+        return;
     }
 
     // 3. Compute Accumulator and Witness
+    int64_t nStart = GetTimeMicros();
     libzerocoin::Accumulator accumulator(Params().Zerocoin_Params(), pubCoinSelected.getDenomination());
     libzerocoin::AccumulatorWitness witness(Params().Zerocoin_Params(), accumulator, pubCoinSelected);
     string strFailReason = "";
-    int nMintsAdded = 0;
-    if (!GenerateAccumulatorWitness(pubCoinSelected, accumulator, witness, nSecurityLevel, nMintsAdded, strFailReason)) {
-        receipt.SetStatus("Try to spend with a higher security level to include more coins", ZTPC_FAILED_ACCUMULATOR_INITIALIZATION);
-        LogPrintf("%s : %s \n", __func__, receipt.GetStatusMessage());
-        return false;
+    if (input.nHeightMintAdded < 0 || !GenerateAccumulatorWitness(pubCoinSelected, input.nHeightMintAdded, accumulator, witness, nSecurityLevel, input.nMintsAdded, strFailReason)) {
+        input.strStatus = "Try to spend with a higher security level to include more coins";
+        input.nStatus = ZTPC_FAILED_ACCUMULATOR_INITIALIZATION;
+        LogPrintf("%s : %s \n", __func__, input.strStatus);
+        return;
     }
+    input.timings.nWitness = GetTimeMicros() - nStart;
 
     // Construct the CoinSpend object. This acts like a signature on the transaction.
     libzerocoin::PrivateCoin privateCoin(Params().Zerocoin_Params(), denomination);
     privateCoin.setPublicCoin(pubCoinSelected);
-    privateCoin.setRandomness(zerocoinSelected.GetRandomness());
-    privateCoin.setSerialNumber(zerocoinSelected.GetSerialNumber());
+    privateCoin.setRandomness(input.mint.GetRandomness());
+    privateCoin.setSerialNumber(input.mint.GetSerialNumber());
     uint32_t nChecksum = GetChecksum(accumulator.getValue());
 
     try {
-        libzerocoin::CoinSpend spend(Params().Zerocoin_Params(), privateCoin, accumulator, nChecksum, witness, hashTxOut);
+        libzerocoin::CoinSpendTimings proofTimings;
+        libzerocoin::CoinSpend spend(Params().Zerocoin_Params(), privateCoin, accumulator, nChecksum, witness, hashTxOut, &proofTimings);
+        input.timings.nCommitmentPoK = proofTimings.nCommitmentPoK;
+        input.timings.nAccumulatorPoK = proofTimings.nAccumulatorPoK;
+        input.timings.nSerialNumberSoK = proofTimings.nSerialNumberSoK;
 
+        nStart = GetTimeMicros();
         if (!spend.Verify(accumulator)) {
-            receipt.SetStatus("the new spend coin transaction did not verify", ZTPC_INVALID_WITNESS);
-            return false;
+            input.strStatus = "the new spend coin transaction did not verify";
+            input.nStatus = ZTPC_INVALID_WITNESS;
+            return;
         }
 
         // Deserialize the CoinSpend intro a fresh object
@@ -4139,52 +4909,111 @@ bool CWallet::MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, con
         std::vector<unsigned char> data(serializedCoinSpend.begin(), serializedCoinSpend.end());
 
         //Add the coin spend into a TPC transaction
-        newTxIn.scriptSig = CScript() << OP_ZEROCOINSPEND << data.size();
-        newTxIn.scriptSig.insert(newTxIn.scriptSig.end(), data.begin(), data.end());
-        newTxIn.prevout.SetNull();
+        input.txin.scriptSig = CScript() << OP_ZEROCOINSPEND << data.size();
+        input.txin.scriptSig.insert(input.txin.scriptSig.end(), data.begin(), data.end());
+        input.txin.prevout.SetNull();
 
         //use nSequence as a shorthand lookup of denomination
         //NOTE that this should never be used in place of checking the value in the final blockchain acceptance/verification
         //of the transaction
-        newTxIn.nSequence = denomination;
+        input.txin.nSequence = denomination;
 
         CDataStream serializedCoinSpendChecking(SER_NETWORK, PROTOCOL_VERSION);
         try {
             serializedCoinSpendChecking << spend;
         }
         catch (...) {
-            receipt.SetStatus("failed to deserialize", ZTPC_BAD_SERIALIZATION);
-            return false;
+            input.strStatus = "failed to deserialize";
+            input.nStatus = ZTPC_BAD_SERIALIZATION;
+            return;
         }
 
         libzerocoin::CoinSpend newSpendChecking(Params().Zerocoin_Params(), serializedCoinSpendChecking);
         if (!newSpendChecking.Verify(accumulator)) {
-            receipt.SetStatus("the transaction did not verify", ZTPC_BAD_SERIALIZATION);
+            input.strStatus = "the transaction did not verify";
+            input.nStatus = ZTPC_BAD_SERIALIZATION;
+            return;
+        }
+        input.timings.nVerify = GetTimeMicros() - nStart;
+
+        input.bnSerial = spend.getCoinSerialNumber();
+        input.nAccumulatorChecksum = GetChecksum(accumulator.getValue());
+    }
+    catch (const std::exception&) {
+        input.strStatus = "CoinSpend: Accumulator witness does not verify";
+        input.nStatus = ZTPC_INVALID_WITNESS;
+        return;
+    }
+
+    input.nStatus = ZTPC_SPEND_OKAY;
+}
+
+/** Build the inputs of pvInputs at positions nWorker, nWorker + nThreads, ... */
+void ThreadSpendInputWorker(std::vector<CSpendInput>* pvInputs, int nSecurityLevel, const uint256* phashTxOut, unsigned int nWorker, unsigned int nThreads)
+{
+    for (size_t i = nWorker; i < pvInputs->size(); i += nThreads)
+        BuildSpendInput((*pvInputs)[i], nSecurityLevel, *phashTxOut);
+}
+} // anon namespace
+
+bool CWallet::MintsToTxIns(const std::vector<CZerocoinMint>& vMintsSelected, int nSecurityLevel, const uint256& hashTxOut, std::vector<CTxIn>& vin, CZerocoinSpendReceipt& receipt)
+{
+    AssertLockHeld(cs_main);
+
+    // Default error status if not changed below
+    receipt.SetStatus("Transaction Mint Started", ZTPC_TXMINT_GENERAL);
+
+    std::vector<CSpendInput> vInputs(vMintsSelected.size());
+    for (size_t i = 0; i < vMintsSelected.size(); i++) {
+        CSpendInput& input = vInputs[i];
+        input.mint = vMintsSelected[i];
+        input.nStatus = ZTPC_TXMINT_GENERAL;
+        input.nMintsAdded = 0;
+        libzerocoin::PublicCoin pubCoin(Params().Zerocoin_Params(), input.mint.GetValue(), input.mint.GetDenomination());
+        if (!GetCoinMintHeight(pubCoin, input.nHeightMintAdded))
+            input.nHeightMintAdded = -1;
+    }
+
+    // Each input's witness and proofs are independent of the others. The
+    // workers only read the chain, which cannot change while we hold cs_main.
+    unsigned int nThreads = std::max(1, std::min(16, (int)GetArg("-spendthreads", DEFAULT_SPEND_THREADS)));
+    nThreads = std::min(nThreads, (unsigned int)vInputs.size());
+    if (nThreads <= 1) {
+        ThreadSpendInputWorker(&vInputs, nSecurityLevel, &hashTxOut, 0, 1);
+    } else {
+        boost::this_thread::disable_interruption di;
+        boost::thread_group threadGroup;
+        for (unsigned int i = 0; i < nThreads; i++)
+            threadGroup.create_thread(boost::bind(&ThreadSpendInputWorker, &vInputs, nSecurityLevel, &hashTxOut, i, nThreads));
+        threadGroup.join_all();
+    }
+
+    // Results are taken in the order the mints were selected
+    for (CSpendInput& input : vInputs) {
+        if (input.nStatus != ZTPC_SPEND_OKAY) {
+            receipt.SetStatus(input.strStatus, input.nStatus);
             return false;
         }
 
-        std::list<CBigNum> listCoinSpendSerial = CWalletDB(strWalletFile).ListSpentCoinsSerial();
-        for (const CBigNum& item : listCoinSpendSerial) {
-            if (spend.getCoinSerialNumber() == item) {
-                //Tried to spend an already spent zTPC
-                zerocoinSelected.SetUsed(true);
-                if (!CWalletDB(strWalletFile).WriteZerocoinMint(zerocoinSelected))
-                    LogPrintf("%s failed to write zerocoinmint\n", __func__);
+        if (zTPCTracker->IsSpentSerial(input.bnSerial)) {
+            //Tried to spend an already spent zTPC
+            input.mint.SetUsed(true);
+            if (!zTPCTracker->Add(input.mint))
+                LogPrintf("%s failed to write zerocoinmint\n", __func__);
 
-                pwalletMain->NotifyZerocoinChanged(pwalletMain, zerocoinSelected.GetValue().GetHex(), "Used", CT_UPDATED);
-                receipt.SetStatus("the coin spend has been used", ZTPC_SPENT_USED_ZTPC);
-                return false;
-            }
+            pwalletMain->NotifyZerocoinChanged(pwalletMain, input.mint.GetValue().GetHex(), "Used", CT_UPDATED);
+            receipt.SetStatus("the coin spend has been used", ZTPC_SPENT_USED_ZTPC);
+            return false;
         }
 
-        uint32_t nAccumulatorChecksum = GetChecksum(accumulator.getValue());
-        CZerocoinSpend zcSpend(spend.getCoinSerialNumber(), 0, zerocoinSelected.GetValue(), zerocoinSelected.GetDenomination(), nAccumulatorChecksum);
-        zcSpend.SetMintCount(nMintsAdded);
-        receipt.AddSpend(zcSpend);
-    }
-    catch (const std::exception&) {
-        receipt.SetStatus("CoinSpend: Accumulator witness does not verify", ZTPC_INVALID_WITNESS);
-        return false;
+        CZerocoinSpend zcSpend(input.bnSerial, 0, input.mint.GetValue(), input.mint.GetDenomination(), input.nAccumulatorChecksum);
+        zcSpend.SetMintCount(input.nMintsAdded);
+        receipt.AddSpend(zcSpend, input.timings);
+        vin.push_back(input.txin);
+
+        LogPrint("zero", "%s : spend of %s built, witness %dms, commitment %dms, accumulator %dms, serial %dms, verify %dms\n", __func__,
+            input.mint.GetValue().GetHex().substr(0, 16), input.timings.nWitness / 1000, input.timings.nCommitmentPoK / 1000,
+            input.timings.nAccumulatorPoK / 1000, input.timings.nSerialNumberSoK / 1000, input.timings.nVerify / 1000);
     }
 
     receipt.SetStatus("Spend Valid", ZTPC_SPEND_OKAY); // Everything okay
@@ -4210,14 +5039,13 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
     nStatus = ZTPC_TRX_CREATE;
 
     // If not already given pre-selected mints, then select mints from the wallet
-    CWalletDB walletdb(pwalletMain->strWalletFile);
     list<CZerocoinMint> listMints;
     CAmount nValueSelected = 0;
     int nCoinsReturned = 0; // Number of coins returned in change from function below (for debug)
     int nNeededSpends = 0;  // Number of spends which would be needed if selection failed
     const int nMaxSpends = Params().Zerocoin_MaxSpendsPerTransaction(); // Maximum possible spends for one zTPC transaction
     if (vSelectedMints.empty()) {
-        listMints = walletdb.ListMintedCoins(true, true, true); // need to find mints to spend
+        listMints = zTPCTracker->ListMints(true, true, true); // need to find mints to spend
         if(listMints.empty()) {
             receipt.SetStatus("failed to find Zerocoins in in wallet.dat", nStatus);
             return false;
@@ -4248,7 +5076,7 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
             receipt.SetStatus("trying to spend an already spent serial #, try again.", nStatus);
 
             mint.SetUsed(true);
-            walletdb.WriteZerocoinMint(mint);
+            zTPCTracker->Add(mint);
 
             return false;
         }
@@ -4267,7 +5095,7 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
 
         // archive this mint as an orphan
         if (fArchive) {
-            walletdb.ArchiveMintOrphan(mint);
+            zTPCTracker->Archive(mint);
             nArchived++;
         }
     }
@@ -4347,20 +5175,15 @@ bool CWallet::CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel,
             uint256 hashTxOut = txNew.GetHash();
 
             //add all of the mints to the transaction as inputs
-            for (CZerocoinMint mint : vSelectedMints) {
-                CTxIn newTxIn;
-                if (!MintToTxIn(mint, nSecurityLevel, hashTxOut, newTxIn, receipt)) {
-                    return false;
-                }
-                txNew.vin.push_back(newTxIn);
-            }
+            if (!MintsToTxIns(vSelectedMints, nSecurityLevel, hashTxOut, txNew.vin, receipt))
+                return false;
 
             //now that all inputs have been added, add full tx hash to zerocoinspend records and write to db
             uint256 txHash = txNew.GetHash();
             for (CZerocoinSpend spend : receipt.GetSpends()) {
                 spend.SetTxHash(txHash);
 
-                if (!CWalletDB(strWalletFile).WriteZerocoinSpendSerialEntry(spend)) {
+                if (!zTPCTracker->AddSpend(spend)) {
                     receipt.SetStatus("failed to write coin serial number into wallet", nStatus);
                 }
             }
@@ -4382,9 +5205,8 @@ string CWallet::ResetMintZerocoin(bool fExtendedSearch)
 {
     long updates = 0;
     long deletions = 0;
-    CWalletDB walletdb(pwalletMain->strWalletFile);
 
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, true);
+    list<CZerocoinMint> listMints = zTPCTracker->ListMints(false, false, true);
     vector<CZerocoinMint> vMintsToFind{ std::make_move_iterator(std::begin(listMints)), std::make_move_iterator(std::end(listMints)) };
     vector<CZerocoinMint> vMintsMissing;
     vector<CZerocoinMint> vMintsToUpdate;
@@ -4395,13 +5217,13 @@ string CWallet::ResetMintZerocoin(bool fExtendedSearch)
     // Update the meta data of mints that were marked for updating
     for (CZerocoinMint mint : vMintsToUpdate) {
         updates++;
-        walletdb.WriteZerocoinMint(mint);
+        zTPCTracker->Add(mint);
     }
 
     // Delete any mints that were unable to be located on the blockchain
     for (CZerocoinMint mint : vMintsMissing) {
         deletions++;
-        walletdb.ArchiveMintOrphan(mint);
+        zTPCTracker->Archive(mint);
     }
 
     string strResult = _("ResetMintZerocoin finished: ") + to_string(updates) + _(" mints updated, ") + to_string(deletions) + _(" mints deleted\n");
@@ -4411,10 +5233,9 @@ string CWallet::ResetMintZerocoin(bool fExtendedSearch)
 string CWallet::ResetSpentZerocoin()
 {
     long removed = 0;
-    CWalletDB walletdb(pwalletMain->strWalletFile);
 
-    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, false);
-    list<CZerocoinSpend> listSpends = walletdb.ListSpentCoins();
+    list<CZerocoinMint> listMints = zTPCTracker->ListMints(false, false, false);
+    list<CZerocoinSpend> listSpends = zTPCTracker->ListSpends();
     list<CZerocoinSpend> listUnconfirmedSpends;
 
     for (CZerocoinSpend spend : listSpends) {
@@ -4436,8 +5257,8 @@ string CWallet::ResetSpentZerocoin()
                 removed++;
                 mint.SetUsed(false);
                 RemoveSerialFromDB(spend.GetSerial());
-                walletdb.WriteZerocoinMint(mint);
-                walletdb.EraseZerocoinSpendSerialEntry(spend.GetSerial());
+                zTPCTracker->Add(mint);
+                zTPCTracker->EraseSpend(spend.GetSerial());
                 continue;
             }
         }
@@ -4470,7 +5291,7 @@ void CWallet::ReconsiderZerocoins(std::list<CZerocoinMint>& listMintsRestored)
 
         mint.SetTxHash(txHash);
         mint.SetHeight(mapBlockIndex.at(hashBlock)->nHeight);
-        if (!walletdb.UnarchiveZerocoin(mint)) {
+        if (!zTPCTracker->Unarchive(mint)) {
             LogPrintf("%s : failed to unarchive mint %s\n", __func__, mint.GetValue().GetHex());
         }
         listMintsRestored.emplace_back(mint);
@@ -4553,12 +5374,17 @@ string CWallet::MintZerocoin(CAmount nValue, CWalletTx& wtxNew, vector<CZerocoin
         return _("Error: The transaction was rejected! This might happen if some of the coins in your wallet were already spent, such as if you used a copy of wallet.dat and coins were spent in the copy but not marked as spent here.");
     } else {
         //update mints with full transaction hash and then database them
-        CWalletDB walletdb(pwalletMain->strWalletFile);
-        for (CZerocoinMint mint : vMints) {
-            mint.SetTxHash(wtxNew.GetHash());
-            walletdb.WriteZerocoinMint(mint);
-            pwalletMain->NotifyZerocoinChanged(pwalletMain, mint.GetValue().GetHex(), "Used", CT_UPDATED);
+        {
+            LOCK(cs_wallet);
+            CWalletDBBatch batch(strWalletFile);
+            for (CZerocoinMint mint : vMints) {
+                mint.SetTxHash(wtxNew.GetHash());
+                zTPCTracker->Add(mint);
+            }
+            batch.Commit();
         }
+        for (const CZerocoinMint& mint : vMints)
+            pwalletMain->NotifyZerocoinChanged(pwalletMain, mint.GetValue().GetHex(), "Used", CT_UPDATED);
     }
 
     //Create a backup of the wallet
@@ -4587,7 +5413,6 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
     if (fMintChange && fBackupMints)
         ZTPCBackupWallet();
 
-    CWalletDB walletdb(pwalletMain->strWalletFile);
     if (!CommitTransaction(wtxNew, reserveKey)) {
         LogPrintf("%s: failed to commit\n", __func__);
         nStatus = ZTPC_COMMIT_FAILED;
@@ -4595,13 +5420,13 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
         //reset all mints
         for (CZerocoinMint mint : vMintsSelected) {
             mint.SetUsed(false); // having error, so set to false, to be able to use again
-            walletdb.WriteZerocoinMint(mint);
+            zTPCTracker->Add(mint);
             pwalletMain->NotifyZerocoinChanged(pwalletMain, mint.GetValue().GetHex(), "New", CT_UPDATED);
         }
 
         //erase spends
         for (CZerocoinSpend spend : receipt.GetSpends()) {
-            if (!walletdb.EraseZerocoinSpendSerialEntry(spend.GetSerial())) {
+            if (!zTPCTracker->EraseSpend(spend.GetSerial())) {
                 receipt.SetStatus("Error: It cannot delete coin serial number in wallet", ZTPC_ERASE_SPENDS_FAILED);
             }
 
@@ -4611,7 +5436,7 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
 
         // erase new mints
         for (auto& mint : vNewMints) {
-            if (!walletdb.EraseZerocoinMint(mint)) {
+            if (!zTPCTracker->Erase(mint)) {
                 receipt.SetStatus("Error: Unable to cannot delete zerocoin mint in wallet", ZTPC_ERASE_NEW_MINTS_FAILED);
             }
         }
@@ -4620,30 +5445,43 @@ bool CWallet::SpendZerocoin(CAmount nAmount, int nSecurityLevel, CWalletTx& wtxN
         return false;
     }
 
+    LOCK(cs_wallet);
+    // The spend is on the network already: whatever zTPCTracker recorded below
+    // has to reach the disk, so the batch is committed on the error paths too
+    CWalletDBBatch batch(strWalletFile);
+    bool fMarkedUsed = true;
     for (CZerocoinMint mint : vMintsSelected) {
         mint.SetUsed(true);
-        if (!walletdb.WriteZerocoinMint(mint)) {
+        if (!zTPCTracker->Add(mint)) {
             receipt.SetStatus("Failed to write mint to db", nStatus);
-            return false;
+            fMarkedUsed = false;
+            break;
         }
 
         CZerocoinMint mintCheck;
-        if (!walletdb.ReadZerocoinMint(mint.GetValue(), mintCheck)) {
+        if (!zTPCTracker->GetMint(mint.GetValue(), mintCheck)) {
             receipt.SetStatus("failed to read mintcheck", nStatus);
-            return false;
+            fMarkedUsed = false;
+            break;
         }
 
         if (!mintCheck.IsUsed()) {
             receipt.SetStatus("Error, the mint did not get marked as used", nStatus);
-            return false;
+            fMarkedUsed = false;
+            break;
         }
     }
 
     // write new Mints to db
-    for (CZerocoinMint mint : vNewMints) {
-        mint.SetTxHash(wtxNew.GetHash());
-        walletdb.WriteZerocoinMint(mint);
+    if (fMarkedUsed) {
+        for (CZerocoinMint mint : vNewMints) {
+            mint.SetTxHash(wtxNew.GetHash());
+            zTPCTracker->Add(mint);
+        }
     }
+    batch.Commit();
+    if (!fMarkedUsed)
+        return false;
 
     receipt.SetStatus("Spend Successful", ZTPC_SPEND_OKAY);  // When we reach this point spending zTPC was successful
 
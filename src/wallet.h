@@ -23,6 +23,7 @@
 #include "validationinterface.h"
 #include "wallet_ismine.h"
 #include "walletdb.h"
+#include "ztpctracker.h"
 
 #include <algorithm>
 #include <map>
@@ -54,6 +55,22 @@ static const CAmount DEFAULT_TRANSACTION_MAXFEE = 1 * COIN;
 static const CAmount nHighTransactionMaxFeeWarning = 100 * nHighTransactionFeeWarning;
 //! Largest (in bytes) free transaction we're willing to create
 static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
+//! -rescanthreads default: threads reading and matching blocks during a wallet rescan
+static const int DEFAULT_RESCAN_THREADS = 4;
+//! Blocks read ahead and committed together by a wallet rescan; cs_main is released between batches
+static const unsigned int RESCAN_BATCH_BLOCKS = 100;
+//! -keypoollow default: the background filler tops the key pool up once it drops to this many keys
+static const unsigned int DEFAULT_KEYPOOL_LOW = 250;
+//! Keys the key pool filler generates per cs_wallet hold
+static const unsigned int KEYPOOL_FILL_BATCH = 50;
+//! -mintthreads default: threads generating the coins of one zerocoin mint
+static const int DEFAULT_MINT_THREADS = 4;
+//! -zmintpool default: pre-generated zerocoin mints kept per denomination, 0 disables the pool
+static const int DEFAULT_ZMINT_POOL = 0;
+//! -spendthreads default: threads generating the proofs of a multi-coin zerocoin spend
+static const int DEFAULT_SPEND_THREADS = 4;
+//! Most coins the mint pool filler generates before checking for shutdown and storing them
+static const unsigned int ZMINT_POOL_BATCH = 16;
 
 // Zerocoin denomination which creates exactly one of each denominations:
 // 6666 = 1*5000 + 1*1000 + 1*500 + 1*100 + 1*50 + 1*10 + 1*5 + 1
@@ -66,6 +83,30 @@ class CReserveKey;
 class CScript;
 class CWalletTx;
 
+/** Progress of the running or most recent wallet rescan, see getrescaninfo */
+struct CWalletRescanStatus {
+    bool fActive;
+    int nStartHeight;
+    int nHeight;     //! last block committed
+    int nStopHeight; //! chain height when the last batch was collected
+    int nFound;      //! wallet transactions added or updated
+    int64_t nStartTime;
+    double dProgress;
+
+    CWalletRescanStatus() : fActive(false), nStartHeight(0), nHeight(0), nStopHeight(0), nFound(0), nStartTime(0), dProgress(0) {}
+};
+
+/** Key pool filler counters, see getwalletinfo */
+struct CKeyPoolFillStats {
+    bool fRunning;           //! the background filler thread is up
+    int64_t nFills;          //! top-ups run by the filler
+    int64_t nBackgroundKeys; //! keys generated by the filler
+    int64_t nForegroundKeys; //! keys generated on the thread reserving a key
+    int64_t nLastFillMicros; //! duration of the last top-up by the filler
+
+    CKeyPoolFillStats() : fRunning(false), nFills(0), nBackgroundKeys(0), nForegroundKeys(0), nLastFillMicros(0) {}
+};
+
 /** (client) version numbers for particular wallet features */
 enum WalletFeature {
     FEATURE_BASE = 10500, // the earliest version new wallets supports (only useful for getinfo's clientversion output)
@@ -96,7 +137,7 @@ enum ZerocoinSpendStatus {
     ZTPC_TRX_FUNDS_PROBLEMS = 6,                    // Everything related to available funds
     ZTPC_TRX_CREATE = 7,                            // Everything related to create the transaction
     ZTPC_TRX_CHANGE = 8,                            // Everything related to transaction change
-    ZTPC_TXMINT_GENERAL = 9,                        // General errors in MintToTxIn
+    ZTPC_TXMINT_GENERAL = 9,                        // General errors in MintsToTxIns
     ZTPC_INVALID_COIN = 10,                         // Selected mint coin is not valid
     ZTPC_FAILED_ACCUMULATOR_INITIALIZATION = 11,    // Failed to initialize witness
     ZTPC_INVALID_WITNESS = 12,                      // Spend coin transaction did not verify
@@ -136,6 +177,38 @@ public:
     }
 };
 
+/**
+ * A pre-generated zerocoin mint in the wallet's mint pool. The serialized
+ * CZerocoinMint is encrypted with the wallet master key, keyed by the pubcoin
+ * hash, whenever the wallet is encrypted.
+ */
+class CMintPoolEntry
+{
+public:
+    libzerocoin::CoinDenomination denom;
+    bool fCrypted;
+    std::vector<unsigned char> vchMint;
+
+    CMintPoolEntry() : denom(libzerocoin::ZQ_ERROR), fCrypted(false) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(denom);
+        READWRITE(fCrypted);
+        READWRITE(vchMint);
+    }
+};
+
+/**
+ * Generate a zerocoin mint of each denomination in vDenoms on up to
+ * -mintthreads threads. vMints[i] is left with denomination ZQ_ERROR where
+ * minting failed. Needs no locks.
+ */
+void GenerateZerocoinMints(const std::vector<libzerocoin::CoinDenomination>& vDenoms, std::vector<CZerocoinMint>& vMints);
+
 /** Address book data */
 class CAddressBookData
 {
@@ -152,6 +225,28 @@ public:
     StringMap destdata;
 };
 
+/**
+ * Spendable outputs of one SelectCoins call, sorted once by descending value.
+ * Every SelectCoinsMinConf pass finds the coins below its target by binary
+ * search instead of copying, shuffling and sorting the candidate list again.
+ */
+class CCoinSelectionPool
+{
+public:
+    struct CEntry {
+        CAmount nValue;
+        int nDepth;
+        bool fFromMe;
+        bool fDenominated;
+        std::pair<const CWalletTx*, unsigned int> coin;
+    };
+
+    std::vector<CEntry> vEntries; //! descending value, random order among equal values
+
+    /** Index of the first entry worth less than nValue */
+    size_t FindLower(CAmount nValue) const;
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -185,6 +280,46 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /**
+     * Spendable-coin index: the wallet transactions that may still hold an
+     * unspent output of ours. Balances and AvailableCoins walk this set
+     * instead of all of mapWallet. Fully spent transactions are dropped once
+     * per chain tip; a transaction comes back when one of its spends is synced
+     * again (reorg, conflict, erase) or after MarkDirty().
+     */
+    mutable std::set<uint256> setSpendableTxs;
+    mutable bool fSpendableTxsDirty;
+    mutable uint256 hashSpendableTxsTip;
+    bool IsFullySpent(const CWalletTx& wtx) const;
+
+    /**
+     * Obfuscation rounds of our outputs, filled in as transactions are added
+     * so mixing status, coin selection and balances need no ancestry walk.
+     * An entry depends on the wallet outputs its transaction spends, so
+     * changing a transaction drops the entries of everything spending it.
+     */
+    mutable std::map<COutPoint, int> mapObfuscationRounds;
+    void InvalidateObfuscationRounds(const uint256& hashTx);
+
+    //! held for the whole of a rescan, so only one runs at a time
+    CCriticalSection cs_rescan;
+    mutable CCriticalSection cs_rescanStatus;
+    CWalletRescanStatus rescanStatus;
+    void GetRescanScripts(std::set<CScript>& setScripts) const;
+
+    //! wakes ThreadKeyPoolFiller(); cs_wallet may be held when taking cs_keyPoolFill, not the reverse
+    CWaitableCriticalSection cs_keyPoolFill;
+    CConditionVariable cvKeyPoolFill;
+    bool fKeyPoolFillRequested;
+    CKeyPoolFillStats keyPoolFillStats; //! guarded by cs_wallet
+
+    //! pre-generated zerocoin mints by pubcoin hash, see ThreadMintPoolFiller()
+    std::map<uint256, CMintPoolEntry> mapMintPool;
+    CWaitableCriticalSection cs_mintPoolFill;
+    CConditionVariable cvMintPoolFill;
+    bool fMintPoolFillRequested;
+    bool AddMintToPool(const CZerocoinMint& mint);
+
 public:
     bool MintableCoins();
     bool SelectStakeCoins(std::set<std::pair<const CWalletTx*, unsigned int> >& setCoins, CAmount nTargetAmount) const;
@@ -200,7 +335,8 @@ public:
     // Zerocoin additions
     bool CreateZerocoinMintTransaction(const CAmount nValue, CMutableTransaction& txNew, vector<CZerocoinMint>& vMints, CReserveKey* reservekey, int64_t& nFeeRet, std::string& strFailReason, const CCoinControl* coinControl = NULL, const bool isZCSpendChange = false);
     bool CreateZerocoinSpendTransaction(CAmount nValue, int nSecurityLevel, CWalletTx& wtxNew, CReserveKey& reserveKey, CZerocoinSpendReceipt& receipt, vector<CZerocoinMint>& vSelectedMints, vector<CZerocoinMint>& vNewMints, bool fMintChange,  bool fMinimizeChange, CBitcoinAddress* address = NULL);
-    bool MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, const uint256& hashTxOut, CTxIn& newTxIn, CZerocoinSpendReceipt& receipt);
+    /** Build the zerocoin spend inputs of vMintsSelected, in order, generating their proofs on -spendthreads threads */
+    bool MintsToTxIns(const std::vector<CZerocoinMint>& vMintsSelected, int nSecurityLevel, const uint256& hashTxOut, std::vector<CTxIn>& vin, CZerocoinSpendReceipt& receipt);
     std::string MintZerocoin(CAmount nValue, CWalletTx& wtxNew, vector<CZerocoinMint>& vMints, const CCoinControl* coinControl = NULL);
     bool SpendZerocoin(CAmount nValue, int nSecurityLevel, CWalletTx& wtxNew, CZerocoinSpendReceipt& receipt, vector<CZerocoinMint>& vMintsSelected, bool fMintChange, bool fMinimizeChange, CBitcoinAddress* addressTo = NULL);
     std::string ResetMintZerocoin(bool fExtendedSearch);
@@ -208,6 +344,20 @@ public:
     void ReconsiderZerocoins(std::list<CZerocoinMint>& listMintsRestored);
     void ZTPCBackupWallet();
 
+    /** Move a pre-generated mint of denomination denom out of the mint pool; false if there is none or the wallet is locked */
+    bool TakeMintFromPool(libzerocoin::CoinDenomination denom, CZerocoinMint& mint);
+    void LoadMintPoolEntry(const uint256& hashPubcoin, const CMintPoolEntry& entry);
+    /** Drop every pre-generated mint, e.g. ones stored before the wallet was encrypted */
+    void ClearMintPool();
+    std::map<libzerocoin::CoinDenomination, int> GetMintPoolCounts() const;
+    /** Wake ThreadMintPoolFiller() */
+    void RequestMintPoolRefill();
+    /** Background thread keeping -zmintpool mints of every denomination ready for zerocoinmint */
+    void ThreadMintPoolFiller();
+
+    //! in-memory index of the zTPC mints and spends stored in the wallet file
+    CzTPCTracker* zTPCTracker;
+
     /** Zerocin entry changed.
     * @note called with lock cs_wallet held.
     */
@@ -255,6 +405,7 @@ public:
     CWallet()
     {
         SetNull();
+        zTPCTracker = new CzTPCTracker("");
     }
 
     CWallet(std::string strWalletFileIn)
@@ -263,11 +414,13 @@ public:
 
         strWalletFile = strWalletFileIn;
         fFileBacked = true;
+        zTPCTracker = new CzTPCTracker(strWalletFile);
     }
 
     ~CWallet()
     {
         delete pwalletdbEncryption;
+        delete zTPCTracker;
     }
 
     void SetNull()
@@ -277,6 +430,11 @@ public:
         fFileBacked = false;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
+        zTPCTracker = NULL;
+        fSpendableTxsDirty = false;
+        fKeyPoolFillRequested = false;
+        fMintPoolFillRequested = false;
+        hashSpendableTxsTip = 0;
         nOrderPosNext = 0;
         nNextResend = 0;
         nLastResend = 0;
@@ -354,7 +512,9 @@ public:
 
     void AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed = true, const CCoinControl* coinControl = NULL, bool fIncludeZeroValue = false, AvailableCoinsType nCoinType = ALL_COINS, bool fUseIX = false) const;
     std::map<CBitcoinAddress, std::vector<COutput> > AvailableCoinsByAddress(bool fConfirmed = true, CAmount maxCoinValue = 0);
-    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
+    void BuildCoinSelectionPool(const std::vector<COutput>& vCoins, CCoinSelectionPool& pool) const;
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const std::vector<COutput>& vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const CCoinSelectionPool& pool, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
 
     /// Get 1000 TPC output and keys which can be used for the Masternode
     bool GetMasternodeVinAndKeys(CTxIn& txinRet, CPubKey& pubKeyRet, CKey& keyRet, std::string strTxHash = "", std::string strOutputIndex = "");
@@ -362,6 +522,8 @@ public:
     bool GetVinAndKeysFromOutput(COutput out, CTxIn& txinRet, CPubKey& pubKeyRet, CKey& keyRet);
 
     bool IsSpent(const uint256& hash, unsigned int n) const;
+    //! wallet transactions that may hold unspent outputs, in mapWallet order; needs cs_main and cs_wallet
+    std::vector<const CWalletTx*> GetSpendableTxs() const;
 
     bool IsLockedCoin(uint256 hash, unsigned int n) const;
     void LockCoin(COutPoint& output);
@@ -442,9 +604,12 @@ public:
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet = false);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    CWalletRescanStatus GetRescanStatus() const;
+    bool IsRescanning() const;
     void ReacceptWalletTransactions();
     void ResendWalletTransactions();
     CAmount GetBalance() const;
@@ -489,7 +654,13 @@ public:
     static CAmount GetMinimumFee(unsigned int nTxBytes, unsigned int nConfirmTarget, const CTxMemPool& pool);
 
     bool NewKeyPool();
-    bool TopUpKeyPool(unsigned int kpSize = 0);
+    /** Fill the key pool up to kpSize (default -keypool) keys, generating at most nMaxNew (0: no limit) */
+    bool TopUpKeyPool(unsigned int kpSize = 0, unsigned int nMaxNew = 0);
+    /** Have the background filler top up the key pool, or do it now if the filler is not running */
+    void RequestKeyPoolTopUp();
+    /** Background thread keeping the key pool above -keypoollow so address requests never generate keys */
+    void ThreadKeyPoolFiller();
+    CKeyPoolFillStats GetKeyPoolFillStats() const;
     void ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool);
     void KeepKey(int64_t nIndex);
     void ReturnKey(int64_t nIndex);
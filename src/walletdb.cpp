@@ -152,6 +152,23 @@ bool CWalletDB::ReadBestBlock(CBlockLocator& locator)
     return Read(std::string("bestblock"), locator);
 }
 
+bool CWalletDB::WriteRescanProgress(const CBlockLocator& locator)
+{
+    nWalletDBUpdated++;
+    return Write(std::string("rescanprogress"), locator);
+}
+
+bool CWalletDB::ReadRescanProgress(CBlockLocator& locator)
+{
+    return Read(std::string("rescanprogress"), locator);
+}
+
+bool CWalletDB::EraseRescanProgress()
+{
+    nWalletDBUpdated++;
+    return Erase(std::string("rescanprogress"));
+}
+
 bool CWalletDB::WriteOrderPosNext(int64_t nOrderPosNext)
 {
     nWalletDBUpdated++;
@@ -657,6 +674,12 @@ bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CW
                 strErr = "Error reading wallet database: LoadDestData failed";
                 return false;
             }
+        } else if (strType == "zcpool") {
+            uint256 hashPubcoin;
+            ssKey >> hashPubcoin;
+            CMintPoolEntry entry;
+            ssValue >> entry;
+            pwallet->LoadMintPoolEntry(hashPubcoin, entry);
         }
     } catch (...) {
         return false;
@@ -1041,6 +1064,18 @@ bool CWalletDB::ReadZerocoinSpendSerialEntry(const CBigNum& bnSerial)
     return Read(make_pair(string("zcserial"), bnSerial), spend);
 }
 
+bool CWalletDB::WriteMintPoolEntry(const uint256& hashPubcoin, const CMintPoolEntry& entry)
+{
+    nWalletDBUpdated++;
+    return Write(make_pair(string("zcpool"), hashPubcoin), entry);
+}
+
+bool CWalletDB::EraseMintPoolEntry(const uint256& hashPubcoin)
+{
+    nWalletDBUpdated++;
+    return Erase(make_pair(string("zcpool"), hashPubcoin));
+}
+
 bool CWalletDB::WriteZerocoinMint(const CZerocoinMint& zerocoinMint)
 {
     CDataStream ss(SER_GETHASH, 0);
@@ -1188,7 +1223,7 @@ std::list<CZerocoinMint> CWalletDB::ListMintedCoins(bool fUnusedOnly, bool fMatu
                 CBlockIndex *pindex = chainActive[mint.GetHeight() + 1];
                 int nMintsAdded = 0;
                 while(pindex->nHeight < chainActive.Height() - 30) { // 30 just to make sure that its at least 2 checkpoints from the top block
-                    nMintsAdded += count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), mint.GetDenomination());
+                    nMintsAdded += pindex->mintDenominationsInBlock.Count(mint.GetDenomination());
                     if(nMintsAdded >= Params().Zerocoin_RequiredAccumulation())
                         break;
                     pindex = chainActive[pindex->nHeight + 1];
@@ -27,6 +27,7 @@ class CAccountingEntry;
 struct CBlockLocator;
 class CKeyPool;
 class CMasterKey;
+class CMintPoolEntry;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -111,6 +112,10 @@ public:
     bool WriteBestBlock(const CBlockLocator& locator);
     bool ReadBestBlock(CBlockLocator& locator);
 
+    bool WriteRescanProgress(const CBlockLocator& locator);
+    bool ReadRescanProgress(CBlockLocator& locator);
+    bool EraseRescanProgress();
+
     bool WriteOrderPosNext(int64_t nOrderPosNext);
 
     // presstab
@@ -162,6 +167,8 @@ public:
     bool WriteZerocoinSpendSerialEntry(const CZerocoinSpend& zerocoinSpend);
     bool EraseZerocoinSpendSerialEntry(const CBigNum& serialEntry);
     bool ReadZerocoinSpendSerialEntry(const CBigNum& bnSerial);
+    bool WriteMintPoolEntry(const uint256& hashPubcoin, const CMintPoolEntry& entry);
+    bool EraseMintPoolEntry(const uint256& hashPubcoin);
 
 private:
     CWalletDB(const CWalletDB&);
@@ -170,6 +177,35 @@ private:
     bool WriteAccountingEntry(const uint64_t nAccEntryNum, const CAccountingEntry& acentry);
 };
 
+/**
+ * Scope of a wallet database write batch, see CDB::BatchBegin(). Every
+ * CWalletDB this thread opens on the file until Commit() writes through one
+ * transaction that is committed and flushed at once. A batch that goes out
+ * of scope without Commit(), on an error return or an exception, is aborted.
+ * Hold cs_wallet for the whole scope so no other thread waits on the batch's
+ * database locks while holding the wallet lock.
+ */
+class CWalletDBBatch
+{
+private:
+    CWalletDB walletdb;
+    bool fActive;
+
+    CWalletDBBatch(const CWalletDBBatch&);
+    void operator=(const CWalletDBBatch&);
+
+public:
+    explicit CWalletDBBatch(const std::string& strFilename) : walletdb(strFilename), fActive(walletdb.BatchBegin()) {}
+
+    bool Commit()
+    {
+        if (!fActive)
+            return true;
+        fActive = false;
+        return walletdb.BatchCommit();
+    }
+};
+
 bool BackupWallet(const CWallet& wallet, const std::string& strDest);
 
 #endif // BITCOIN_WALLETDB_H
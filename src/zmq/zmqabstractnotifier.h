@@ -7,6 +7,7 @@
 
 #include "zmqconfig.h"
 
+class CBlock;
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
@@ -35,6 +36,10 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
+    virtual bool NotifyBlockConnect(const CBlock &block, const CBlockIndex *pindex);
+    virtual bool NotifyBlockDisconnect(const CBlock &block, const CBlockIndex *pindex);
+    virtual bool NotifyTransactionAcceptance(const CTransaction &transaction);
+    virtual bool NotifyTransactionRemoval(const CTransaction &transaction);
 
 protected:
     void *psocket;
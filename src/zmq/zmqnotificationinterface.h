@@ -27,6 +27,10 @@ protected:
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void NotifyTransactionLock(const CTransaction &tx);
+    void BlockConnected(const CBlock &block, const CBlockIndex *pindex);
+    void BlockDisconnected(const CBlock &block, const CBlockIndex *pindex);
+    void TransactionAddedToMempool(const CTransaction &tx);
+    void TransactionRemovedFromMempool(const CTransaction &tx);
 
 private:
     CZMQNotificationInterface();
@@ -8,6 +8,8 @@
 #include "util.h"
 #include "crypto/common.h"
 
+#include <boost/foreach.hpp>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK  = "hashblock";
@@ -16,6 +18,9 @@ static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
+static const char *MSG_SEQUENCE  = "sequence";
+static const char *MSG_ZCMINT    = "zerocoinmint";
+static const char *MSG_ZCSPEND   = "zerocoinspend";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -212,3 +217,113 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     ss << transaction;
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
+
+/**
+ * sequence body: <32-byte hash><1-byte label>
+ *   C / D: block connected to / disconnected from the active chain
+ *   A / R: transaction added to / removed from the mempool
+ */
+static bool SendSequenceMsg(CZMQAbstractPublishNotifier &notifier, const uint256 &hash, char label)
+{
+    LogPrint("zmq", "zmq: Publish sequence %s %c\n", hash.GetHex(), label);
+    unsigned char data[sizeof(uint256) + 1];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    data[32] = label;
+    return notifier.SendMessage(MSG_SEQUENCE, data, sizeof(data));
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockConnect(const CBlock &block, const CBlockIndex *pindex)
+{
+    return SendSequenceMsg(*this, pindex->GetBlockHash(), 'C');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockDisconnect(const CBlock &block, const CBlockIndex *pindex)
+{
+    return SendSequenceMsg(*this, pindex->GetBlockHash(), 'D');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionAcceptance(const CTransaction &transaction)
+{
+    return SendSequenceMsg(*this, transaction.GetHash(), 'A');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &transaction)
+{
+    return SendSequenceMsg(*this, transaction.GetHash(), 'R');
+}
+
+/**
+ * zerocoinmint / zerocoinspend body:
+ *   <1-byte label C/D><32-byte txid><4-byte LE denomination><CBigNum value>
+ * where value is the public coin for mints and the coin serial for spends.
+ */
+static bool SendZerocoinMsg(CZMQAbstractPublishNotifier &notifier, const char *command, char label,
+                            const uint256 &txid, libzerocoin::CoinDenomination denom, const CBigNum &bnValue)
+{
+    std::vector<unsigned char> vchValue = bnValue.getvch();
+    std::vector<unsigned char> data(1 + 32 + sizeof(uint32_t) + vchValue.size());
+    data[0] = label;
+    for (unsigned int i = 0; i < 32; i++)
+        data[32 - i] = txid.begin()[i];
+    WriteLE32(&data[33], libzerocoin::ZerocoinDenominationToInt(denom));
+    std::copy(vchValue.begin(), vchValue.end(), data.begin() + 37);
+    return notifier.SendMessage(command, &data[0], data.size());
+}
+
+bool CZMQPublishZerocoinMintNotifier::SendMints(const CBlock &block, char label)
+{
+    BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+        if (!tx.IsZerocoinMint())
+            continue;
+        BOOST_FOREACH(const CTxOut &txout, tx.vout) {
+            if (!txout.scriptPubKey.IsZerocoinMint())
+                continue;
+            CValidationState state;
+            libzerocoin::PublicCoin pubCoin(Params().Zerocoin_Params());
+            if (!TxOutToPublicCoin(txout, pubCoin, state))
+                continue;
+            LogPrint("zmq", "zmq: Publish zerocoinmint %s %c\n", tx.GetHash().GetHex(), label);
+            if (!SendZerocoinMsg(*this, MSG_ZCMINT, label, tx.GetHash(), pubCoin.getDenomination(), pubCoin.getValue()))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool CZMQPublishZerocoinMintNotifier::NotifyBlockConnect(const CBlock &block, const CBlockIndex *pindex)
+{
+    return SendMints(block, 'C');
+}
+
+bool CZMQPublishZerocoinMintNotifier::NotifyBlockDisconnect(const CBlock &block, const CBlockIndex *pindex)
+{
+    return SendMints(block, 'D');
+}
+
+bool CZMQPublishZerocoinSpendNotifier::SendSpends(const CBlock &block, char label)
+{
+    BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+        if (!tx.IsZerocoinSpend())
+            continue;
+        BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+            if (!txin.scriptSig.IsZerocoinSpend())
+                continue;
+            libzerocoin::CoinSpend spend = TxInToZerocoinSpend(txin);
+            LogPrint("zmq", "zmq: Publish zerocoinspend %s %c\n", tx.GetHash().GetHex(), label);
+            if (!SendZerocoinMsg(*this, MSG_ZCSPEND, label, tx.GetHash(), spend.getDenomination(), spend.getCoinSerialNumber()))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool CZMQPublishZerocoinSpendNotifier::NotifyBlockConnect(const CBlock &block, const CBlockIndex *pindex)
+{
+    return SendSpends(block, 'C');
+}
+
+bool CZMQPublishZerocoinSpendNotifier::NotifyBlockDisconnect(const CBlock &block, const CBlockIndex *pindex)
+{
+    return SendSpends(block, 'D');
+}
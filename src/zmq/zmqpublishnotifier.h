@@ -64,4 +64,33 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction);
 };
 
+class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnect(const CBlock &block, const CBlockIndex *pindex);
+    bool NotifyBlockDisconnect(const CBlock &block, const CBlockIndex *pindex);
+    bool NotifyTransactionAcceptance(const CTransaction &transaction);
+    bool NotifyTransactionRemoval(const CTransaction &transaction);
+};
+
+class CZMQPublishZerocoinMintNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnect(const CBlock &block, const CBlockIndex *pindex);
+    bool NotifyBlockDisconnect(const CBlock &block, const CBlockIndex *pindex);
+
+private:
+    bool SendMints(const CBlock &block, char label);
+};
+
+class CZMQPublishZerocoinSpendNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnect(const CBlock &block, const CBlockIndex *pindex);
+    bool NotifyBlockDisconnect(const CBlock &block, const CBlockIndex *pindex);
+
+private:
+    bool SendSpends(const CBlock &block, char label);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
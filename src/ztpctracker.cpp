@@ -0,0 +1,353 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ztpctracker.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "util.h"
+#include "walletdb.h"
+
+#include <algorithm>
+
+using namespace std;
+
+CzTPCTracker::CzTPCTracker(const std::string& strWalletFileIn)
+    : strWalletFile(strWalletFileIn), fInitialized(false)
+{
+}
+
+uint256 CzTPCTracker::GetHashForValue(const CBigNum& bnValue)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << bnValue;
+    return Hash(ss.begin(), ss.end());
+}
+
+void CzTPCTracker::Init()
+{
+    LOCK(cs_tracker);
+    InitLocked();
+}
+
+void CzTPCTracker::InitLocked()
+{
+    if (fInitialized)
+        return;
+    fInitialized = true;
+    if (strWalletFile.empty())
+        return;
+
+    int64_t nStart = GetTimeMillis();
+    CWalletDB walletdb(strWalletFile);
+    list<CZerocoinMint> listMints = walletdb.ListMintedCoins(false, false, false);
+    BOOST_FOREACH (const CZerocoinMint& mint, listMints)
+        AddLocked(mint);
+
+    list<CZerocoinSpend> listSpends = walletdb.ListSpentCoins();
+    BOOST_FOREACH (const CZerocoinSpend& spend, listSpends)
+        mapSpends[GetHashForValue(spend.GetSerial())] = spend;
+
+    LogPrintf("%s : loaded %u zerocoin mints and %u spends  %dms\n", __func__, mapMints.size(), mapSpends.size(), GetTimeMillis() - nStart);
+}
+
+void CzTPCTracker::Clear()
+{
+    LOCK(cs_tracker);
+    mapMints.clear();
+    mapSerialHashes.clear();
+    mapSpends.clear();
+    mapAccumulation.clear();
+    fInitialized = false;
+}
+
+size_t CzTPCTracker::Size() const
+{
+    LOCK(cs_tracker);
+    return mapMints.size();
+}
+
+bool CzTPCTracker::WriteMint(const CZerocoinMint& mint)
+{
+    if (strWalletFile.empty())
+        return true;
+    return CWalletDB(strWalletFile).WriteZerocoinMint(mint);
+}
+
+void CzTPCTracker::AddLocked(const CZerocoinMint& mint)
+{
+    uint256 hashPubcoin = GetHashForValue(mint.GetValue());
+    map<uint256, CZerocoinMint>::iterator it = mapMints.find(hashPubcoin);
+    if (it != mapMints.end() && it->second.GetHeight() != mint.GetHeight())
+        mapAccumulation.erase(hashPubcoin);
+
+    mapMints[hashPubcoin] = mint;
+    mapSerialHashes[GetHashForValue(mint.GetSerialNumber())] = hashPubcoin;
+}
+
+void CzTPCTracker::EraseLocked(const uint256& hashPubcoin)
+{
+    map<uint256, CZerocoinMint>::iterator it = mapMints.find(hashPubcoin);
+    if (it == mapMints.end())
+        return;
+    mapSerialHashes.erase(GetHashForValue(it->second.GetSerialNumber()));
+    mapAccumulation.erase(hashPubcoin);
+    mapMints.erase(it);
+}
+
+bool CzTPCTracker::Add(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    InitLocked();
+    if (!WriteMint(mint))
+        return false;
+    AddLocked(mint);
+    return true;
+}
+
+bool CzTPCTracker::Erase(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    InitLocked();
+    if (!strWalletFile.empty() && !CWalletDB(strWalletFile).EraseZerocoinMint(mint))
+        return false;
+    EraseLocked(GetHashForValue(mint.GetValue()));
+    return true;
+}
+
+bool CzTPCTracker::Archive(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    InitLocked();
+    if (!strWalletFile.empty() && !CWalletDB(strWalletFile).ArchiveMintOrphan(mint))
+        return false;
+    EraseLocked(GetHashForValue(mint.GetValue()));
+    return true;
+}
+
+bool CzTPCTracker::Unarchive(const CZerocoinMint& mint)
+{
+    LOCK(cs_tracker);
+    InitLocked();
+    if (!strWalletFile.empty() && !CWalletDB(strWalletFile).UnarchiveZerocoin(mint))
+        return false;
+    AddLocked(mint);
+    return true;
+}
+
+bool CzTPCTracker::AddSpend(const CZerocoinSpend& spend)
+{
+    LOCK(cs_tracker);
+    InitLocked();
+    if (!strWalletFile.empty() && !CWalletDB(strWalletFile).WriteZerocoinSpendSerialEntry(spend))
+        return false;
+    mapSpends[GetHashForValue(spend.GetSerial())] = spend;
+    return true;
+}
+
+bool CzTPCTracker::EraseSpend(const CBigNum& bnSerial)
+{
+    LOCK(cs_tracker);
+    InitLocked();
+    if (!strWalletFile.empty() && !CWalletDB(strWalletFile).EraseZerocoinSpendSerialEntry(bnSerial))
+        return false;
+    mapSpends.erase(GetHashForValue(bnSerial));
+    return true;
+}
+
+bool CzTPCTracker::GetMint(const CBigNum& bnPubcoin, CZerocoinMint& mint) const
+{
+    LOCK(cs_tracker);
+    const_cast<CzTPCTracker*>(this)->InitLocked();
+    map<uint256, CZerocoinMint>::const_iterator it = mapMints.find(GetHashForValue(bnPubcoin));
+    if (it == mapMints.end())
+        return false;
+    mint = it->second;
+    return true;
+}
+
+bool CzTPCTracker::HasPubcoin(const CBigNum& bnPubcoin) const
+{
+    CZerocoinMint mint;
+    return GetMint(bnPubcoin, mint);
+}
+
+bool CzTPCTracker::HasUnusedSerial(const CBigNum& bnSerial) const
+{
+    LOCK(cs_tracker);
+    const_cast<CzTPCTracker*>(this)->InitLocked();
+    uint256 hashSerial = GetHashForValue(bnSerial);
+    map<uint256, uint256>::const_iterator it = mapSerialHashes.find(hashSerial);
+    if (it == mapSerialHashes.end() || mapSpends.count(hashSerial))
+        return false;
+    map<uint256, CZerocoinMint>::const_iterator mi = mapMints.find(it->second);
+    return mi != mapMints.end() && !mi->second.IsUsed();
+}
+
+bool CzTPCTracker::IsSpentSerial(const CBigNum& bnSerial) const
+{
+    LOCK(cs_tracker);
+    const_cast<CzTPCTracker*>(this)->InitLocked();
+    return mapSpends.count(GetHashForValue(bnSerial)) > 0;
+}
+
+bool CzTPCTracker::IsAccumulated(const CZerocoinMint& mint, const uint256& hashPubcoin)
+{
+    // check to make sure there are enough other mints added to the accumulators after this one;
+    // progress is kept per mint so each block above it is only counted once
+    map<uint256, CMintAccumulation>::iterator it = mapAccumulation.find(hashPubcoin);
+    if (it == mapAccumulation.end()) {
+        CMintAccumulation acc;
+        acc.nHeightScanned = mint.GetHeight();
+        acc.nMintsAdded = 0;
+        it = mapAccumulation.insert(make_pair(hashPubcoin, acc)).first;
+    }
+
+    CMintAccumulation& acc = it->second;
+    int nRequired = Params().Zerocoin_RequiredAccumulation();
+    int nMaxHeight = chainActive.Height() - 30; // 30 just to make sure that its at least 2 checkpoints from the top block
+    while (acc.nMintsAdded < nRequired && acc.nHeightScanned + 1 < nMaxHeight) {
+        CBlockIndex* pindex = chainActive[acc.nHeightScanned + 1];
+        acc.nMintsAdded += pindex->mintDenominationsInBlock.Count(mint.GetDenomination());
+        acc.nHeightScanned++;
+    }
+
+    return acc.nMintsAdded >= nRequired;
+}
+
+list<CZerocoinMint> CzTPCTracker::ListMints(bool fUnusedOnly, bool fMatureOnly, bool fUpdateStatus)
+{
+    LOCK2(cs_main, cs_tracker);
+    InitLocked();
+
+    list<CZerocoinMint> listMints;
+    vector<CZerocoinMint> vOverWrite;
+    vector<CZerocoinMint> vArchive;
+    for (map<uint256, CZerocoinMint>::const_iterator it = mapMints.begin(); it != mapMints.end(); ++it) {
+        CZerocoinMint mint = it->second;
+
+        if (fUnusedOnly) {
+            if (mint.IsUsed())
+                continue;
+
+            //double check that we have no record of this serial being used
+            if (mapSpends.count(GetHashForValue(mint.GetSerialNumber()))) {
+                mint.SetUsed(true);
+                vOverWrite.push_back(mint);
+                continue;
+            }
+        }
+
+        if (fMatureOnly || fUpdateStatus) {
+            //if there is not a record of the block height, then look it up and assign it
+            if (!mint.GetHeight()) {
+                CTransaction tx;
+                uint256 hashBlock;
+                if (!GetTransaction(mint.GetTxHash(), tx, hashBlock, true)) {
+                    LogPrintf("%s failed to find tx for mint txid=%s\n", __func__, mint.GetTxHash().GetHex());
+                    vArchive.push_back(mint);
+                    continue;
+                }
+
+                //if not in the block index, most likely is unconfirmed tx
+                BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+                if (mi != mapBlockIndex.end()) {
+                    mint.SetHeight(mi->second->nHeight);
+                    vOverWrite.push_back(mint);
+                } else if (fMatureOnly) {
+                    continue;
+                }
+            }
+
+            //not mature
+            if (mint.GetHeight() > chainActive.Height() - Params().Zerocoin_MintRequiredConfirmations()) {
+                if (!fMatureOnly)
+                    listMints.push_back(mint);
+                continue;
+            }
+
+            //if only requesting an update (fUpdateStatus) then skip the rest and add to list
+            if (fMatureOnly && !IsAccumulated(mint, it->first))
+                continue;
+        }
+        listMints.push_back(mint);
+    }
+
+    //overwrite any updates
+    BOOST_FOREACH (const CZerocoinMint& mint, vOverWrite) {
+        if (!WriteMint(mint))
+            LogPrintf("%s failed to update mint from tx %s\n", __func__, mint.GetTxHash().GetHex());
+        AddLocked(mint);
+    }
+
+    // archive mints
+    BOOST_FOREACH (const CZerocoinMint& mint, vArchive) {
+        if (!strWalletFile.empty() && !CWalletDB(strWalletFile).ArchiveMintOrphan(mint)) {
+            LogPrintf("%s failed to archive mint from %s\n", __func__, mint.GetTxHash().GetHex());
+            continue;
+        }
+        EraseLocked(GetHashForValue(mint.GetValue()));
+    }
+
+    return listMints;
+}
+
+list<CZerocoinSpend> CzTPCTracker::ListSpends() const
+{
+    LOCK(cs_tracker);
+    const_cast<CzTPCTracker*>(this)->InitLocked();
+    list<CZerocoinSpend> listSpends;
+    for (map<uint256, CZerocoinSpend>::const_iterator it = mapSpends.begin(); it != mapSpends.end(); ++it)
+        listSpends.push_back(it->second);
+    return listSpends;
+}
+
+void CzTPCTracker::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
+{
+    if (!tx.IsZerocoinMint())
+        return;
+
+    AssertLockHeld(cs_main);
+    int nHeight = 0;
+    if (pblock) {
+        BlockMap::iterator mi = mapBlockIndex.find(pblock->GetHash());
+        if (mi != mapBlockIndex.end())
+            nHeight = mi->second->nHeight;
+    }
+
+    LOCK(cs_tracker);
+    InitLocked();
+    BOOST_FOREACH (const CTxOut& txout, tx.vout) {
+        if (!txout.IsZerocoinMint())
+            continue;
+
+        CValidationState state;
+        libzerocoin::PublicCoin pubcoin(Params().Zerocoin_Params());
+        if (!TxOutToPublicCoin(txout, pubcoin, state))
+            continue;
+
+        map<uint256, CZerocoinMint>::iterator it = mapMints.find(GetHashForValue(pubcoin.getValue()));
+        if (it == mapMints.end())
+            continue;
+
+        CZerocoinMint mint = it->second;
+        if (mint.GetHeight() == nHeight && mint.GetTxHash() == tx.GetHash())
+            continue;
+
+        mint.SetTxHash(tx.GetHash());
+        mint.SetHeight(nHeight);
+        if (!WriteMint(mint))
+            LogPrintf("%s failed to update mint from tx %s\n", __func__, tx.GetHash().GetHex());
+        AddLocked(mint);
+    }
+}
+
+void CzTPCTracker::BlockDisconnected(const CBlock& block)
+{
+    LOCK(cs_tracker);
+    mapAccumulation.clear();
+}
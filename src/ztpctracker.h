@@ -0,0 +1,97 @@
+// Copyright (c) 2017 The TPC developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ZTPCTRACKER_H
+#define BITCOIN_ZTPCTRACKER_H
+
+#include "primitives/zerocoin.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <string>
+
+class CBlock;
+class CTransaction;
+
+/**
+ * In-memory view of the wallet's zTPC mints and spent serials.
+ *
+ * The wallet database stays the persistent store: every change is written
+ * through to it, but queries are answered from memory instead of walking a
+ * BerkeleyDB cursor over all "zerocoin" and "zcserial" records. Mints are
+ * keyed by the hash of their pubcoin value, the same key CWalletDB uses, so
+ * listings come back in the order the database returned them.
+ *
+ * Lock order: cs_main, cs_wallet, then the tracker's own lock.
+ */
+class CzTPCTracker
+{
+private:
+    /** Accumulation progress of a mature mint, see IsAccumulated() */
+    struct CMintAccumulation {
+        int nHeightScanned; //! last block checked for same-denomination mints
+        int nMintsAdded;    //! same-denomination mints found up to nHeightScanned
+    };
+
+    mutable CCriticalSection cs_tracker;
+    std::string strWalletFile; //! empty for a memory-only wallet
+    bool fInitialized;
+
+    std::map<uint256, CZerocoinMint> mapMints;            //! pubcoin hash -> mint
+    std::map<uint256, uint256> mapSerialHashes;           //! serial hash -> pubcoin hash
+    std::map<uint256, CZerocoinSpend> mapSpends;          //! serial hash -> spend record
+    std::map<uint256, CMintAccumulation> mapAccumulation; //! pubcoin hash -> accumulation progress
+
+    void InitLocked();
+    bool WriteMint(const CZerocoinMint& mint);
+    void AddLocked(const CZerocoinMint& mint);
+    void EraseLocked(const uint256& hashPubcoin);
+    bool IsAccumulated(const CZerocoinMint& mint, const uint256& hashPubcoin);
+
+public:
+    CzTPCTracker(const std::string& strWalletFileIn);
+
+    static uint256 GetHashForValue(const CBigNum& bnValue);
+
+    /** Load mints and spends from the wallet database, once */
+    void Init();
+    void Clear();
+    size_t Size() const;
+
+    /** Store a new or changed mint */
+    bool Add(const CZerocoinMint& mint);
+    /** Remove a mint from the wallet */
+    bool Erase(const CZerocoinMint& mint);
+    /** Move a mint whose transaction cannot be found to the archive ("zco") */
+    bool Archive(const CZerocoinMint& mint);
+    /** Restore an archived mint */
+    bool Unarchive(const CZerocoinMint& mint);
+    bool AddSpend(const CZerocoinSpend& spend);
+    bool EraseSpend(const CBigNum& bnSerial);
+
+    bool GetMint(const CBigNum& bnPubcoin, CZerocoinMint& mint) const;
+    bool HasPubcoin(const CBigNum& bnPubcoin) const;
+    /** True if bnSerial belongs to one of our mints that is not marked used */
+    bool HasUnusedSerial(const CBigNum& bnSerial) const;
+    /** True if we hold a spend record for bnSerial */
+    bool IsSpentSerial(const CBigNum& bnSerial) const;
+
+    /**
+     * Same selection rules as CWalletDB::ListMintedCoins: fUnusedOnly skips
+     * used mints, fMatureOnly keeps only confirmed mints followed by enough
+     * same-denomination mints in the accumulators, fUpdateStatus fills in
+     * missing heights and archives mints whose transaction is gone.
+     */
+    std::list<CZerocoinMint> ListMints(bool fUnusedOnly, bool fMatureOnly, bool fUpdateStatus);
+    std::list<CZerocoinSpend> ListSpends() const;
+
+    /** Record the block height of our mints in a connected (pblock) or disconnected (NULL) transaction */
+    void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    /** Forget accumulation progress, which may have counted mints of the disconnected block */
+    void BlockDisconnected(const CBlock& block);
+};
+
+#endif // BITCOIN_ZTPCTRACKER_H